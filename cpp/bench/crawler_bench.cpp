@@ -0,0 +1,308 @@
+// Microbenchmarks for the crawler's per-page hot paths, run against saved
+// pages from a crawl snapshot: `make bench` (or `./crawler_bench [google
+// benchmark flags]`). CRAWLER_BENCH_CORPUS names the data/raw directory to
+// read, ../data/raw by default; without one a synthetic page set is used.
+#include "host_frontier.hpp"
+#include "html_links.hpp"
+#include "manifest_writer.hpp"
+#include "seen_set.hpp"
+#include "segment_store.hpp"
+#include "url.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr size_t kMaxCorpusPages = 2000;
+
+struct Page {
+    crawler::CanonicalUrl url;
+    std::string body;
+};
+
+struct Corpus {
+    std::vector<Page> pages;
+    // Raw href/src values as they appear in the pages, with the index of
+    // the page each came from.
+    std::vector<std::pair<std::string, size_t>> hrefs;
+    // Every distinct absolute link target.
+    std::vector<crawler::CanonicalUrl> links;
+    uint64_t bytes = 0;
+};
+
+// Stand-in for a campus page: navigation, relative and absolute links,
+// scripts and a block of text.
+std::string synthetic_page(size_t index) {
+    std::string page = "<!doctype html><html><head><title>Page " + std::to_string(index) +
+                       "</title><link rel=\"stylesheet\" href=\"/css/site.css\">"
+                       "<script>var nav = '<a href=\"/not-a-link\">';</script></head><body><nav>";
+    for (size_t i = 0; i < 60; ++i) {
+        page += "<a href=\"/section-" + std::to_string(i % 12) + "/page-" + std::to_string((index * 7 + i) % 5000) +
+                ".html\">Link " + std::to_string(i) + "</a>";
+    }
+    page += "</nav><main>";
+    for (size_t i = 0; i < 40; ++i) {
+        page += "<p>Students and faculty at the university collaborate on research &amp; outreach. "
+                "<a href=\"https://www.bgsu.edu/news/2024/story-" + std::to_string(i) +
+                ".html?utm_source=home#top\">Read more</a> <a href=\"../archive/item?id=" + std::to_string(i) +
+                "&amp;view=full\">Archive</a></p>";
+    }
+    page += "<img src=\"/images/banner.jpg\"></main></body></html>";
+    return page;
+}
+
+Corpus load_corpus() {
+    Corpus corpus;
+    const char* env = std::getenv("CRAWLER_BENCH_CORPUS");
+    fs::path raw = env ? fs::path(env) : fs::path("..") / "data" / "raw";
+    crawler::for_each_metadata_row(raw / "metadata.tsv", [&](const std::string& url, const std::string& location,
+                                                             const std::string& content_type) {
+        if (corpus.pages.size() >= kMaxCorpusPages || content_type.find("text/html") == std::string::npos) {
+            return;
+        }
+        auto page = crawler::canonicalize_url(url);
+        std::string body = crawler::read_saved_body(location);
+        if (page && !body.empty()) {
+            corpus.pages.push_back({std::move(*page), std::move(body)});
+        }
+    });
+    if (corpus.pages.empty()) {
+        std::cerr << "No saved HTML pages under " << raw << "; benchmarking synthetic pages\n";
+        for (size_t i = 0; i < 200; ++i) {
+            corpus.pages.push_back({*crawler::canonicalize_url("https://www.bgsu.edu/section-" + std::to_string(i % 12) +
+                                                               "/page-" + std::to_string(i) + ".html"),
+                                    synthetic_page(i)});
+        }
+    } else {
+        std::cerr << "Loaded " << corpus.pages.size() << " saved HTML pages from " << raw << "\n";
+    }
+
+    crawler::SeenSet distinct;
+    for (size_t i = 0; i < corpus.pages.size(); ++i) {
+        const Page& page = corpus.pages[i];
+        corpus.bytes += page.body.size();
+        crawler::LinkExtractor extractor;
+        extractor.feed(page.body);
+        for (size_t link = 0; link < extractor.size(); ++link) {
+            corpus.hrefs.emplace_back(std::string(extractor.link(link)), i);
+        }
+        for (auto& link : crawler::extract_links(extractor, page.url)) {
+            if (distinct.insert(link.str())) {
+                corpus.links.push_back(std::move(link));
+            }
+        }
+    }
+    return corpus;
+}
+
+const Corpus& corpus() {
+    static const Corpus loaded = load_corpus();
+    return loaded;
+}
+
+void BM_LinkExtractorFeed(benchmark::State& state) {
+    const Corpus& data = corpus();
+    crawler::LinkExtractor extractor;
+    size_t links = 0;
+    for (auto _ : state) {
+        for (const Page& page : data.pages) {
+            extractor.reset();
+            extractor.feed(page.body);
+            links += extractor.size();
+        }
+    }
+    benchmark::DoNotOptimize(links);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.bytes));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * data.pages.size()));
+}
+BENCHMARK(BM_LinkExtractorFeed)->Unit(benchmark::kMillisecond);
+
+// Tokenizing plus resolving every link, as the crawler does per page.
+void BM_ExtractLinks(benchmark::State& state) {
+    const Corpus& data = corpus();
+    crawler::LinkExtractor extractor;
+    size_t links = 0;
+    for (auto _ : state) {
+        for (const Page& page : data.pages) {
+            extractor.reset();
+            extractor.feed(page.body);
+            links += crawler::extract_links(extractor, page.url).size();
+        }
+    }
+    benchmark::DoNotOptimize(links);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.bytes));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * data.pages.size()));
+}
+BENCHMARK(BM_ExtractLinks)->Unit(benchmark::kMillisecond);
+
+// The same through one reused PageLinks, as each crawl worker does.
+void BM_PageLinks(benchmark::State& state) {
+    const Corpus& data = corpus();
+    crawler::LinkExtractor extractor;
+    crawler::PageLinks links;
+    size_t count = 0;
+    for (auto _ : state) {
+        for (const Page& page : data.pages) {
+            extractor.reset();
+            extractor.feed(page.body);
+            links.resolve(extractor, page.url);
+            count += links.size();
+        }
+    }
+    benchmark::DoNotOptimize(count);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.bytes));
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * data.pages.size()));
+}
+BENCHMARK(BM_PageLinks)->Unit(benchmark::kMillisecond);
+
+void BM_ParseUrl(benchmark::State& state) {
+    const Corpus& data = corpus();
+    for (auto _ : state) {
+        for (const auto& href : data.hrefs) {
+            benchmark::DoNotOptimize(crawler::parse_url(href.first));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * data.hrefs.size()));
+}
+BENCHMARK(BM_ParseUrl);
+
+// Relative reference to canonical absolute URL.
+void BM_ResolveUrl(benchmark::State& state) {
+    const Corpus& data = corpus();
+    for (auto _ : state) {
+        for (const auto& [href, page] : data.hrefs) {
+            benchmark::DoNotOptimize(crawler::resolve_url(&data.pages[page].url, href));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * data.hrefs.size()));
+}
+BENCHMARK(BM_ResolveUrl);
+
+void BM_SanitizeFilename(benchmark::State& state) {
+    const Corpus& data = corpus();
+    for (auto _ : state) {
+        for (const auto& link : data.links) {
+            benchmark::DoNotOptimize(crawler::sanitize_filename(link, ".html", "html"));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * data.links.size()));
+}
+BENCHMARK(BM_SanitizeFilename);
+
+// Fingerprints for `count` distinct URLs: the corpus links, then synthetic
+// variants of them once those run out.
+std::vector<uint64_t> fingerprints(size_t count) {
+    const Corpus& data = corpus();
+    std::vector<uint64_t> out;
+    out.reserve(count);
+    for (size_t i = 0; out.size() < count; ++i) {
+        std::string url = data.links.empty() ? "https://www.bgsu.edu/" : data.links[i % data.links.size()].str();
+        if (i >= data.links.size()) {
+            url += (url.find('?') == std::string::npos ? "?v=" : "&v=") + std::to_string(i);
+        }
+        out.push_back(crawler::url_fingerprint(url));
+    }
+    return out;
+}
+
+// Inserting into a set sized for the crawl; arg 1 turns on the Bloom filter.
+void BM_SeenSetInsert(benchmark::State& state) {
+    auto keys = fingerprints(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        crawler::SeenSet seen(keys.size(), state.range(1) != 0);
+        for (uint64_t key : keys) {
+            benchmark::DoNotOptimize(seen.insert_fingerprint(key));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * keys.size()));
+}
+BENCHMARK(BM_SeenSetInsert)->Args({1 << 16, 0})->Args({1 << 16, 1})->Args({1 << 20, 0})->Args({1 << 20, 1});
+
+// Lookups of links already seen (the common case while crawling) and of
+// new ones.
+void BM_SeenSetLookup(benchmark::State& state) {
+    size_t count = static_cast<size_t>(state.range(0));
+    auto keys = fingerprints(2 * count);
+    crawler::SeenSet seen(count, state.range(1) != 0);
+    for (size_t i = 0; i < count; ++i) {
+        seen.insert_fingerprint(keys[i]);
+    }
+    bool hits = state.range(2) != 0;
+    size_t offset = hits ? 0 : count;
+    for (auto _ : state) {
+        for (size_t i = 0; i < count; ++i) {
+            benchmark::DoNotOptimize(seen.contains_fingerprint(keys[offset + i]));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * count));
+}
+BENCHMARK(BM_SeenSetLookup)
+    ->ArgNames({"urls", "bloom", "hit"})
+    ->Args({1 << 20, 0, 1})
+    ->Args({1 << 20, 0, 0})
+    ->Args({1 << 20, 1, 0});
+
+// Crawl workers sharing one set: the first pass inserts, later passes are
+// the already-seen probes that dominate once a crawl is under way.
+void BM_SeenSetInsertContended(benchmark::State& state) {
+    static crawler::SeenSet* shared = nullptr;
+    static std::vector<uint64_t> keys;
+    if (state.thread_index() == 0) {
+        keys = fingerprints(size_t {1} << 20);
+        shared = new crawler::SeenSet(keys.size());
+    }
+    size_t threads = static_cast<size_t>(state.threads());
+    size_t begin = keys.size() * static_cast<size_t>(state.thread_index()) / threads;
+    size_t end = keys.size() * static_cast<size_t>(state.thread_index() + 1) / threads;
+    for (auto _ : state) {
+        for (size_t i = begin; i < end; ++i) {
+            benchmark::DoNotOptimize(shared->insert_fingerprint(keys[i]));
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * (end - begin)));
+    if (state.thread_index() == 0) {
+        delete shared;
+        shared = nullptr;
+    }
+}
+BENCHMARK(BM_SeenSetInsertContended)->Threads(1)->Threads(4)->Threads(8)->UseRealTime();
+
+// Pushing every corpus link onto its host queue, spread over all priority
+// levels, then draining the frontier with politeness intervals of zero.
+void BM_FrontierPushPop(benchmark::State& state) {
+    const Corpus& data = corpus();
+    std::vector<std::pair<std::string, crawler::FetchRequest>> requests;
+    for (size_t i = 0; i < data.links.size(); ++i) {
+        crawler::FetchRequest request {data.links[i].str()};
+        request.priority = static_cast<uint8_t>(i % crawler::HostFrontier::kPriorityLevels);
+        requests.emplace_back(std::string(data.links[i].authority()), std::move(request));
+    }
+    size_t popped = 0;
+    for (auto _ : state) {
+        crawler::HostFrontier frontier(0.0);
+        for (const auto& [host, request] : requests) {
+            frontier.push(host, request);
+        }
+        auto now = crawler::HostFrontier::Clock::now();
+        std::chrono::milliseconds wait {0};
+        while (frontier.pop(now, wait)) {
+            ++popped;
+        }
+    }
+    benchmark::DoNotOptimize(popped);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * requests.size()));
+}
+BENCHMARK(BM_FrontierPushPop)->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+BENCHMARK_MAIN();
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace crawler {
+
+struct AimdOptions {
+    int min_limit = 1;
+    int max_limit = 8;
+    int initial_limit = 2;
+    // The window is multiplied by this on a congestion signal.
+    double decrease_factor = 0.5;
+    // Recent TTFB this many times the host's healthy baseline (and at least
+    // kMinTtfbRiseUs above it) counts as congestion.
+    double ttfb_tolerance = 2.0;
+};
+
+// Additive-increase/multiplicative-decrease control of how many requests
+// may be in flight to each host. Every healthy response grows the host's
+// window by 1/window (one request per window's worth of responses);
+// 429/502/503/504, network failures and a TTFB well above the host's
+// baseline shrink it by `decrease_factor`. After a cut, signals from the
+// requests that were already in flight are ignored (one cut per window, as
+// in TCP), so a burst of failures from one overload counts once.
+//
+// Not internally synchronized; the crawler calls it under its frontier lock.
+class AimdLimiter {
+   public:
+    enum class Outcome { ok, throttled, failed };
+
+    explicit AimdLimiter(AimdOptions options);
+
+    // Feeds one finished request (`ttfb_us` only matters for `ok`) and
+    // returns the host's new limit.
+    int record(const std::string& host, Outcome outcome, int64_t ttfb_us);
+
+    // Overrides AimdOptions::max_limit for one host (at least min_limit).
+    void set_max_limit(const std::string& host, int max_limit);
+
+    int limit(const std::string& host) const;
+
+   private:
+    static constexpr int64_t kMinTtfbRiseUs = 20000;
+
+    struct HostState {
+        double window = 0.0;
+        int max_limit = 0;
+        // Fast EWMA of recent TTFB, and a baseline that follows it down
+        // at once but up only slowly.
+        double recent_ttfb_us = 0.0;
+        double baseline_ttfb_us = 0.0;
+        uint32_t samples = 0;
+        // Responses left to ignore congestion signals from after a cut.
+        uint32_t holdoff = 0;
+    };
+
+    HostState& state(const std::string& host);
+    void decrease(HostState& host);
+
+    AimdOptions options_;
+    std::unordered_map<std::string, HostState> hosts_;
+};
+
+}  // namespace crawler
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace crawler {
+
+// Moves a fully written `temp` over `path`: fsyncs the file, renames it and
+// fsyncs the directory, so after a crash or power loss `path` holds either
+// its old contents or all of the new ones. Logs and returns false on error.
+bool commit_file(const std::filesystem::path& temp, const std::filesystem::path& path);
+
+// Writes `path` through fill(std::ofstream&) into path.tmp, then commits it
+// with commit_file.
+template <typename Fill>
+bool write_file_atomically(const std::filesystem::path& path, Fill&& fill) {
+    std::filesystem::path temp = path;
+    temp += ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Failed to open " << temp << "\n";
+            return false;
+        }
+        fill(out);
+        if (!out.flush()) {
+            std::cerr << "Failed to write " << temp << "\n";
+            return false;
+        }
+    }
+    return commit_file(temp, path);
+}
+
+}  // namespace crawler
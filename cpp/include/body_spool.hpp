@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace crawler {
+
+// Holds a response body while it streams in: in memory up to
+// `memory_limit` bytes, then in a temp file under `spill_dir`, so large
+// assets never sit in RAM. The temp file is removed on destruction unless
+// it was moved into place with move_to().
+class BodySpool {
+   public:
+    BodySpool(std::filesystem::path spill_dir, size_t memory_limit);
+    ~BodySpool();
+
+    BodySpool(const BodySpool&) = delete;
+    BodySpool& operator=(const BodySpool&) = delete;
+
+    // False if the spill file could not be written.
+    bool append(std::string_view chunk);
+    // Sizes the memory buffer for a body announced as `length` bytes.
+    void expect(uint64_t length);
+
+    // Empties the spool for another body, keeping the memory buffer for
+    // reuse unless it grew past `keep_bytes`.
+    void reset(size_t keep_bytes);
+
+    uint64_t size() const { return size_; }
+    bool spilled() const { return fd_ >= 0; }
+    // The body, when it was not spilled.
+    const std::string& memory() const { return memory_; }
+    // The spill file, when it was.
+    int spill_fd() const { return fd_; }
+
+    // hash_bytes() of the whole body.
+    uint64_t hash() const;
+    // The whole body, read back from the spill file if needed.
+    std::string read_all() const;
+    // Renames the spill file, or writes the in-memory body, to `target`.
+    // Nothing else may be called afterwards.
+    bool move_to(const std::filesystem::path& target);
+
+   private:
+    bool spill();
+
+    std::filesystem::path spill_dir_;
+    size_t memory_limit_;
+    std::string memory_;
+    std::filesystem::path spill_path_;
+    int fd_ = -1;
+    uint64_t size_ = 0;
+};
+
+}  // namespace crawler
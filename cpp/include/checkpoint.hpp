@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace crawler {
+
+// Crawl state needed to pick up where a killed crawler left off: every URL
+// fingerprint ever queued, plus the URLs not yet processed (still queued,
+// in flight, or fetched but not yet saved).
+struct CheckpointSnapshot {
+    std::vector<uint64_t> fingerprints;
+    std::vector<std::string> frontier;
+    uint64_t pages_downloaded = 0;
+    // Size of metadata.tsv when the snapshot was taken; rows past it were
+    // written after the checkpoint.
+    uint64_t metadata_offset = 0;
+};
+
+// File layout (native endianness):
+//   header      magic "FGCKPT02", fingerprint count, frontier count, pages,
+//               metadata offset
+//   uint64_t    fingerprints[fingerprint count]
+//   per URL     uint32_t length, then the URL bytes
+// The fingerprint array sits at a fixed, 8-byte aligned offset so it can be
+// used straight out of an mmap. Writes go to a temp file that is fsynced and
+// renamed over the old checkpoint (then the directory is fsynced), so a
+// crash or power loss mid-write keeps the previous one intact.
+bool write_checkpoint(const std::filesystem::path& path, const CheckpointSnapshot& snapshot);
+
+// Read-only mmap of a checkpoint file. Views stay valid while it is alive.
+class MappedCheckpoint {
+   public:
+    static std::optional<MappedCheckpoint> open(const std::filesystem::path& path);
+
+    MappedCheckpoint(MappedCheckpoint&& other) noexcept;
+    MappedCheckpoint& operator=(MappedCheckpoint&& other) noexcept;
+    ~MappedCheckpoint();
+
+    size_t fingerprint_count() const { return fingerprint_count_; }
+    const uint64_t* fingerprints() const { return fingerprints_; }
+    const std::vector<std::string_view>& frontier() const { return frontier_; }
+    uint64_t pages_downloaded() const { return pages_downloaded_; }
+    uint64_t metadata_offset() const { return metadata_offset_; }
+
+   private:
+    MappedCheckpoint() = default;
+
+    void* data_ = nullptr;
+    size_t size_ = 0;
+    const uint64_t* fingerprints_ = nullptr;
+    size_t fingerprint_count_ = 0;
+    std::vector<std::string_view> frontier_;
+    uint64_t pages_downloaded_ = 0;
+    uint64_t metadata_offset_ = 0;
+};
+
+}  // namespace crawler
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace crawler {
+
+// A response body's Content-Encoding, limited to those the crawler can undo
+// itself. The values are what segment records store in their flags.
+enum class ContentEncoding : uint32_t { identity = 0, gzip = 1, deflate = 2 };
+
+// The encoding a Content-Encoding header names ("" and "identity" are
+// identity); nullopt for any other encoding or a chain of several.
+std::optional<ContentEncoding> parse_content_encoding(std::string_view header);
+
+const char* content_encoding_name(ContentEncoding encoding);
+
+// Streaming zlib inflate of a gzip or deflate body (zlib-wrapped or raw
+// deflate, as servers send either); identity bodies pass through. Output is
+// capped at `max_output` bytes per body, after which the rest of the input
+// is ignored, so a small compressed body cannot expand without bound.
+class ContentDecoder {
+   public:
+    ContentDecoder();
+    ~ContentDecoder();
+
+    ContentDecoder(const ContentDecoder&) = delete;
+    ContentDecoder& operator=(const ContentDecoder&) = delete;
+
+    void reset(ContentEncoding encoding, uint64_t max_output = UINT64_MAX);
+
+    // Appends what `chunk` decodes to onto `out`. False on corrupt data.
+    bool feed(std::string_view chunk, std::string& out);
+    // The stream has ended or the output cap is reached.
+    bool finished() const { return finished_; }
+
+   private:
+    struct State;
+
+    bool inflate_chunk(std::string_view chunk, std::string& out);
+
+    std::unique_ptr<State> state_;
+    ContentEncoding encoding_ = ContentEncoding::identity;
+    uint64_t output_left_ = 0;
+    // The first bytes of a deflate body, held until they show whether it has
+    // a zlib header.
+    std::string head_;
+    // Set at the end of a gzip member; gap_ then collects the next two
+    // bytes, which tell whether another member follows.
+    bool between_members_ = false;
+    std::string gap_;
+    bool started_ = false;
+    bool finished_ = false;
+};
+
+// Decodes a whole body, up to `max_output` bytes; nullopt when it is corrupt.
+std::optional<std::string> decode_body(ContentEncoding encoding, std::string_view body, uint64_t max_output = UINT64_MAX);
+
+}  // namespace crawler
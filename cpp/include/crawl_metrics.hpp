@@ -0,0 +1,137 @@
+#pragma once
+
+#include "fetch_engine.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace crawler {
+
+// Latency histogram in the style of HdrHistogram: every power of two of
+// microseconds is split into 8 linear sub-buckets, so a recorded value is
+// known to within 12.5% from 1 us up to about 70 minutes (larger values land
+// in the last bucket). Recording is one relaxed atomic increment.
+class LatencyHistogram {
+   public:
+    static constexpr int kSubBucketBits = 3;
+    static constexpr int kSubBuckets = 1 << kSubBucketBits;
+    static constexpr int kBuckets = 31 * kSubBuckets;
+
+    static int bucket_for(int64_t micros);
+    // Smallest value that no longer falls into `bucket`.
+    static int64_t bucket_end(int bucket);
+
+    void record(int64_t micros);
+    // Adds this histogram's counts to `counts` and `sum_us`.
+    void add_to(std::array<uint64_t, kBuckets>& counts, uint64_t& sum_us) const;
+
+   private:
+    std::array<std::atomic<uint64_t>, kBuckets> counts_ {};
+    std::atomic<uint64_t> sum_us_ {0};
+};
+
+enum class Counter {
+    requests,
+    fetch_errors,
+    status_2xx,
+    status_3xx,
+    status_4xx,
+    status_5xx,
+    bytes_received,
+    pages_saved,
+    pages_unchanged,
+    duplicate_checks,
+    exact_duplicates,
+    near_duplicates,
+    urls_discovered,
+    urls_already_seen,
+    urls_out_of_scope,
+    retries,
+    shard_urls_sent,
+    shard_urls_received,
+    documents_extracted,
+    document_extraction_failures,
+    extraction_queue_waits,
+    kCount,
+};
+
+enum class Phase { dns, connect, tls, ttfb, transfer, kCount };
+
+// Point-in-time values that live elsewhere in the crawler.
+struct CrawlGauges {
+    uint64_t frontier = 0;
+    uint64_t in_progress = 0;
+    uint64_t seen_urls = 0;
+    uint64_t pages_downloaded = 0;
+    // Documents waiting for a text extraction thread.
+    uint64_t extraction_queue = 0;
+    // Per-host in-flight limits, indexed like CrawlMetrics::hosts().
+    std::vector<int> host_limits;
+};
+
+// Crawl-wide counters and fetch latency histograms. Each thread writes to
+// its own stripe (threads are dealt stripes round-robin), so the hot path
+// never shares a cache line with another thread; readers sum the stripes.
+// Per-host counters cover the allowed hosts given at construction.
+class CrawlMetrics {
+   public:
+    explicit CrawlMetrics(std::vector<std::string> hosts);
+
+    void add(Counter counter, uint64_t amount = 1);
+    // Status, bytes and phase timings of a finished fetch, overall and for
+    // its host.
+    void record_fetch(const FetchResult& result);
+
+    struct Snapshot {
+        std::array<uint64_t, static_cast<size_t>(Counter::kCount)> counters {};
+        std::array<std::array<uint64_t, LatencyHistogram::kBuckets>, static_cast<size_t>(Phase::kCount)> latency {};
+        std::array<uint64_t, static_cast<size_t>(Phase::kCount)> latency_sum_us {};
+        // Indexed like hosts().
+        std::vector<uint64_t> host_requests;
+        std::vector<uint64_t> host_errors;
+        std::vector<uint64_t> host_bytes;
+
+        uint64_t operator[](Counter counter) const { return counters[static_cast<size_t>(counter)]; }
+        // Upper bound of the bucket holding quantile `q` of `phase`, in
+        // microseconds; 0 without samples.
+        int64_t quantile_us(Phase phase, double q) const;
+    };
+
+    Snapshot snapshot() const;
+    const std::vector<std::string>& hosts() const { return hosts_; }
+
+   private:
+    static constexpr size_t kStripes = 16;
+
+    struct alignas(64) Stripe {
+        std::array<std::atomic<uint64_t>, static_cast<size_t>(Counter::kCount)> counters {};
+        std::array<LatencyHistogram, static_cast<size_t>(Phase::kCount)> latency;
+    };
+
+    struct alignas(64) HostCounters {
+        std::atomic<uint64_t> requests {0};
+        std::atomic<uint64_t> errors {0};
+        std::atomic<uint64_t> bytes {0};
+    };
+
+    Stripe& local_stripe();
+
+    std::vector<std::string> hosts_;
+    std::unique_ptr<HostCounters[]> host_counters_;
+    std::unique_ptr<Stripe[]> stripes_;
+};
+
+// Prometheus text exposition format (version 0.0.4) of a snapshot.
+std::string format_prometheus(const CrawlMetrics& metrics, const CrawlMetrics::Snapshot& snapshot,
+                              const CrawlGauges& gauges);
+
+// One-line progress summary; rates cover the time since `previous`.
+std::string format_stats_line(const CrawlMetrics& metrics, const CrawlMetrics::Snapshot& current,
+                              const CrawlMetrics::Snapshot& previous, double elapsed_seconds, const CrawlGauges& gauges);
+
+}  // namespace crawler
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace crawler {
+
+struct PriorityWeights {
+    // Per link hop from the start URL (subtracted).
+    double depth = 1.0;
+    // Per doubling of the in-links seen so far.
+    double inlinks = 1.0;
+    // Per doubling of the days since the URL was last fetched; URLs never
+    // fetched count as a month old.
+    double staleness = 1.0;
+    // Added when the URL contains the substring.
+    std::vector<std::pair<std::string, double>> patterns;
+};
+
+// Maps what is known about a URL at enqueue time to a HostFrontier priority
+// level: the weighted score, rounded, centred on the middle level.
+class CrawlPriority {
+   public:
+    explicit CrawlPriority(PriorityWeights weights);
+
+    uint8_t level(std::string_view url, int depth, uint32_t inlinks, std::optional<double> age_days) const;
+
+    // Levels a queued URL gains each time its in-link count doubles.
+    int promotion_levels() const { return promotion_levels_; }
+
+   private:
+    PriorityWeights weights_;
+    int promotion_levels_;
+};
+
+// In-link counts of queued URLs, keyed by URL fingerprint. Only URLs being
+// tracked are counted, so memory follows the frontier rather than the crawl.
+// Lock-striped; safe to call concurrently.
+class InlinkCounter {
+   public:
+    void track(uint64_t fingerprint);
+    // Counts one more in-link; returns the new count, or 0 when the URL is
+    // not tracked (never queued, or already fetched).
+    uint32_t add(uint64_t fingerprint);
+    void forget(uint64_t fingerprint);
+
+   private:
+    static constexpr size_t kStripes = 64;
+
+    struct Stripe {
+        std::mutex mutex;
+        std::unordered_map<uint64_t, uint32_t> counts;
+    };
+
+    Stripe& stripe(uint64_t fingerprint) { return stripes_[fingerprint % kStripes]; }
+
+    std::array<Stripe, kStripes> stripes_;
+};
+
+}  // namespace crawler
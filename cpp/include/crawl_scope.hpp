@@ -0,0 +1,37 @@
+#pragma once
+
+#include "robots.hpp"
+#include "url.hpp"
+
+#include <string_view>
+
+namespace crawler {
+
+// Which URLs on the allowed hosts the crawl follows. Include and exclude
+// patterns are matched against the path plus "?query" like robots.txt
+// rules: a plain pattern is a prefix, `*` matches any run of bytes and a
+// final `$` anchors the end. They are compiled into the RobotsRules byte
+// trie, so a check walks the URL once however many prefixes there are. The
+// longest matching pattern wins and include wins ties; once any include is
+// given, URLs matching none are out of scope.
+class CrawlScope {
+   public:
+    enum class Verdict { in_scope, excluded, too_deep, too_many_query_params };
+
+    void include(std::string_view pattern);
+    void exclude(std::string_view pattern);
+    // Links more than `depth` hops from a seed are dropped; -1 for no limit.
+    void set_max_depth(int depth) { max_depth_ = depth; }
+    // URLs with more query parameters than this are dropped; -1 for no limit.
+    void set_max_query_params(int count) { max_query_params_ = count; }
+
+    Verdict check(const CanonicalUrl& url, int depth) const;
+
+   private:
+    RobotsRules rules_;
+    bool restricted_ = false;
+    int max_depth_ = -1;
+    int max_query_params_ = -1;
+};
+
+}  // namespace crawler
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace crawler {
+
+enum class DocumentFormat { none, pdf, docx, pptx, xlsx };
+
+// The format of a non-HTML body, from its content type or, failing that,
+// the URL's extension (".pdf", ...).
+DocumentFormat document_format(std::string_view content_type, std::string_view extension);
+
+// Whether this build extracts text from `format`: OOXML always, PDF only
+// when built with poppler (make POPPLER=1).
+bool can_extract_text(DocumentFormat format);
+
+struct DocumentText {
+    std::string text;
+    size_t word_count = 0;
+};
+
+// Body text with whitespace collapsed like HtmlText: paragraphs of a .docx,
+// slide text of a .pptx in slide order, the strings of an .xlsx, every page
+// of a PDF. nullopt when the document cannot be parsed.
+std::optional<DocumentText> extract_document_text(DocumentFormat format, std::string_view body);
+
+}  // namespace crawler
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace crawler {
+
+struct EmbeddingClientOptions {
+    // An OpenAI-compatible embeddings endpoint.
+    std::string endpoint = "https://api.openai.com/v1/embeddings";
+    std::string api_key;
+    std::string model = "text-embedding-3-small";
+    // Asks the model for shorter vectors; 0 keeps its default size.
+    int dimensions = 0;
+    size_t batch_size = 128;
+    // Ends a batch early once its inputs reach this many bytes.
+    size_t max_batch_bytes = 256 * 1024;
+    // Requests in flight at once, multiplexed over HTTP/2 when the server
+    // speaks it.
+    int concurrency = 8;
+    // Attempts per batch; 429s, 5xx and transport errors are retried with
+    // exponential backoff (or the server's Retry-After).
+    int max_attempts = 6;
+    double timeout_seconds = 120.0;
+    std::string user_agent = "BGSU-Hackathon-Crawler/1.0";
+};
+
+struct EmbeddingStats {
+    size_t requests = 0;
+    size_t retries = 0;
+    size_t failed_inputs = 0;
+};
+
+// Sends inputs to the embedding API in batches, keeping up to `concurrency`
+// requests in flight on one curl multi handle.
+class EmbeddingClient {
+   public:
+    // Called once per embedded input, in completion order, on the calling
+    // thread; `vector` is only valid during the call.
+    using VectorCallback = std::function<void(size_t input, const float* vector, size_t dimensions)>;
+
+    explicit EmbeddingClient(EmbeddingClientOptions options) : options_(std::move(options)) {}
+
+    // Embeds every input it can; inputs that still fail after the retries
+    // are counted in failed_inputs and get no callback.
+    EmbeddingStats embed(const std::vector<std::string>& inputs, const VectorCallback& on_vector) const;
+
+   private:
+    EmbeddingClientOptions options_;
+};
+
+}  // namespace crawler
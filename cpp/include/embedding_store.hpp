@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace crawler {
+
+// Splits whitespace-separated `text` into chunks of up to `chunk_words`
+// words, each starting `chunk_words - overlap_words` words after the one
+// before. The views point into `text`.
+std::vector<std::string_view> chunk_words(std::string_view text, size_t chunk_words, size_t overlap_words);
+
+// Embedding vectors keyed by a hash of the text they embed, so a rerun only
+// pays for text it has not seen. File layout (native endianness):
+//   magic "FGEMB001", uint32_t dimensions, uint32_t model name length,
+//   uint64_t count, the model name, then per vector uint64_t key and
+//   `dimensions` floats
+// Vectors from another model are never mixed in: loading a store written
+// for a different model yields an empty one.
+class EmbeddingStore {
+   public:
+    explicit EmbeddingStore(std::string model) : model_(std::move(model)) {}
+
+    // An empty store when `path` does not exist or holds another model's
+    // vectors; nullopt when it cannot be read.
+    static std::optional<EmbeddingStore> load(const std::filesystem::path& path, std::string model);
+
+    const std::string& model() const { return model_; }
+    size_t dimensions() const { return dimensions_; }
+    size_t size() const { return index_.size(); }
+
+    // The stored vector for `key`, or nullptr.
+    const float* find(uint64_t key) const;
+    // Stores a copy of `vector`, scaled to unit length. The first vector
+    // fixes the dimensions; returns false for one of another length.
+    bool add(uint64_t key, const float* vector, size_t dimensions);
+
+    // Writes the vectors of `keys` that are stored, in that order; other
+    // vectors are dropped from the file.
+    bool save(const std::filesystem::path& path, const std::vector<uint64_t>& keys) const;
+
+   private:
+    std::string model_;
+    size_t dimensions_ = 0;
+    std::vector<float> vectors_;
+    std::unordered_map<uint64_t, size_t> index_;
+};
+
+// Writes `rows` (each `dimensions` floats) as a FAISS IndexFlatIP, readable
+// with faiss.read_index(); on unit vectors its scores are cosine similarity.
+bool write_faiss_flat_index(const std::filesystem::path& path, size_t dimensions, const std::vector<const float*>& rows);
+
+}  // namespace crawler
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace crawler {
+
+// Receives response body bytes as they arrive, after the headers are known.
+// Returning false from write() aborts the transfer.
+class BodySink {
+   public:
+    virtual ~BodySink() = default;
+    virtual bool write(std::string_view chunk) = 0;
+};
+
+struct FetchRequest {
+    std::string url;
+    int attempt = 0;
+    // Validators from a previous crawl; sent as If-None-Match and
+    // If-Modified-Since so unchanged pages come back as 304.
+    std::string etag {};
+    std::string last_modified {};
+    // Link hops from the start URL, and the HostFrontier priority level.
+    int depth = 0;
+    uint8_t priority = 0;
+};
+
+// Where a transfer's time went, in microseconds. Phases a reused
+// connection skips (DNS, connect, TLS) are 0.
+struct TransferTimings {
+    int64_t dns_us = 0;
+    int64_t connect_us = 0;
+    int64_t tls_us = 0;
+    // Request sent until the first response byte.
+    int64_t ttfb_us = 0;
+    // First byte until the transfer finished.
+    int64_t transfer_us = 0;
+};
+
+struct FetchResult {
+    std::string url;
+    int attempt = 0;
+    // Copied from the request.
+    int depth = 0;
+    uint8_t priority = 0;
+    long status = 0;
+    // Only filled when no `open_sink` handler is set (e.g. fetch_once).
+    std::string body;
+    std::string content_type;
+    // As sent; bodies reach the sink still encoded only with raw_encoded.
+    std::string content_encoding;
+    std::string retry_after;
+    std::string etag;
+    std::string last_modified;
+    // Content-Length of the response, -1 when the server did not send one.
+    int64_t content_length = -1;
+    std::unique_ptr<BodySink> sink;
+    TransferTimings timings;
+    // Body bytes received, including those of a transfer cut short.
+    int64_t bytes_received = 0;
+    bool ok = false;
+    // The sink turned the body down; the transfer was cut short on purpose.
+    bool rejected = false;
+};
+
+// libcurl state shared by every handle given the same FetchShare: the DNS
+// cache and TLS sessions, so each host is looked up and fully handshaken
+// once per crawl instead of once per engine thread. Every data kind has its
+// own lock, so a DNS lookup never waits on a TLS session update.
+class FetchShare {
+   public:
+    FetchShare();
+    ~FetchShare();
+
+    FetchShare(const FetchShare&) = delete;
+    FetchShare& operator=(const FetchShare&) = delete;
+
+    // Attaches a CURL easy handle.
+    void attach(void* easy) const;
+
+   private:
+    struct State;
+    std::unique_ptr<State> state_;
+};
+
+struct FetchEngineOptions {
+    int threads = 2;
+    int max_in_flight = 64;
+    long max_host_connections = 8;
+    double timeout_seconds = 20.0;
+    // How long a resolved address is reused; -1 keeps it for the whole run.
+    long dns_cache_seconds = 60;
+    // Offers every Content-Encoding libcurl was built with (gzip, deflate,
+    // br, zstd) and decodes bodies before the sink sees them.
+    bool compressed = true;
+    // Hands bodies to the sink exactly as sent instead, offering only gzip
+    // and deflate, which ContentDecoder can undo. fetch_once always decodes.
+    bool raw_encoded = false;
+    std::string user_agent = "FalconGraphCrawler/1.0";
+    // Handles of the engine and fetch_once calls share this when set.
+    std::shared_ptr<FetchShare> share;
+};
+
+// Performs a single blocking request with the engine's handle settings; used
+// for small setup fetches such as robots.txt before the crawl starts.
+FetchResult fetch_once(const std::string& url, const FetchEngineOptions& options);
+
+// Resolves (and connects to, without sending a request) each origin such as
+// "https://www.bgsu.edu", all at once, so options.share has their addresses
+// and TLS sessions before the crawl starts. Returns how many succeeded.
+size_t preresolve(const std::vector<std::string>& origins, const FetchEngineOptions& options);
+
+// Event-driven fetcher built on curl_multi. Each engine thread owns a multi
+// handle plus a pool of persistent easy handles, so connections (and HTTP/2
+// streams) are reused across requests instead of re-handshaking per URL.
+//
+// The engine pulls work instead of buffering it: whenever a thread has a free
+// slot it calls `next`. When `next` has nothing ready it may lower `wait` to
+// say when to ask again; otherwise the thread sleeps until notify().
+// `open_sink`, when set, is asked for a BodySink once the response headers
+// are in, so bodies are consumed while they stream and never buffered by the
+// engine. Returning nullptr drops the body and aborts the transfer.
+class FetchEngine {
+   public:
+    struct Handlers {
+        std::function<std::optional<FetchRequest>(std::chrono::milliseconds& wait)> next;
+        std::function<void(FetchResult&& result)> done;
+        std::function<std::unique_ptr<BodySink>(const FetchResult& headers)> open_sink;
+    };
+
+    FetchEngine(FetchEngineOptions options, Handlers handlers);
+    ~FetchEngine();
+
+    FetchEngine(const FetchEngine&) = delete;
+    FetchEngine& operator=(const FetchEngine&) = delete;
+
+    void start();
+    void stop();
+
+    // Wakes idle engine threads after new requests became available.
+    void notify();
+
+   private:
+    struct Worker;
+
+    void run_worker(Worker& worker);
+
+    FetchEngineOptions options_;
+    Handlers handlers_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::atomic<bool> stop_ {false};
+};
+
+}  // namespace crawler
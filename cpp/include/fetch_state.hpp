@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace crawler {
+
+// What the last crawl learned about a URL: its cache validators, a hash of
+// the body and where the body was saved (a file path or segment locator).
+struct FetchState {
+    std::string etag;
+    std::string last_modified;
+    uint64_t content_hash = 0;
+    // SimHash of the page text, 0 when it had none.
+    uint64_t simhash = 0;
+    // Empty when the body was not kept (a skipped duplicate).
+    std::string path;
+    std::string content_type;
+    // Unix time of the last successful fetch (200 or 304), 0 if unknown.
+    int64_t fetched_at = 0;
+};
+
+// Per-URL fetch state carried between crawls so a recrawl can send
+// conditional requests and tell changed pages from unchanged ones.
+// Persisted as a TSV: url, etag, last_modified, content_hash (hex), path,
+// content_type, simhash (hex), fetched_at. Thread-safe.
+class FetchStateStore {
+   public:
+    // Loads a previous run's state, dropping entries whose saved file is
+    // gone (they must be fetched unconditionally). Returns the entry count.
+    size_t load(const std::filesystem::path& path);
+
+    // Writes to a temp file and renames it into place.
+    bool save(const std::filesystem::path& path) const;
+
+    std::optional<FetchState> find(const std::string& url) const;
+    void update(const std::string& url, FetchState state);
+    bool erase(const std::string& url);
+    // Visits every entry under a shared lock; `fn` must not call back in.
+    void for_each(const std::function<void(const std::string& url, const FetchState& state)>& fn) const;
+
+    size_t size() const;
+
+   private:
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, FetchState> states_;
+};
+
+}  // namespace crawler
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "link_graph.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace crawler {
+
+struct IterationOptions {
+    int max_iterations = 100;
+    // Stop once the L1 change of the scores between iterations drops below this.
+    double tolerance = 1e-9;
+};
+
+struct PageRankResult {
+    std::vector<double> scores;
+    int iterations = 0;
+};
+
+struct HitsResult {
+    std::vector<double> hubs;
+    std::vector<double> authorities;
+    int iterations = 0;
+};
+
+// The reversed graph: in-links of each node, sources in ascending order.
+CsrGraph transpose(const CsrGraph& graph);
+
+std::vector<uint32_t> out_degrees(const CsrGraph& graph);
+
+// Power iteration in pull form over `incoming` (transpose(graph)), so each
+// node's update only reads and each thread writes its own slice. Dangling
+// nodes spread their rank uniformly; scores sum to 1.
+PageRankResult pagerank(const CsrGraph& graph, const CsrGraph& incoming, double damping, const IterationOptions& options);
+
+// Kleinberg's hubs and authorities, each L2-normalized per iteration.
+HitsResult hits(const CsrGraph& graph, const CsrGraph& incoming, const IterationOptions& options);
+
+}  // namespace crawler
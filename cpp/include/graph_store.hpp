@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace crawler {
+
+// The processed graph as one file meant to be memory-mapped, instead of
+// parsing nodes.json / edges.json. Layout (native endianness, every section
+// starting on an 8-byte boundary):
+//   header         magic "FGGRAPH1", uint64_t node_count, edge_count,
+//                  metric_count, strings_size, then the byte offsets of the
+//                  seven sections below
+//   nodes          node_count records of 8 string refs (url, path,
+//                  content_type, doc_type, title, domain, snippet, text)
+//                  followed by uint32_t word_count, int32_t duplicate_of
+//                  (node index or -1), uint32_t flags, uint32_t reserved
+//   edge offsets   node_count + 1 uint64_t: node i links to targets
+//                  [offsets[i], offsets[i + 1])
+//   edge targets   edge_count uint32_t node indexes
+//   edge anchors   edge_count string refs, the anchor text of each edge
+//   metric names   metric_count string refs
+//   metric values  metric_count columns of node_count doubles (NaN where a
+//                  node has no value)
+//   strings        the bytes all string refs point into
+// A string ref is uint64_t offset into the strings section, uint64_t length.
+struct GraphStoreNode {
+    static constexpr uint32_t kRoot = 1;
+    // Set when the node has a title, which may still be empty.
+    static constexpr uint32_t kHasTitle = 2;
+
+    std::string_view url;
+    std::string_view path;
+    std::string_view content_type;
+    std::string_view doc_type;
+    std::string_view title;
+    std::string_view domain;
+    std::string_view snippet;
+    std::string_view text;
+    uint32_t word_count = 0;
+    int32_t duplicate_of = -1;
+    uint32_t flags = 0;
+};
+
+struct GraphStoreEdge {
+    uint32_t source = 0;
+    uint32_t target = 0;
+    std::string_view anchor;
+};
+
+struct GraphStoreMetric {
+    std::string name;
+    std::vector<double> values;
+};
+
+// Edges may come in any order; within a source they keep the order given.
+bool write_graph_store(const std::filesystem::path& path, const std::vector<GraphStoreNode>& nodes,
+                       std::vector<GraphStoreEdge> edges, const std::vector<GraphStoreMetric>& metrics);
+
+}  // namespace crawler
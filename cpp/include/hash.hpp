@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace crawler {
+
+// Final avalanche step of MurmurHash3; also handy for re-mixing a hash.
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// Fast non-cryptographic 64-bit hash (MurmurHash64A-style: eight bytes per
+// multiply round, then a full avalanche).
+inline uint64_t hash_bytes(std::string_view bytes) {
+    constexpr uint64_t m = 0xc6a4a7935bd1e995ULL;
+    constexpr int r = 47;
+    uint64_t h = 0x9e3779b97f4a7c15ULL ^ (bytes.size() * m);
+    const char* data = bytes.data();
+    size_t blocks = bytes.size() / 8;
+    for (size_t i = 0; i < blocks; ++i) {
+        uint64_t k;
+        std::memcpy(&k, data + i * 8, sizeof(k));
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+    uint64_t tail = 0;
+    if (size_t rest = bytes.size() - blocks * 8) {
+        std::memcpy(&tail, data + blocks * 8, rest);
+    }
+    h ^= tail;
+    h *= m;
+    return mix64(h);
+}
+
+}  // namespace crawler
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "fetch_engine.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace crawler {
+
+// URL frontier with one queue per host. Each host has a next-allowed time
+// that advances by its crawl interval on every pop, so a throttled host never
+// holds up URLs for other hosts and nobody sleeps between requests.
+//
+// Within a host, requests are bucketed by FetchRequest::priority and the
+// highest non-empty bucket goes first, FIFO inside a bucket; with every
+// priority equal this is the plain FIFO frontier. Push, pop and promote are
+// O(1): a bitmask finds the top bucket, and a promoted request just gets a
+// second bucket entry, the stale one being skipped when it comes up.
+//
+// A host can also be capped at a number of requests in flight: it is not
+// popped again until finish() reports one of its requests done. Retries
+// wait in a time-ordered side queue until they are due.
+//
+// Not internally synchronized; the crawler guards it with its frontier lock.
+class HostFrontier {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int kPriorityLevels = 32;
+
+    explicit HostFrontier(double default_interval_seconds);
+
+    // Sets the minimum spacing between request starts for one host.
+    void set_interval(const std::string& host, double seconds);
+
+    void push(const std::string& host, FetchRequest request);
+
+    // Re-queues a request at the head of its host queue.
+    void push_front(const std::string& host, FetchRequest request);
+
+    // Re-queues a request at the head of its host queue once `at` has
+    // passed, e.g. a retry after backoff.
+    void push_later(const std::string& host, FetchRequest request, Clock::time_point at);
+
+    // How many requests to `host` may be in flight at once; 0, the
+    // default, means no limit.
+    void set_limit(const std::string& host, int limit);
+    // Marks one popped request to `host` as done.
+    void finish(const std::string& host);
+
+    // Raises a queued request's priority by `levels`; no-op for URLs not
+    // queued (already popped, or never pushed).
+    void promote(const std::string& host, std::string_view url, int levels);
+
+    // Holds a host off until at least `now + delay` (e.g. for Retry-After).
+    void defer(const std::string& host, Clock::time_point now, Clock::duration delay);
+
+    // Pops the first request from a host whose next-allowed time has passed
+    // and that is under its in-flight limit. When none is ready, lowers
+    // `wait` to the time until the next host opens or retry comes due.
+    std::optional<FetchRequest> pop(Clock::time_point now, std::chrono::milliseconds& wait);
+
+    // Appends the URL of every queued or delayed request, in no particular
+    // order.
+    void append_urls(std::vector<std::string>& out) const;
+
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+
+   private:
+    struct HostQueue {
+        // Queued requests by URL fingerprint; buckets hold fingerprints.
+        std::unordered_map<uint64_t, FetchRequest> requests;
+        std::array<std::deque<uint64_t>, kPriorityLevels> buckets;
+        uint32_t nonempty = 0;
+        Clock::duration interval {};
+        Clock::time_point next_allowed {};
+        bool scheduled = false;
+        int in_flight = 0;
+        int limit = 0;
+    };
+
+    struct Slot {
+        Clock::time_point at;
+        HostQueue* host;
+        bool operator>(const Slot& other) const { return at > other.at; }
+    };
+
+    struct Delayed {
+        Clock::time_point at;
+        std::string host;
+        FetchRequest request;
+        bool operator>(const Delayed& other) const { return at > other.at; }
+    };
+
+    HostQueue& host_queue(const std::string& host);
+    void schedule(HostQueue& queue);
+    void add(HostQueue& queue, FetchRequest request, bool front);
+    std::optional<FetchRequest> take(HostQueue& queue);
+    void release_delayed(Clock::time_point now);
+    void reschedule(HostQueue& queue);
+    static bool saturated(const HostQueue& queue) { return queue.limit > 0 && queue.in_flight >= queue.limit; }
+
+    Clock::duration default_interval_;
+    std::unordered_map<std::string, HostQueue> hosts_;
+    std::priority_queue<Slot, std::vector<Slot>, std::greater<Slot>> ready_;
+    // Min-heap on `at`, kept with std::push_heap/pop_heap so entries can be
+    // moved out.
+    std::vector<Delayed> delayed_;
+    size_t size_ = 0;
+};
+
+}  // namespace crawler
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "url.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace crawler {
+
+// Single-pass HTML tokenizer that collects href/src attribute values.
+//
+// Input may arrive in arbitrary chunks (e.g. straight from a curl write
+// callback); all tokenizer state survives chunk boundaries. Text runs,
+// quoted values and raw-text bodies are skipped with memchr, which glibc
+// dispatches to SSE2/AVX2 scanning. Values are decoded for character
+// references and packed into one buffer, so a page costs a handful of
+// allocations rather than one per link. Comments and <script>/<style>
+// bodies are skipped, so markup inside JavaScript strings is not mistaken
+// for links.
+class LinkExtractor {
+   public:
+    void feed(std::string_view chunk);
+    void reset();
+
+    size_t size() const { return spans_.size(); }
+    std::string_view link(size_t index) const;
+
+    // The href of the first <base> element, if the document has one.
+    std::optional<std::string_view> base_href() const;
+
+   private:
+    enum class State : uint8_t {
+        Data,
+        TagOpen,
+        MarkupDeclaration,
+        Comment,
+        BogusComment,
+        EndTag,
+        TagName,
+        BeforeAttributeName,
+        AttributeName,
+        AfterAttributeName,
+        BeforeAttributeValue,
+        AttributeValueQuoted,
+        AttributeValueUnquoted,
+        RawText,
+    };
+
+    using Span = std::pair<uint32_t, uint32_t>;
+
+    static constexpr size_t kNameCapacity = 8;
+
+    void start_value();
+    void finish_value();
+    void finish_tag();
+    bool tag_is(std::string_view name) const;
+    bool attribute_is(std::string_view name) const;
+
+    State state_ = State::Data;
+    char tag_[kNameCapacity] {};
+    uint8_t tag_length_ = 0;
+    char attribute_[kNameCapacity] {};
+    uint8_t attribute_length_ = 0;
+    char quote_ = '"';
+    bool capture_ = false;
+    uint8_t dashes_ = 0;
+    std::string_view raw_end_;
+    size_t raw_match_ = 0;
+    size_t value_start_ = 0;
+    std::string storage_;
+    std::vector<Span> spans_;
+    std::optional<Span> base_;
+};
+
+// Resolves the extractor's raw href/src values against the page URL, or
+// against the document's <base href> when it has one. Values that do not
+// resolve to an http(s) URL are dropped.
+std::vector<CanonicalUrl> extract_links(const LinkExtractor& extractor, const CanonicalUrl& page,
+                                        const NormalizeOptions& options = {});
+
+// extract_links into storage that outlives the page: meant to be kept per
+// worker and reused, so once its URLs have grown to fit, resolving a page's
+// links allocates nothing.
+class PageLinks {
+   public:
+    void resolve(const LinkExtractor& extractor, const CanonicalUrl& page, const NormalizeOptions& options = {});
+
+    size_t size() const { return size_; }
+    const CanonicalUrl* begin() const { return urls_.data(); }
+    const CanonicalUrl* end() const { return urls_.data() + size_; }
+
+   private:
+    std::vector<CanonicalUrl> urls_;
+    CanonicalUrl base_;
+    size_t size_ = 0;
+};
+
+}  // namespace crawler
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace crawler {
+
+// Readable content of an HTML page, matching what clean_content.py derives
+// with BeautifulSoup: every text node of the document (including <title>)
+// joined by single spaces, with <script>, <style>, <noscript>, <svg> and
+// <template> dropped. Text inside <nav> is left out too, but its anchors
+// are still collected.
+struct HtmlText {
+    std::string title;
+    std::string text;
+    size_t word_count = 0;
+    // Every <a> (navigation included) as its raw href and its text. Each
+    // text node is stripped, then the pieces are joined and cut to 200
+    // characters.
+    std::vector<std::pair<std::string, std::string>> anchors;
+};
+
+// One pass over a complete document; malformed markup is tolerated the way
+// browsers do (unclosed tags simply end at the end of input).
+HtmlText extract_html_text(std::string_view html);
+
+}  // namespace crawler
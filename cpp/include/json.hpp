@@ -0,0 +1,69 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace crawler {
+
+// A parsed JSON document. Objects keep their members in file order; on a
+// duplicate key the later member wins. Numbers are doubles, which holds
+// every integer a config needs exactly.
+class JsonValue {
+   public:
+    enum class Type { null, boolean, number, string, array, object };
+    using Array = std::vector<JsonValue>;
+    using Member = std::pair<std::string, JsonValue>;
+    using Object = std::vector<Member>;
+
+    JsonValue() = default;
+    explicit JsonValue(bool value) : type_(Type::boolean), bool_(value) {}
+    explicit JsonValue(double value) : type_(Type::number), number_(value) {}
+    explicit JsonValue(std::string value) : type_(Type::string), string_(std::move(value)) {}
+    static JsonValue array() { return JsonValue(Type::array); }
+    static JsonValue object() { return JsonValue(Type::object); }
+
+    // Parses a complete document (surrounding whitespace allowed). On a
+    // syntax error returns nullopt and, when `error` is given, sets it to
+    // the problem and its line:column.
+    static std::optional<JsonValue> parse(std::string_view text, std::string* error = nullptr);
+
+    Type type() const { return type_; }
+    bool is_null() const { return type_ == Type::null; }
+    bool is_bool() const { return type_ == Type::boolean; }
+    bool is_number() const { return type_ == Type::number; }
+    bool is_string() const { return type_ == Type::string; }
+    bool is_array() const { return type_ == Type::array; }
+    bool is_object() const { return type_ == Type::object; }
+
+    bool as_bool() const { return bool_; }
+    double as_number() const { return number_; }
+    const std::string& as_string() const { return string_; }
+    const Array& items() const { return items_; }
+    const Object& members() const { return members_; }
+
+    // Member `key` of an object, or nullptr.
+    const JsonValue* find(std::string_view key) const;
+    // Replaces member `key` of an object, appending it if absent.
+    void set(std::string key, JsonValue value);
+    void push_back(JsonValue value) { items_.push_back(std::move(value)); }
+
+   private:
+    explicit JsonValue(Type type) : type_(type) {}
+
+    friend class JsonParser;
+
+    Type type_ = Type::null;
+    bool bool_ = false;
+    double number_ = 0.0;
+    std::string string_;
+    Array items_;
+    Object members_;
+};
+
+// "null", "a boolean", "a number", ... for messages.
+const char* json_type_name(JsonValue::Type type);
+
+}  // namespace crawler
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace crawler {
+
+// Compressed sparse row adjacency: the targets of node i are
+// targets[offsets[i] .. offsets[i + 1]), sorted and without duplicates.
+struct CsrGraph {
+    std::vector<uint64_t> offsets;
+    std::vector<uint32_t> targets;
+
+    size_t node_count() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+    size_t edge_count() const { return targets.size(); }
+};
+
+// Crawl link graph with dense integer node IDs, assigned in discovery
+// order. Thread-safe; IDs and edges are sharded so concurrent pages rarely
+// contend.
+class LinkGraph {
+   public:
+    uint32_t node_id(std::string_view url);
+    void add_edges(uint32_t source, const std::vector<uint32_t>& targets);
+
+    size_t node_count() const;
+    // URLs indexed by node ID.
+    std::vector<std::string> urls() const;
+    CsrGraph build_csr() const;
+
+   private:
+    static constexpr size_t kShards = 64;
+
+    struct NodeShard {
+        mutable std::mutex mutex;
+        std::unordered_map<uint64_t, uint32_t> ids;
+        std::vector<std::pair<uint32_t, std::string>> urls;
+    };
+
+    struct EdgeShard {
+        mutable std::mutex mutex;
+        std::vector<std::pair<uint32_t, uint32_t>> edges;
+    };
+
+    std::array<NodeShard, kShards> nodes_;
+    std::array<EdgeShard, kShards> edges_;
+    std::atomic<uint32_t> next_id_ {0};
+};
+
+// File layout (native endianness): magic "FGCSR001", uint64_t node count,
+// uint64_t edge count, uint64_t offsets[node count + 1], uint32_t
+// targets[edge count]. Written to a temp file and renamed into place.
+bool write_csr(const std::filesystem::path& path, const CsrGraph& graph);
+// Validates the header, offsets and target IDs; nullopt (after logging) for
+// a missing or malformed file.
+std::optional<CsrGraph> read_csr(const std::filesystem::path& path);
+
+// {"start_url", "pages", "node_count", "edge_count", "nodes": [url, ...],
+//  "edges": [[source, target], ...]} with node IDs as array indexes.
+bool write_link_map_json(const std::filesystem::path& path, const std::string& start_url, uint64_t pages,
+                         const std::vector<std::string>& urls, const CsrGraph& graph);
+// The "nodes" array of a link map written by write_link_map_json.
+std::optional<std::vector<std::string>> read_link_map_nodes(const std::filesystem::path& path);
+
+}  // namespace crawler
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace crawler {
+
+// Appends rows to metadata.tsv, delta.tsv and, when enabled, text.ndjson and
+// duplicates.tsv from a single writer thread.
+// Crawl workers push finished lines onto a lock-free MPSC list; the writer
+// drains it in batches into per-file buffers that are written out when they
+// fill up or once per flush interval, so a page costs no syscall. Rows from
+// one producer keep their order.
+class ManifestWriter {
+   public:
+    enum class Stream { metadata, delta, text, duplicates };
+
+    // An empty `text_path` or `duplicates_path` leaves that stream closed;
+    // rows sent to it are dropped.
+    ManifestWriter(const std::filesystem::path& metadata_path, const std::filesystem::path& delta_path,
+                   const std::filesystem::path& text_path = {}, const std::filesystem::path& duplicates_path = {},
+                   std::chrono::milliseconds flush_interval = std::chrono::milliseconds(200));
+    ~ManifestWriter();
+
+    ManifestWriter(const ManifestWriter&) = delete;
+    ManifestWriter& operator=(const ManifestWriter&) = delete;
+
+    // `line` must include its trailing newline. Rows appended after close()
+    // are dropped.
+    void append(Stream stream, std::string line);
+
+    // Resolves to metadata.tsv's size once every row appended before the
+    // call is written and fsynced. `before_sync` runs on the writer thread
+    // first, once those rows are all queued, so data they point to can be
+    // made durable before they are. After close() it resolves to the final
+    // size once close() returns.
+    std::future<uint64_t> mark(std::function<void()> before_sync = {});
+
+    // Writes out and fsyncs everything still queued, resolving pending
+    // marks, and stops the writer thread. Safe to call more than once.
+    void close();
+
+   private:
+    struct Mark {
+        std::promise<uint64_t> offset;
+        std::function<void()> before_sync;
+    };
+
+    struct Node {
+        Node* next = nullptr;
+        Stream stream = Stream::metadata;
+        std::string line;
+        Mark* mark = nullptr;
+    };
+
+    struct File {
+        int fd = -1;
+        uint64_t size = 0;
+        std::string buffer;
+    };
+
+    // False once close() has started; the caller keeps the node.
+    bool push(Node* node);
+    void run();
+    void drain();
+    void flush(File& file, bool sync);
+    void flush_all(bool sync);
+    File& file(Stream stream) { return files_[static_cast<size_t>(stream)]; }
+
+    std::atomic<Node*> head_ {nullptr};
+    // Pushes that passed the closed_ check and may still be linking a node.
+    std::atomic<int> pushing_ {0};
+    std::atomic<bool> closed_ {false};
+    // Held for all of close(), so a late mark() sees the final sizes.
+    std::mutex close_mutex_;
+    // Indexed by Stream.
+    std::array<File, 4> files_;
+    std::chrono::milliseconds flush_interval_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    bool wake_requested_ = false;
+    bool stop_ = false;
+    std::thread thread_;
+};
+
+// Calls fn(url, path, content_type) for each row of metadata.tsv, or only
+// for rows starting at byte `offset`.
+template <typename Fn>
+void for_each_metadata_row(const std::filesystem::path& metadata_path, Fn&& fn, uint64_t offset = 0) {
+    std::ifstream meta(metadata_path);
+    std::string line;
+    if (offset > 0) {
+        meta.seekg(static_cast<std::streamoff>(offset));
+    } else {
+        std::getline(meta, line);
+    }
+    while (std::getline(meta, line)) {
+        auto first_tab = line.find('\t');
+        auto second_tab = first_tab == std::string::npos ? std::string::npos : line.find('\t', first_tab + 1);
+        if (second_tab == std::string::npos) {
+            continue;
+        }
+        fn(line.substr(0, first_tab), line.substr(first_tab + 1, second_tab - first_tab - 1), line.substr(second_tab + 1));
+    }
+}
+
+}  // namespace crawler
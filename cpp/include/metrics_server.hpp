@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace crawler {
+
+// Minimal HTTP server for a Prometheus scrape endpoint: answers
+// `GET /metrics` with whatever `render` returns and 404s anything else.
+// One background thread serves connections one at a time, which is plenty
+// for a scraper polling every few seconds.
+class MetricsServer {
+   public:
+    explicit MetricsServer(std::function<std::string()> render);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // Binds `address:port` and starts serving; false (after logging) when
+    // the socket cannot be set up.
+    bool start(const std::string& address, int port);
+    void stop();
+
+   private:
+    void serve();
+    void handle(int client);
+
+    std::function<std::string()> render_;
+    int listener_ = -1;
+    std::thread thread_;
+    std::atomic<bool> stop_ {false};
+};
+
+}  // namespace crawler
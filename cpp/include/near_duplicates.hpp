@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace crawler {
+
+// 64-bit SimHash of the text's overlapping three-word shingles (words are
+// runs of letters and digits, ASCII-lowercased). Texts that share most of
+// their shingles get hashes a few bits apart. Nullopt for texts with too few
+// words for the hash to mean anything.
+std::optional<uint64_t> simhash(std::string_view text);
+
+inline int hamming_distance(uint64_t a, uint64_t b) {
+    return __builtin_popcountll(a ^ b);
+}
+
+struct DuplicateMatch {
+    std::string url;
+    // Byte-identical body; otherwise a SimHash match `distance` bits away.
+    bool exact = false;
+    int distance = 0;
+};
+
+// Content fingerprints of kept pages, for flagging later pages that repeat
+// one: exactly (same body hash) or nearly (SimHash within `max_distance`
+// bits). Near matches are found with the usual band index: the 64 bits are
+// cut into max_distance + 1 bands, and any hash within the distance shares
+// at least one band exactly with the query, so only those candidates are
+// compared. Each URL holds at most one entry, its latest kept content.
+// Thread-safe.
+class DuplicateIndex {
+   public:
+    explicit DuplicateIndex(int max_distance = 3);
+
+    // The kept page `url` duplicates, if any; otherwise records `url` as
+    // kept and returns nullopt. Whatever `url` held before is dropped first,
+    // so a changed page is matched, and matched against, by its new content
+    // only, and a page that now duplicates another is no longer kept.
+    std::optional<DuplicateMatch> find_or_insert(const std::string& url, uint64_t content_hash, std::optional<uint64_t> simhash);
+    // Forgets `url`, e.g. once the page is gone.
+    void remove(const std::string& url);
+
+    size_t size() const;
+
+   private:
+    struct Band {
+        int shift;
+        uint64_t mask;
+    };
+
+    struct Entry {
+        std::string url;
+        uint64_t content_hash = 0;
+        std::optional<uint64_t> simhash;
+    };
+
+    std::optional<DuplicateMatch> find(uint64_t content_hash, std::optional<uint64_t> simhash) const;
+    uint64_t band_key(size_t band, uint64_t simhash) const;
+    // Called with mutex_ held.
+    void erase_locked(const std::string& url);
+
+    int max_distance_;
+    std::vector<Band> bands_;
+    mutable std::mutex mutex_;
+    // Slots of removed entries are reused; free_ lists them.
+    std::vector<Entry> entries_;
+    std::vector<uint32_t> free_;
+    std::unordered_map<std::string, uint32_t> slots_;
+    // Content hash -> slots, and per band: band value -> slots.
+    std::unordered_map<uint64_t, std::vector<uint32_t>> exact_;
+    std::vector<std::unordered_map<uint64_t, std::vector<uint32_t>>> band_tables_;
+};
+
+}  // namespace crawler
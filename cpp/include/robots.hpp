@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace crawler {
+
+// Allow/Disallow rules of one robots.txt group, compiled for fast checks.
+// Plain path prefixes live in a byte trie walked once per URL; the rare
+// rules with `*` or a trailing `$` are matched separately. As in RFC 9309
+// the longest matching rule wins and Allow wins ties.
+class RobotsRules {
+   public:
+    void add(std::string_view pattern, bool allow);
+
+    // `target` is the URL's path plus "?query", as in the request line.
+    bool allowed(std::string_view target) const;
+
+    bool empty() const { return nodes_.size() == 1 && patterns_.empty(); }
+
+   private:
+    enum Rule : int8_t { kNone = -1, kDisallow = 0, kAllow = 1 };
+
+    struct Node {
+        char byte = 0;
+        Rule rule = kNone;
+        // Indexes into nodes_; 0 (the root) doubles as "none".
+        uint32_t first_child = 0;
+        uint32_t next_sibling = 0;
+    };
+
+    struct Pattern {
+        std::string text;
+        bool allow;
+    };
+
+    std::vector<Node> nodes_ {Node {}};
+    std::vector<Pattern> patterns_;
+};
+
+struct RobotsPolicy {
+    std::optional<double> crawl_delay_seconds;
+    RobotsRules rules;
+    // Sitemap: lines, which apply to every user agent.
+    std::vector<std::string> sitemaps;
+};
+
+// Parses a robots.txt body for the group that applies to `agent` (falling
+// back to the `*` group).
+RobotsPolicy parse_robots(std::string_view body, std::string_view agent);
+
+}  // namespace crawler
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "hash.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace crawler {
+
+// 64-bit hash of a canonical URL. With n URLs the chance of any collision is
+// about n^2 / 2^65, i.e. ~3e-6 for ten million URLs.
+inline uint64_t url_fingerprint(std::string_view url) {
+    return hash_bytes(url);
+}
+
+// Set of URL fingerprints for crawl dedupe, at 8 bytes per slot instead of a
+// heap-allocated string node per URL.
+//
+// Fingerprints are spread over lock-striped open-addressing tables. Entries
+// are never removed, so lookups probe without locking: a fingerprint found in
+// a table is definitely present, and only a miss takes the stripe lock to
+// confirm and insert. Tables replaced by growth stay alive until destruction
+// so concurrent readers never touch freed memory; size `expected` to the
+// crawl to keep that overhead away.
+//
+// The optional blocked Bloom filter lets new URLs skip the table probe: a
+// Bloom miss (one cache line) proves the URL is unseen and goes straight to
+// the locked insert.
+class SeenSet {
+   public:
+    explicit SeenSet(size_t expected = size_t {1} << 20, bool bloom_filter = false);
+    ~SeenSet();
+
+    SeenSet(const SeenSet&) = delete;
+    SeenSet& operator=(const SeenSet&) = delete;
+
+    // Returns true if the URL was not in the set before.
+    bool insert(std::string_view url) { return insert_fingerprint(url_fingerprint(url)); }
+    bool contains(std::string_view url) const { return contains_fingerprint(url_fingerprint(url)); }
+
+    bool insert_fingerprint(uint64_t fingerprint);
+    bool contains_fingerprint(uint64_t fingerprint) const;
+
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+    // Copies out every fingerprint, e.g. for a checkpoint. Inserts racing
+    // with the copy may or may not be included.
+    std::vector<uint64_t> fingerprints() const;
+
+   private:
+    struct Table {
+        explicit Table(size_t capacity);
+        size_t mask;
+        std::unique_ptr<std::atomic<uint64_t>[]> slots;
+    };
+
+    struct alignas(64) Stripe {
+        std::mutex mutex;
+        std::atomic<const Table*> table {nullptr};
+        size_t count = 0;
+        std::vector<std::unique_ptr<Table>> generations;
+    };
+
+    class BloomFilter;
+
+    static constexpr int kStripeBits = 6;
+    static constexpr size_t kStripes = size_t {1} << kStripeBits;
+
+    static bool probe(const Table& table, uint64_t fingerprint);
+    static bool place(Table& table, uint64_t fingerprint);
+    void grow(Stripe& stripe);
+
+    Stripe stripes_[kStripes];
+    std::unique_ptr<BloomFilter> bloom_;
+    std::atomic<size_t> size_ {0};
+};
+
+// Direct-mapped cache of fingerprints already in a SeenSet, meant to be kept
+// per thread. Nothing leaves a SeenSet, so a hit proves the URL was seen
+// without touching the shared tables; a miss proves nothing. The links of
+// neighbouring pages (navigation, footers) mostly hit.
+class RecentFingerprints {
+   public:
+    bool contains(uint64_t fingerprint) const { return slots_[slot(fingerprint)] == stored(fingerprint); }
+    void insert(uint64_t fingerprint) { slots_[slot(fingerprint)] = stored(fingerprint); }
+
+   private:
+    static constexpr size_t kSlots = 4096;
+
+    // Slot value 0 marks an empty slot, as in SeenSet.
+    static uint64_t stored(uint64_t fingerprint) { return fingerprint == 0 ? 1 : fingerprint; }
+    static size_t slot(uint64_t fingerprint) { return static_cast<size_t>(fingerprint) & (kSlots - 1); }
+
+    std::array<uint64_t, kSlots> slots_ {};
+};
+
+}  // namespace crawler
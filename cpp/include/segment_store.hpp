@@ -0,0 +1,85 @@
+#pragma once
+
+#include "content_decoder.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace crawler {
+
+// Crawled bodies packed into append-only segment files instead of one file
+// per URL. Segment layout (native endianness):
+//   header      magic "FGSEG001"
+//   per record  magic "FGR1", uint32_t url length, uint32_t content type
+//               length, uint32_t flags (the body's ContentEncoding: 0 as
+//               is, 1 gzip, 2 deflate), uint64_t body length, then url,
+//               content type and body, zero-padded to 8 bytes
+// A record is addressed by a locator "<segment path>@<byte offset>", which
+// is what metadata.tsv stores in its path column.
+struct SegmentRecord {
+    std::string url;
+    std::string content_type;
+    // Bytes as stored, still in `encoding`.
+    std::string body;
+    ContentEncoding encoding = ContentEncoding::identity;
+};
+
+// Thread-safe; appenders only serialize on reserving space, the writes
+// themselves run in parallel. Each writer starts a fresh segment, numbered
+// after those already in `dir`, and rolls over once one passes `max_bytes`.
+class SegmentWriter {
+   public:
+    SegmentWriter(std::filesystem::path dir, uint64_t max_bytes);
+    ~SegmentWriter();
+
+    SegmentWriter(const SegmentWriter&) = delete;
+    SegmentWriter& operator=(const SegmentWriter&) = delete;
+
+    // Returns the new record's locator, or nullopt if it could not be written.
+    std::optional<std::string> append(std::string_view url, std::string_view content_type, std::string_view body,
+                                      ContentEncoding encoding = ContentEncoding::identity);
+    // Same, copying the body's `length` bytes from the start of `body_fd`.
+    std::optional<std::string> append_file(std::string_view url, std::string_view content_type, int body_fd, uint64_t length,
+                                           ContentEncoding encoding = ContentEncoding::identity);
+    // fsyncs every segment, so each record whose append returned before the
+    // call is on disk; false if any sync failed.
+    bool sync();
+
+   private:
+    struct Slot {
+        int fd = -1;
+        uint64_t offset = 0;
+        std::string path;
+    };
+
+    bool open_next_segment();
+    std::optional<Slot> reserve(uint64_t length);
+
+    std::filesystem::path dir_;
+    uint64_t max_bytes_;
+    std::mutex mutex_;
+    // Earlier segments stay open: appends reserved in them may still be writing.
+    std::vector<int> fds_;
+    std::string current_path_;
+    uint64_t current_size_ = 0;
+    unsigned next_index_ = 0;
+};
+
+bool is_segment_locator(std::string_view location);
+
+// The file a saved-body location lives in: the segment for a locator, the
+// location itself for a plain file path.
+std::filesystem::path location_file(std::string_view location);
+
+std::optional<SegmentRecord> read_segment_record(std::string_view locator);
+
+// Reads a body saved by an earlier crawl, from a segment or a plain file,
+// decoded if it was stored compressed; empty when it cannot be read.
+std::string read_saved_body(const std::string& location);
+
+}  // namespace crawler
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "url.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace crawler {
+
+// Which of `count` shards owns a URL: a hash of its host and path, so the
+// query variants of one page land together.
+int shard_of(const CanonicalUrl& url, int count);
+
+// File queue between the shards of one crawl, under a directory every shard
+// can reach (a local disk for processes on one box, a shared mount across
+// nodes). URLs for another shard are batched in memory and written as one
+// file into that shard's inbox/ directory, renamed into place when
+// complete; each shard drains its own inbox.
+//
+// Termination: every shard publishes a state file with whether it is idle,
+// how many URLs it has taken in, and how many it has sent to each shard.
+// The crawl is over when all shards are idle (or stopped) and every live
+// shard has received all that was sent to it, unchanged over two polls.
+class ShardExchange {
+   public:
+    ShardExchange(std::filesystem::path dir, int count, int index);
+
+    int count() const { return count_; }
+    int index() const { return index_; }
+
+    // Buffers `url` for `shard`. Thread-safe.
+    void forward(int shard, std::string_view url, int depth);
+    // Writes out every buffered batch.
+    void flush();
+
+    // Hands each URL in this shard's inbox to `on_url` and deletes the
+    // files. Call from one thread.
+    size_t receive(const std::function<void(std::string_view url, int depth)>& on_url);
+
+    // Writes this shard's state file; `stopped` is final (e.g. max_pages
+    // reached), after which messages to it are left queued.
+    void publish(bool idle, bool stopped = false);
+    // True once the whole crawl has terminated (see above).
+    bool finished();
+
+   private:
+    struct Batch {
+        std::string lines;
+        uint64_t urls = 0;
+    };
+
+    std::filesystem::path inbox(int shard) const;
+    bool write_batch(int shard, const std::string& lines);
+
+    std::filesystem::path dir_;
+    int count_;
+    int index_;
+    // Per-run prefix keeps batch names unique across restarts.
+    std::string run_id_;
+    uint64_t next_batch_ = 0;
+    std::mutex mutex_;
+    std::vector<Batch> outbox_;
+    std::vector<uint64_t> sent_;
+    uint64_t received_ = 0;
+    std::string last_view_;
+};
+
+}  // namespace crawler
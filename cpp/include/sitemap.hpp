@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace crawler {
+
+struct SitemapEntry {
+    std::string loc;
+    // <lastmod> as Unix time, when present and well-formed.
+    std::optional<int64_t> lastmod;
+};
+
+// A sitemaps.org <urlset> (page entries) or <sitemapindex> (entries naming
+// further sitemaps). Only <loc> and <lastmod> are read.
+struct Sitemap {
+    bool is_index = false;
+    std::vector<SitemapEntry> entries;
+};
+
+Sitemap parse_sitemap(std::string_view xml);
+
+// W3C Datetime (YYYY, YYYY-MM, YYYY-MM-DD, or with Thh:mm[:ss[.s]] and a
+// Z/+hh:mm offset) as Unix time.
+std::optional<int64_t> parse_w3c_datetime(std::string_view value);
+
+}  // namespace crawler
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace crawler {
+
+// Locale-independent ASCII classification, for parsers that must not
+// depend on <cctype>'s locale or its int/EOF argument.
+inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+inline bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+inline char ascii_lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+inline bool is_alpha(char c) {
+    char l = ascii_lower(c);
+    return l >= 'a' && l <= 'z';
+}
+
+// The value of a hex digit, or -1.
+inline int hex_value(char c) {
+    if (is_digit(c)) {
+        return c - '0';
+    }
+    char l = ascii_lower(c);
+    return l >= 'a' && l <= 'f' ? l - 'a' + 10 : -1;
+}
+
+// Appends `code` as UTF-8; surrogates and values past U+10FFFF, which have
+// no encoding, become U+FFFD.
+inline void append_utf8(std::string& out, uint32_t code) {
+    if ((code >= 0xD800 && code <= 0xDFFF) || code >= 0x110000) {
+        out += "\xEF\xBF\xBD";
+    } else if (code < 0x80) {
+        out.push_back(static_cast<char>(code));
+    } else if (code < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (code >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+}
+
+// Appends `text` with HTML/XML character references decoded: numeric ones
+// and the named entities common in pages. &#0; and references with no
+// character become U+FFFD, as in HTML5; unknown or malformed references
+// are kept as written.
+inline void append_decoded(std::string& out, std::string_view text) {
+    struct Entity {
+        std::string_view name;
+        std::string_view utf8;
+    };
+    static constexpr Entity kEntities[] = {
+        {"amp", "&"},         {"lt", "<"},          {"gt", ">"},          {"quot", "\""},
+        {"apos", "'"},        {"nbsp", "\xC2\xA0"}, {"copy", "\xC2\xA9"}, {"reg", "\xC2\xAE"},
+        {"trade", "\xE2\x84\xA2"}, {"mdash", "\xE2\x80\x94"}, {"ndash", "\xE2\x80\x93"}, {"hellip", "\xE2\x80\xA6"},
+        {"lsquo", "\xE2\x80\x98"}, {"rsquo", "\xE2\x80\x99"}, {"ldquo", "\xE2\x80\x9C"}, {"rdquo", "\xE2\x80\x9D"},
+        {"middot", "\xC2\xB7"}, {"bull", "\xE2\x80\xA2"}, {"laquo", "\xC2\xAB"}, {"raquo", "\xC2\xBB"},
+    };
+    size_t i = 0;
+    while (i < text.size()) {
+        size_t amp = text.find('&', i);
+        if (amp == std::string_view::npos) {
+            out.append(text.substr(i));
+            return;
+        }
+        out.append(text.substr(i, amp - i));
+        size_t semi = text.find(';', amp + 1);
+        if (semi == std::string_view::npos || semi - amp > 10) {
+            out.push_back('&');
+            i = amp + 1;
+            continue;
+        }
+        std::string_view name = text.substr(amp + 1, semi - amp - 1);
+        bool decoded = false;
+        if (name.size() > 1 && name[0] == '#') {
+            bool hex = name[1] == 'x' || name[1] == 'X';
+            std::string_view digits = name.substr(hex ? 2 : 1);
+            uint32_t code = 0;
+            decoded = !digits.empty();
+            for (char c : digits) {
+                int value = hex ? hex_value(c) : (is_digit(c) ? c - '0' : -1);
+                if (value < 0) {
+                    decoded = false;
+                    break;
+                }
+                // Saturate; anything this large is out of range anyway.
+                code = std::min<uint32_t>(code * (hex ? 16 : 10) + static_cast<uint32_t>(value), 0x110000);
+            }
+            if (decoded) {
+                append_utf8(out, code == 0 ? 0xFFFD : code);
+            }
+        } else {
+            for (const auto& entity : kEntities) {
+                if (entity.name == name) {
+                    out.append(entity.utf8);
+                    decoded = true;
+                    break;
+                }
+            }
+        }
+        if (decoded) {
+            i = semi + 1;
+        } else {
+            out.push_back('&');
+            i = amp + 1;
+        }
+    }
+}
+
+inline std::string to_lower(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return value;
+}
+
+inline std::string trim(const std::string& input) {
+    size_t start = input.find_first_not_of(" \t\n\r");
+    size_t end = input.find_last_not_of(" \t\n\r");
+    if (start == std::string::npos || end == std::string::npos) {
+        return "";
+    }
+    return input.substr(start, end - start + 1);
+}
+
+inline std::string_view trim_view(std::string_view input) {
+    size_t start = input.find_first_not_of(" \t\n\r");
+    size_t end = input.find_last_not_of(" \t\n\r");
+    if (start == std::string_view::npos || end == std::string_view::npos) {
+        return {};
+    }
+    return input.substr(start, end - start + 1);
+}
+
+inline bool starts_with_icase(std::string_view value, std::string_view prefix) {
+    if (value.size() < prefix.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < prefix.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(value[i])) != std::tolower(static_cast<unsigned char>(prefix[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Appends `value` as a quoted JSON string. Bytes >= 0x80 pass through, so
+// UTF-8 input stays UTF-8.
+inline void append_json_string(std::string& out, std::string_view value) {
+    static constexpr char kHex[] = "0123456789abcdef";
+    out.push_back('"');
+    for (char c : value) {
+        switch (c) {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out += "\\u00";
+                    out.push_back(kHex[(c >> 4) & 0xF]);
+                    out.push_back(kHex[c & 0xF]);
+                } else {
+                    out.push_back(c);
+                }
+        }
+    }
+    out.push_back('"');
+}
+
+}  // namespace crawler
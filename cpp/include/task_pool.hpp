@@ -0,0 +1,44 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace crawler {
+
+// A fixed set of threads running queued tasks, with at most `capacity`
+// tasks waiting. submit() blocks while the queue is full, which keeps a slow
+// stage from buffering without bound and instead slows whoever feeds it.
+class BoundedTaskPool {
+   public:
+    BoundedTaskPool(int threads, size_t capacity);
+    ~BoundedTaskPool();
+
+    BoundedTaskPool(const BoundedTaskPool&) = delete;
+    BoundedTaskPool& operator=(const BoundedTaskPool&) = delete;
+
+    // Queues `task`, waiting for room first; returns whether it had to wait.
+    bool submit(std::function<void()> task);
+
+    size_t queued() const;
+
+    // Runs every task already queued, then stops the threads.
+    void close();
+
+   private:
+    void run();
+
+    size_t capacity_;
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::deque<std::function<void()>> tasks_;
+    bool closed_ = false;
+    std::vector<std::thread> threads_;
+};
+
+}  // namespace crawler
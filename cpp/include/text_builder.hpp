@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace crawler {
+
+// Byte length of the whitespace character at text[i], or 0. Covers the
+// Unicode spaces Python's str.split() breaks on that occur in real pages.
+size_t space_length(std::string_view text, size_t i);
+
+// Collapses runs of whitespace to one space while counting words.
+struct TextBuilder {
+    std::string out;
+    size_t words = 0;
+    bool pending_space = false;
+
+    void separate() { pending_space = true; }
+    void add(std::string_view text);
+};
+
+}  // namespace crawler
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace crawler {
+
+// Components of an RFC 3986 URI reference. Views point into the parsed
+// string; absent components are empty with their has_* flag cleared.
+struct UrlView {
+    std::string_view scheme;
+    std::string_view host;
+    std::string_view port;
+    std::string_view path;
+    std::string_view query;
+    std::string_view fragment;
+    bool has_scheme = false;
+    bool has_authority = false;
+    bool has_query = false;
+    bool has_fragment = false;
+};
+
+// Splits a URI reference without allocating. Fails only on a malformed
+// authority (e.g. a non-numeric port).
+std::optional<UrlView> parse_url(std::string_view reference);
+
+struct NormalizeOptions {
+    bool sort_query = false;
+    // Query parameters to drop (session IDs, tracking tags), by lowercase
+    // name; a trailing `*` matches every name with that prefix ("utm_*").
+    std::vector<std::string> strip_query_params;
+};
+
+// A normalized absolute http(s) URL plus the offsets of its parts, so the
+// canonical key is produced once and never re-parsed.
+//
+// Normalization lowercases the scheme and host, drops default ports and the
+// fragment, resolves "." and ".." segments, upper-cases percent escapes and
+// decodes escaped unreserved characters, percent-encodes bytes that are not
+// allowed in URLs and, optionally, strips some query parameters and sorts the
+// rest by name.
+class CanonicalUrl {
+   public:
+    const std::string& str() const { return text_; }
+    std::string_view scheme() const { return std::string_view(text_).substr(0, scheme_end_); }
+    // host[:port]; the key for allowed_domains and per-host politeness.
+    std::string_view authority() const { return std::string_view(text_).substr(authority_begin_, path_begin_ - authority_begin_); }
+    std::string_view path() const { return std::string_view(text_).substr(path_begin_, path_end_ - path_begin_); }
+    std::string_view query() const;
+
+   private:
+    friend bool resolve_url_into(CanonicalUrl&, const CanonicalUrl*, std::string_view, const NormalizeOptions&);
+
+    std::string text_;
+    uint32_t scheme_end_ = 0;
+    uint32_t authority_begin_ = 0;
+    uint32_t path_begin_ = 0;
+    uint32_t path_end_ = 0;
+};
+
+// Resolves `reference` against `base` (RFC 3986 section 5.2) and normalizes
+// the result. Returns nullopt for non-http(s) targets such as mailto:,
+// javascript: or tel:, and for relative references without a base.
+std::optional<CanonicalUrl> resolve_url(const CanonicalUrl* base, std::string_view reference, const NormalizeOptions& options = {});
+
+// resolve_url into an existing CanonicalUrl, reusing its buffer, so a
+// caller resolving many links allocates only when a URL outgrows it.
+// `out` must not be `base`; on false its contents are unspecified.
+bool resolve_url_into(CanonicalUrl& out, const CanonicalUrl* base, std::string_view reference,
+                      const NormalizeOptions& options = {});
+
+inline std::optional<CanonicalUrl> canonicalize_url(std::string_view absolute, const NormalizeOptions& options = {}) {
+    return resolve_url(nullptr, absolute, options);
+}
+
+// Lowercased extension of the last path segment, including the dot.
+std::string extension_from_url(const CanonicalUrl& url);
+
+bool query_indicates_download(const CanonicalUrl& url);
+
+// Flat file name for a URL: prefix__authority_path_query with every run of
+// characters outside [A-Za-z0-9._-] collapsed to '_'.
+std::string sanitize_filename(const CanonicalUrl& url, const std::string& extension, const std::string& prefix);
+
+}  // namespace crawler
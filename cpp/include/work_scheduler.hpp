@@ -0,0 +1,179 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace crawler {
+
+// Per-worker deques with work stealing and blocking idle workers.
+//
+// Every pushed task counts as pending until the worker that popped it calls
+// task_done(). Children of a task are pushed before the parent completes, so
+// pending_ only reaches zero once no queued or running task remains, which is
+// the exact termination point for a crawl. Work that lives outside the deques
+// (a URL waiting for or undergoing a fetch) is counted through retain() and
+// release() so it holds termination off the same way.
+template <typename Task>
+class WorkStealingScheduler {
+   public:
+    explicit WorkStealingScheduler(int workers) {
+        int count = workers > 0 ? workers : 1;
+        queues_.reserve(static_cast<size_t>(count));
+        for (int i = 0; i < count; ++i) {
+            queues_.push_back(std::make_unique<WorkerQueue>());
+        }
+    }
+
+    int workers() const { return static_cast<int>(queues_.size()); }
+
+    // Pushes onto the given worker's deque; out-of-range workers (e.g. -1 for
+    // the seeding thread) are spread round-robin.
+    void push(int worker, Task task) {
+        pending_.fetch_add(1);
+        WorkerQueue& queue = *queues_[slot_for(worker)];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        queued_.fetch_add(1);
+        wake_one();
+    }
+
+    // Blocks until a task is available. Returns nullopt once all work has
+    // completed or stop() was called.
+    std::optional<Task> pop(int worker) {
+        size_t self = slot_for(worker);
+        while (true) {
+            if (stop_.load()) {
+                return std::nullopt;
+            }
+            if (auto task = take_local(self)) {
+                return task;
+            }
+            if (auto task = steal(self)) {
+                return task;
+            }
+            std::unique_lock<std::mutex> lock(park_mutex_);
+            sleepers_.fetch_add(1);
+            park_cv_.wait(lock, [this] { return stop_.load() || queued_.load() > 0 || pending_.load() == 0; });
+            sleepers_.fetch_sub(1);
+            if (!stop_.load() && queued_.load() == 0 && pending_.load() == 0) {
+                return std::nullopt;
+            }
+        }
+    }
+
+    // Marks a popped task as finished. The last completion wakes every parked
+    // worker so they can observe termination.
+    void task_done() {
+        if (pending_.fetch_sub(1) == 1) {
+            wake_all();
+        }
+    }
+
+    void retain() { pending_.fetch_add(1); }
+
+    void release() { task_done(); }
+
+    void stop() {
+        stop_.store(true);
+        wake_all();
+    }
+
+    bool stopped() const { return stop_.load(); }
+
+    // Queued, running and retained work; zero once the crawl is over.
+    long pending() const { return pending_.load(); }
+
+   private:
+    struct alignas(64) WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    size_t slot_for(int worker) {
+        if (worker >= 0 && worker < workers()) {
+            return static_cast<size_t>(worker);
+        }
+        return next_slot_.fetch_add(1) % queues_.size();
+    }
+
+    // Owners pop from the front so each deque drains in discovery order;
+    // thieves take from the back so they rarely meet the owner at the same end.
+    std::optional<Task> take_local(size_t self) {
+        WorkerQueue& queue = *queues_[self];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            return std::nullopt;
+        }
+        Task task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        queued_.fetch_sub(1);
+        return task;
+    }
+
+    // Steals half of the first non-empty victim's deque: one task is returned
+    // and the rest move to the thief's own deque, amortizing the steal.
+    std::optional<Task> steal(size_t self) {
+        size_t count = queues_.size();
+        for (size_t offset = 1; offset < count; ++offset) {
+            WorkerQueue& victim = *queues_[(self + offset) % count];
+            std::deque<Task> loot;
+            {
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                size_t available = victim.tasks.size();
+                if (available == 0) {
+                    continue;
+                }
+                size_t take = (available + 1) / 2;
+                for (size_t i = 0; i < take; ++i) {
+                    loot.push_front(std::move(victim.tasks.back()));
+                    victim.tasks.pop_back();
+                }
+            }
+            Task task = std::move(loot.front());
+            loot.pop_front();
+            queued_.fetch_sub(1);
+            if (!loot.empty()) {
+                WorkerQueue& mine = *queues_[self];
+                std::lock_guard<std::mutex> lock(mine.mutex);
+                for (auto& item : loot) {
+                    mine.tasks.push_back(std::move(item));
+                }
+            }
+            return task;
+        }
+        return std::nullopt;
+    }
+
+    // queued_ is raised before sleepers_ is read and a parker raises sleepers_
+    // before re-checking queued_, so one side always sees the other.
+    void wake_one() {
+        if (sleepers_.load() > 0) {
+            std::lock_guard<std::mutex> lock(park_mutex_);
+            park_cv_.notify_one();
+        }
+    }
+
+    void wake_all() {
+        std::lock_guard<std::mutex> lock(park_mutex_);
+        park_cv_.notify_all();
+    }
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::atomic<long> pending_ {0};
+    std::atomic<long> queued_ {0};
+    std::atomic<int> sleepers_ {0};
+    std::atomic<size_t> next_slot_ {0};
+    std::atomic<bool> stop_ {false};
+    std::mutex park_mutex_;
+    std::condition_variable park_cv_;
+};
+
+}  // namespace crawler
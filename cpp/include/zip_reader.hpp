@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace crawler {
+
+// Read-only view of a ZIP archive held in memory, enough for OOXML
+// documents: stored and deflated entries found through the central
+// directory. ZIP64 and encrypted entries are not supported. `data` must
+// outlive the archive.
+class ZipArchive {
+   public:
+    struct Entry {
+        std::string name;
+        uint16_t method = 0;
+        uint16_t flags = 0;
+        uint32_t compressed_size = 0;
+        uint32_t size = 0;
+        uint32_t local_header_offset = 0;
+    };
+
+    // nullopt when `data` has no readable central directory.
+    static std::optional<ZipArchive> open(std::string_view data);
+
+    const std::vector<Entry>& entries() const { return entries_; }
+    const Entry* find(std::string_view name) const;
+
+    // The entry's uncompressed contents; nullopt when it is corrupt, uses an
+    // unsupported method, or is larger than `max_bytes`.
+    std::optional<std::string> read(const Entry& entry, uint64_t max_bytes = UINT64_MAX) const;
+
+   private:
+    explicit ZipArchive(std::string_view data) : data_(data) {}
+
+    std::string_view data_;
+    std::vector<Entry> entries_;
+};
+
+}  // namespace crawler
@@ -0,0 +1,87 @@
+#include "aimd_limiter.hpp"
+
+#include <algorithm>
+
+namespace crawler {
+
+namespace {
+
+constexpr double kRecentWeight = 0.2;
+constexpr double kBaselineWeight = 0.01;
+// TTFB samples needed before a rise is trusted.
+constexpr uint32_t kWarmupSamples = 8;
+
+}  // namespace
+
+AimdLimiter::AimdLimiter(AimdOptions options) : options_(options) {
+    options_.min_limit = std::max(1, options_.min_limit);
+    options_.max_limit = std::max(options_.min_limit, options_.max_limit);
+    options_.initial_limit = std::clamp(options_.initial_limit, options_.min_limit, options_.max_limit);
+    options_.decrease_factor = std::clamp(options_.decrease_factor, 0.1, 0.95);
+}
+
+int AimdLimiter::record(const std::string& host, Outcome outcome, int64_t ttfb_us) {
+    HostState& state = this->state(host);
+    bool holding_off = state.holdoff > 0;
+    if (holding_off) {
+        --state.holdoff;
+    }
+    if (outcome != Outcome::ok) {
+        if (!holding_off) {
+            decrease(state);
+        }
+        return static_cast<int>(state.window);
+    }
+
+    double sample = static_cast<double>(std::max<int64_t>(0, ttfb_us));
+    if (state.samples++ == 0) {
+        state.recent_ttfb_us = sample;
+        state.baseline_ttfb_us = sample;
+    } else {
+        state.recent_ttfb_us += kRecentWeight * (sample - state.recent_ttfb_us);
+        if (state.recent_ttfb_us < state.baseline_ttfb_us) {
+            state.baseline_ttfb_us = state.recent_ttfb_us;
+        } else {
+            state.baseline_ttfb_us += kBaselineWeight * (state.recent_ttfb_us - state.baseline_ttfb_us);
+        }
+    }
+    bool slow = state.samples >= kWarmupSamples &&
+                state.recent_ttfb_us > state.baseline_ttfb_us * options_.ttfb_tolerance &&
+                state.recent_ttfb_us - state.baseline_ttfb_us > kMinTtfbRiseUs;
+    if (slow) {
+        if (!holding_off) {
+            decrease(state);
+        }
+    } else {
+        state.window = std::min<double>(state.max_limit, state.window + 1.0 / state.window);
+    }
+    return static_cast<int>(state.window);
+}
+
+int AimdLimiter::limit(const std::string& host) const {
+    auto it = hosts_.find(host);
+    return it == hosts_.end() ? options_.initial_limit : static_cast<int>(it->second.window);
+}
+
+AimdLimiter::HostState& AimdLimiter::state(const std::string& host) {
+    auto [it, inserted] = hosts_.try_emplace(host);
+    if (inserted) {
+        it->second.window = options_.initial_limit;
+        it->second.max_limit = options_.max_limit;
+    }
+    return it->second;
+}
+
+void AimdLimiter::set_max_limit(const std::string& host, int max_limit) {
+    HostState& state = this->state(host);
+    state.max_limit = std::max(options_.min_limit, max_limit);
+    state.window = std::min<double>(state.window, state.max_limit);
+}
+
+void AimdLimiter::decrease(HostState& host) {
+    // Up to a window's worth of requests went out before the cut.
+    host.holdoff = static_cast<uint32_t>(host.window);
+    host.window = std::max<double>(options_.min_limit, host.window * options_.decrease_factor);
+}
+
+}  // namespace crawler
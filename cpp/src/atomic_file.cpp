@@ -0,0 +1,49 @@
+#include "atomic_file.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+
+namespace crawler {
+
+namespace {
+
+// fsyncs a file or directory; a directory is synced to persist a rename.
+bool sync_path(const std::filesystem::path& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    bool synced = fsync(fd) == 0;
+    int error = errno;
+    ::close(fd);
+    errno = error;
+    return synced;
+}
+
+}  // namespace
+
+bool commit_file(const std::filesystem::path& temp, const std::filesystem::path& path) {
+    // The data must be on disk before the rename is, or a power loss could
+    // leave the new name pointing at an empty file.
+    if (!sync_path(temp)) {
+        std::cerr << "Failed to sync " << temp << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp, path, ec);
+    if (ec) {
+        std::cerr << "Failed to replace " << path << ": " << ec.message() << "\n";
+        return false;
+    }
+    std::filesystem::path directory = path.has_parent_path() ? path.parent_path() : std::filesystem::path(".");
+    if (!sync_path(directory)) {
+        std::cerr << "Failed to sync " << directory << ": " << std::strerror(errno) << "\n";
+    }
+    return true;
+}
+
+}  // namespace crawler
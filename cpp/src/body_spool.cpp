@@ -0,0 +1,148 @@
+#include "body_spool.hpp"
+
+#include "hash.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+
+namespace crawler {
+
+namespace {
+
+std::atomic<uint64_t> next_spill_id {0};
+
+bool write_all(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t n = ::write(fd, data, length);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        length -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+}  // namespace
+
+BodySpool::BodySpool(std::filesystem::path spill_dir, size_t memory_limit)
+    : spill_dir_(std::move(spill_dir)),
+      memory_limit_(memory_limit) {}
+
+BodySpool::~BodySpool() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        std::error_code ec;
+        std::filesystem::remove(spill_path_, ec);
+    }
+}
+
+void BodySpool::expect(uint64_t length) {
+    if (fd_ < 0 && length <= memory_limit_) {
+        memory_.reserve(static_cast<size_t>(length));
+    }
+}
+
+void BodySpool::reset(size_t keep_bytes) {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        std::error_code ec;
+        std::filesystem::remove(spill_path_, ec);
+        fd_ = -1;
+    }
+    size_ = 0;
+    memory_.clear();
+    if (memory_.capacity() > keep_bytes) {
+        memory_.shrink_to_fit();
+    }
+}
+
+bool BodySpool::append(std::string_view chunk) {
+    size_ += chunk.size();
+    if (fd_ < 0 && memory_.size() + chunk.size() <= memory_limit_) {
+        memory_.append(chunk);
+        return true;
+    }
+    if (fd_ < 0 && !spill()) {
+        return false;
+    }
+    return write_all(fd_, chunk.data(), chunk.size());
+}
+
+bool BodySpool::spill() {
+    std::error_code ec;
+    std::filesystem::create_directories(spill_dir_, ec);
+    spill_path_ = spill_dir_ / (std::to_string(getpid()) + "-" + std::to_string(next_spill_id.fetch_add(1)) + ".part");
+    fd_ = ::open(spill_path_.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        std::cerr << "Failed to create " << spill_path_ << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    bool ok = write_all(fd_, memory_.data(), memory_.size());
+    memory_.clear();
+    memory_.shrink_to_fit();
+    return ok;
+}
+
+uint64_t BodySpool::hash() const {
+    if (fd_ < 0 || size_ == 0) {
+        return hash_bytes(memory_);
+    }
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (data == MAP_FAILED) {
+        return hash_bytes(read_all());
+    }
+    uint64_t hash = hash_bytes(std::string_view(static_cast<const char*>(data), size_));
+    munmap(data, size_);
+    return hash;
+}
+
+std::string BodySpool::read_all() const {
+    if (fd_ < 0) {
+        return memory_;
+    }
+    std::string body(size_, '\0');
+    size_t done = 0;
+    while (done < body.size()) {
+        ssize_t n = pread(fd_, body.data() + done, body.size() - done, static_cast<off_t>(done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            body.resize(done);
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return body;
+}
+
+bool BodySpool::move_to(const std::filesystem::path& target) {
+    if (fd_ < 0) {
+        std::ofstream out(target, std::ios::binary | std::ios::trunc);
+        out << memory_;
+        return static_cast<bool>(out.flush());
+    }
+    std::error_code ec;
+    std::filesystem::rename(spill_path_, target, ec);
+    if (ec) {
+        std::cerr << "Failed to move " << spill_path_ << " to " << target << ": " << ec.message() << "\n";
+        return false;
+    }
+    ::close(fd_);
+    fd_ = -1;
+    return true;
+}
+
+}  // namespace crawler
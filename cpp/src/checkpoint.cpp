@@ -0,0 +1,138 @@
+#include "checkpoint.hpp"
+
+#include "atomic_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+namespace crawler {
+
+namespace {
+
+constexpr char kMagic[8] = {'F', 'G', 'C', 'K', 'P', 'T', '0', '2'};
+
+struct Header {
+    char magic[8];
+    uint64_t fingerprint_count;
+    uint64_t frontier_count;
+    uint64_t pages_downloaded;
+    uint64_t metadata_offset;
+};
+
+static_assert(sizeof(Header) % alignof(uint64_t) == 0, "fingerprints must stay aligned");
+
+}  // namespace
+
+bool write_checkpoint(const std::filesystem::path& path, const CheckpointSnapshot& snapshot) {
+    return write_file_atomically(path, [&snapshot](std::ofstream& out) {
+        Header header {};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.fingerprint_count = snapshot.fingerprints.size();
+        header.frontier_count = snapshot.frontier.size();
+        header.pages_downloaded = snapshot.pages_downloaded;
+        header.metadata_offset = snapshot.metadata_offset;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(snapshot.fingerprints.data()),
+                  static_cast<std::streamsize>(snapshot.fingerprints.size() * sizeof(uint64_t)));
+        for (const auto& url : snapshot.frontier) {
+            auto length = static_cast<uint32_t>(url.size());
+            out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+            out.write(url.data(), length);
+        }
+    });
+}
+
+std::optional<MappedCheckpoint> MappedCheckpoint::open(const std::filesystem::path& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+    struct stat info {};
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+        ::close(fd);
+        std::cerr << "Ignoring truncated checkpoint " << path << "\n";
+        return std::nullopt;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        std::cerr << "Failed to map checkpoint " << path << "\n";
+        return std::nullopt;
+    }
+
+    MappedCheckpoint checkpoint;
+    checkpoint.data_ = data;
+    checkpoint.size_ = size;
+
+    const char* bytes = static_cast<const char*>(data);
+    Header header;
+    std::memcpy(&header, bytes, sizeof(header));
+    size_t fingerprint_bytes = header.fingerprint_count * sizeof(uint64_t);
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.fingerprint_count > size / sizeof(uint64_t)
+        || sizeof(Header) + fingerprint_bytes > size) {
+        std::cerr << "Ignoring unrecognized checkpoint " << path << "\n";
+        return std::nullopt;
+    }
+    checkpoint.fingerprints_ = reinterpret_cast<const uint64_t*>(bytes + sizeof(Header));
+    checkpoint.fingerprint_count_ = header.fingerprint_count;
+    checkpoint.pages_downloaded_ = header.pages_downloaded;
+    checkpoint.metadata_offset_ = header.metadata_offset;
+
+    size_t offset = sizeof(Header) + fingerprint_bytes;
+    checkpoint.frontier_.reserve(std::min<uint64_t>(header.frontier_count, size / sizeof(uint32_t)));
+    for (uint64_t i = 0; i < header.frontier_count; ++i) {
+        uint32_t length = 0;
+        if (offset + sizeof(length) > size) {
+            break;
+        }
+        std::memcpy(&length, bytes + offset, sizeof(length));
+        offset += sizeof(length);
+        if (offset + length > size) {
+            break;
+        }
+        checkpoint.frontier_.emplace_back(bytes + offset, length);
+        offset += length;
+    }
+    if (checkpoint.frontier_.size() != header.frontier_count) {
+        std::cerr << "Ignoring truncated checkpoint " << path << "\n";
+        return std::nullopt;
+    }
+    return checkpoint;
+}
+
+MappedCheckpoint::MappedCheckpoint(MappedCheckpoint&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedCheckpoint& MappedCheckpoint::operator=(MappedCheckpoint&& other) noexcept {
+    if (this != &other) {
+        if (data_) {
+            munmap(data_, size_);
+        }
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        fingerprints_ = std::exchange(other.fingerprints_, nullptr);
+        fingerprint_count_ = std::exchange(other.fingerprint_count_, 0);
+        frontier_ = std::move(other.frontier_);
+        pages_downloaded_ = other.pages_downloaded_;
+        metadata_offset_ = other.metadata_offset_;
+    }
+    return *this;
+}
+
+MappedCheckpoint::~MappedCheckpoint() {
+    if (data_) {
+        munmap(data_, size_);
+    }
+}
+
+}  // namespace crawler
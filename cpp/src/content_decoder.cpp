@@ -0,0 +1,192 @@
+#include "content_decoder.hpp"
+
+#include "string_util.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <climits>
+
+namespace crawler {
+
+namespace {
+
+constexpr size_t kInflateChunk = 1 << 14;
+// gzip member header.
+constexpr unsigned char kGzipMagic[2] = {0x1f, 0x8b};
+
+// RFC 1950: CM 8 in the low nibble and a header checksum divisible by 31.
+bool has_zlib_header(unsigned char cmf, unsigned char flg) {
+    return (cmf & 0x0f) == 8 && ((cmf << 8) | flg) % 31 == 0;
+}
+
+}  // namespace
+
+std::optional<ContentEncoding> parse_content_encoding(std::string_view header) {
+    std::string value = to_lower(std::string(trim_view(header)));
+    if (value.empty() || value == "identity") {
+        return ContentEncoding::identity;
+    }
+    if (value == "gzip" || value == "x-gzip") {
+        return ContentEncoding::gzip;
+    }
+    if (value == "deflate") {
+        return ContentEncoding::deflate;
+    }
+    return std::nullopt;
+}
+
+const char* content_encoding_name(ContentEncoding encoding) {
+    switch (encoding) {
+        case ContentEncoding::identity:
+            return "identity";
+        case ContentEncoding::gzip:
+            return "gzip";
+        case ContentEncoding::deflate:
+            return "deflate";
+    }
+    return "unknown";
+}
+
+struct ContentDecoder::State {
+    z_stream stream {};
+    bool open = false;
+};
+
+ContentDecoder::ContentDecoder() : state_(std::make_unique<State>()) {}
+
+ContentDecoder::~ContentDecoder() {
+    if (state_->open) {
+        inflateEnd(&state_->stream);
+    }
+}
+
+void ContentDecoder::reset(ContentEncoding encoding, uint64_t max_output) {
+    if (state_->open) {
+        inflateEnd(&state_->stream);
+        state_->open = false;
+    }
+    encoding_ = encoding;
+    output_left_ = max_output;
+    head_.clear();
+    between_members_ = false;
+    gap_.clear();
+    started_ = false;
+    finished_ = max_output == 0;
+}
+
+bool ContentDecoder::feed(std::string_view chunk, std::string& out) {
+    if (finished_ || chunk.empty()) {
+        return true;
+    }
+    if (encoding_ == ContentEncoding::identity) {
+        size_t taken = static_cast<size_t>(std::min<uint64_t>(output_left_, chunk.size()));
+        out.append(chunk.substr(0, taken));
+        output_left_ -= taken;
+        finished_ = output_left_ == 0;
+        return true;
+    }
+    if (!started_) {
+        int window_bits = 15 + 16;
+        if (encoding_ == ContentEncoding::deflate) {
+            if (head_.size() + chunk.size() < 2) {
+                head_.append(chunk);
+                return true;
+            }
+            std::string first = head_ + std::string(chunk.substr(0, 2 - std::min<size_t>(2, head_.size())));
+            bool wrapped = has_zlib_header(static_cast<unsigned char>(first[0]), static_cast<unsigned char>(first[1]));
+            window_bits = wrapped ? 15 : -15;
+        }
+        if (inflateInit2(&state_->stream, window_bits) != Z_OK) {
+            return false;
+        }
+        state_->open = true;
+        started_ = true;
+        if (!head_.empty()) {
+            std::string head = std::move(head_);
+            head_.clear();
+            if (!inflate_chunk(head, out)) {
+                return false;
+            }
+        }
+    }
+    return inflate_chunk(chunk, out);
+}
+
+bool ContentDecoder::inflate_chunk(std::string_view chunk, std::string& out) {
+    z_stream& stream = state_->stream;
+    char buffer[kInflateChunk];
+    while (!chunk.empty() && !finished_) {
+        if (between_members_) {
+            size_t taken = std::min(chunk.size(), 2 - gap_.size());
+            gap_.append(chunk.substr(0, taken));
+            chunk.remove_prefix(taken);
+            if (gap_.size() < 2) {
+                return true;
+            }
+            between_members_ = false;
+            // gzip allows several members back to back; anything else after
+            // a member is trailing garbage.
+            if (static_cast<unsigned char>(gap_[0]) != kGzipMagic[0] ||
+                static_cast<unsigned char>(gap_[1]) != kGzipMagic[1] || inflateReset(&stream) != Z_OK) {
+                finished_ = true;
+                return true;
+            }
+            std::string gap = std::move(gap_);
+            gap_.clear();
+            if (!inflate_chunk(gap, out)) {
+                return false;
+            }
+            continue;
+        }
+        uInt input = static_cast<uInt>(std::min<size_t>(chunk.size(), UINT_MAX));
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(chunk.data()));
+        stream.avail_in = input;
+        while (!finished_) {
+            size_t room = static_cast<size_t>(std::min<uint64_t>(sizeof(buffer), output_left_));
+            stream.next_out = reinterpret_cast<Bytef*>(buffer);
+            stream.avail_out = static_cast<uInt>(room);
+            int rc = inflate(&stream, Z_NO_FLUSH);
+            size_t produced = room - stream.avail_out;
+            out.append(buffer, produced);
+            output_left_ -= produced;
+            finished_ = output_left_ == 0;
+            if (rc == Z_STREAM_END) {
+                // The next member, if any, may start in a later chunk.
+                between_members_ = encoding_ == ContentEncoding::gzip && !finished_;
+                finished_ = !between_members_;
+                break;
+            }
+            if (rc == Z_BUF_ERROR) {
+                break;
+            }
+            if (rc != Z_OK) {
+                return false;
+            }
+            if (stream.avail_in == 0 && stream.avail_out > 0) {
+                break;
+            }
+        }
+        chunk.remove_prefix(input - stream.avail_in);
+        if (stream.avail_in > 0 && !finished_ && !between_members_) {
+            // Z_BUF_ERROR with input left: no progress is possible.
+            return false;
+        }
+    }
+    return true;
+}
+
+std::optional<std::string> decode_body(ContentEncoding encoding, std::string_view body, uint64_t max_output) {
+    if (encoding == ContentEncoding::identity) {
+        return std::string(body.substr(0, static_cast<size_t>(std::min<uint64_t>(max_output, body.size()))));
+    }
+    ContentDecoder decoder;
+    decoder.reset(encoding, max_output);
+    std::string out;
+    if (!decoder.feed(body, out)) {
+        return std::nullopt;
+    }
+    return out;
+}
+
+}  // namespace crawler
@@ -0,0 +1,310 @@
+#include "crawl_metrics.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <sstream>
+
+namespace crawler {
+
+namespace {
+
+constexpr std::array<const char*, static_cast<size_t>(Phase::kCount)> kPhaseNames = {"dns", "connect", "tls", "ttfb",
+                                                                                      "transfer"};
+// Prometheus bucket bounds are the powers of two from 16 us to 2^32 us.
+constexpr int kFirstBoundBit = 4;
+constexpr int kLastBoundBit = 32;
+
+std::string_view host_of(std::string_view url) {
+    size_t start = url.find("://");
+    if (start == std::string_view::npos) {
+        return {};
+    }
+    start += 3;
+    size_t end = url.find_first_of("/?#", start);
+    return url.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+}
+
+std::string format_duration(int64_t micros) {
+    char buffer[32];
+    if (micros < 1000) {
+        std::snprintf(buffer, sizeof(buffer), "%lldus", static_cast<long long>(micros));
+    } else if (micros < 1000000) {
+        std::snprintf(buffer, sizeof(buffer), "%.1fms", micros / 1e3);
+    } else {
+        std::snprintf(buffer, sizeof(buffer), "%.2fs", micros / 1e6);
+    }
+    return buffer;
+}
+
+std::string format_rate(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.1f", value);
+    return buffer;
+}
+
+// Label values may not contain raw quotes, backslashes or newlines.
+std::string escape_label(std::string_view value) {
+    std::string out;
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+void write_metric(std::ostringstream& out, const char* name, const char* type, const char* help) {
+    out << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' ' << type << '\n';
+}
+
+}  // namespace
+
+int LatencyHistogram::bucket_for(int64_t micros) {
+    uint64_t value = micros > 0 ? static_cast<uint64_t>(micros) : 0;
+    if (value < kSubBuckets) {
+        return static_cast<int>(value);
+    }
+    int exponent = std::bit_width(value) - 1;
+    int sub_bucket = static_cast<int>((value >> (exponent - kSubBucketBits)) & (kSubBuckets - 1));
+    return std::min((exponent - kSubBucketBits + 1) * kSubBuckets + sub_bucket, kBuckets - 1);
+}
+
+int64_t LatencyHistogram::bucket_end(int bucket) {
+    if (bucket < kSubBuckets) {
+        return bucket + 1;
+    }
+    int shift = bucket / kSubBuckets - 1;
+    int64_t start = static_cast<int64_t>(kSubBuckets + bucket % kSubBuckets) << shift;
+    return start + (int64_t {1} << shift);
+}
+
+void LatencyHistogram::record(int64_t micros) {
+    counts_[bucket_for(micros)].fetch_add(1, std::memory_order_relaxed);
+    sum_us_.fetch_add(static_cast<uint64_t>(std::max<int64_t>(0, micros)), std::memory_order_relaxed);
+}
+
+void LatencyHistogram::add_to(std::array<uint64_t, kBuckets>& counts, uint64_t& sum_us) const {
+    for (int i = 0; i < kBuckets; ++i) {
+        counts[i] += counts_[i].load(std::memory_order_relaxed);
+    }
+    sum_us += sum_us_.load(std::memory_order_relaxed);
+}
+
+CrawlMetrics::CrawlMetrics(std::vector<std::string> hosts)
+    : hosts_(std::move(hosts)),
+      host_counters_(std::make_unique<HostCounters[]>(hosts_.size())),
+      stripes_(std::make_unique<Stripe[]>(kStripes)) {}
+
+CrawlMetrics::Stripe& CrawlMetrics::local_stripe() {
+    static std::atomic<size_t> next_stripe {0};
+    thread_local size_t stripe = next_stripe.fetch_add(1, std::memory_order_relaxed) % kStripes;
+    return stripes_[stripe];
+}
+
+void CrawlMetrics::add(Counter counter, uint64_t amount) {
+    local_stripe().counters[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+}
+
+void CrawlMetrics::record_fetch(const FetchResult& result) {
+    Stripe& stripe = local_stripe();
+    auto bump = [&stripe](Counter counter, uint64_t amount = 1) {
+        stripe.counters[static_cast<size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+    };
+    bump(Counter::requests);
+    bump(Counter::bytes_received, static_cast<uint64_t>(std::max<int64_t>(0, result.bytes_received)));
+    // A body cut short on purpose still got an answer.
+    bool answered = result.ok || result.rejected;
+    if (!answered) {
+        bump(Counter::fetch_errors);
+    } else if (result.status >= 200 && result.status < 600) {
+        bump(static_cast<Counter>(static_cast<int>(Counter::status_2xx) + result.status / 100 - 2));
+    }
+    if (answered) {
+        const TransferTimings& timings = result.timings;
+        stripe.latency[static_cast<size_t>(Phase::dns)].record(timings.dns_us);
+        stripe.latency[static_cast<size_t>(Phase::connect)].record(timings.connect_us);
+        stripe.latency[static_cast<size_t>(Phase::tls)].record(timings.tls_us);
+        stripe.latency[static_cast<size_t>(Phase::ttfb)].record(timings.ttfb_us);
+        stripe.latency[static_cast<size_t>(Phase::transfer)].record(timings.transfer_us);
+    }
+
+    std::string_view host = host_of(result.url);
+    auto it = std::find(hosts_.begin(), hosts_.end(), host);
+    if (it != hosts_.end()) {
+        HostCounters& counters = host_counters_[it - hosts_.begin()];
+        counters.requests.fetch_add(1, std::memory_order_relaxed);
+        counters.bytes.fetch_add(static_cast<uint64_t>(std::max<int64_t>(0, result.bytes_received)),
+                                 std::memory_order_relaxed);
+        if (!answered || result.status >= 400) {
+            counters.errors.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+CrawlMetrics::Snapshot CrawlMetrics::snapshot() const {
+    Snapshot snapshot;
+    for (size_t s = 0; s < kStripes; ++s) {
+        const Stripe& stripe = stripes_[s];
+        for (size_t i = 0; i < snapshot.counters.size(); ++i) {
+            snapshot.counters[i] += stripe.counters[i].load(std::memory_order_relaxed);
+        }
+        for (size_t phase = 0; phase < snapshot.latency.size(); ++phase) {
+            stripe.latency[phase].add_to(snapshot.latency[phase], snapshot.latency_sum_us[phase]);
+        }
+    }
+    for (size_t i = 0; i < hosts_.size(); ++i) {
+        snapshot.host_requests.push_back(host_counters_[i].requests.load(std::memory_order_relaxed));
+        snapshot.host_errors.push_back(host_counters_[i].errors.load(std::memory_order_relaxed));
+        snapshot.host_bytes.push_back(host_counters_[i].bytes.load(std::memory_order_relaxed));
+    }
+    return snapshot;
+}
+
+int64_t CrawlMetrics::Snapshot::quantile_us(Phase phase, double q) const {
+    const auto& counts = latency[static_cast<size_t>(phase)];
+    uint64_t total = 0;
+    for (uint64_t count : counts) {
+        total += count;
+    }
+    if (total == 0) {
+        return 0;
+    }
+    auto rank = static_cast<uint64_t>(std::clamp(q, 0.0, 1.0) * static_cast<double>(total - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < LatencyHistogram::kBuckets; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return LatencyHistogram::bucket_end(i);
+        }
+    }
+    return LatencyHistogram::bucket_end(LatencyHistogram::kBuckets - 1);
+}
+
+std::string format_prometheus(const CrawlMetrics& metrics, const CrawlMetrics::Snapshot& snapshot,
+                              const CrawlGauges& gauges) {
+    std::ostringstream out;
+    auto counter = [&](const char* name, const char* help, Counter value) {
+        write_metric(out, name, "counter", help);
+        out << name << ' ' << snapshot[value] << '\n';
+    };
+    auto gauge = [&](const char* name, const char* help, uint64_t value) {
+        write_metric(out, name, "gauge", help);
+        out << name << ' ' << value << '\n';
+    };
+
+    counter("crawler_requests_total", "Fetches completed, successful or not.", Counter::requests);
+    counter("crawler_fetch_errors_total", "Fetches that got no HTTP response.", Counter::fetch_errors);
+    write_metric(out, "crawler_responses_total", "counter", "HTTP responses by status class.");
+    for (int status_class = 2; status_class <= 5; ++status_class) {
+        out << "crawler_responses_total{class=\"" << status_class << "xx\"} "
+            << snapshot[static_cast<Counter>(static_cast<int>(Counter::status_2xx) + status_class - 2)] << '\n';
+    }
+    counter("crawler_retries_total", "Failed fetches queued again after backoff.", Counter::retries);
+    counter("crawler_shard_urls_sent_total", "Discovered URLs forwarded to the shard that owns them.", Counter::shard_urls_sent);
+    counter("crawler_shard_urls_received_total", "URLs taken in from other shards.", Counter::shard_urls_received);
+    counter("crawler_received_bytes_total", "Response body bytes received.", Counter::bytes_received);
+    counter("crawler_pages_saved_total", "New or changed pages saved.", Counter::pages_saved);
+    counter("crawler_pages_unchanged_total", "Pages unchanged since the last crawl.", Counter::pages_unchanged);
+    counter("crawler_duplicate_checks_total", "Pages checked against the duplicate index.", Counter::duplicate_checks);
+    write_metric(out, "crawler_duplicates_total", "counter", "Pages found to duplicate a page already kept.");
+    out << "crawler_duplicates_total{match=\"exact\"} " << snapshot[Counter::exact_duplicates] << '\n';
+    out << "crawler_duplicates_total{match=\"near\"} " << snapshot[Counter::near_duplicates] << '\n';
+    counter("crawler_documents_extracted_total", "PDF and Office documents whose text was extracted.",
+            Counter::documents_extracted);
+    counter("crawler_document_extraction_failures_total", "Documents that could not be parsed.",
+            Counter::document_extraction_failures);
+    counter("crawler_extraction_queue_waits_total", "Hand-offs that waited for room in the extraction queue.",
+            Counter::extraction_queue_waits);
+    counter("crawler_urls_discovered_total", "In-scope links offered to the frontier.", Counter::urls_discovered);
+    counter("crawler_urls_already_seen_total", "Discovered links the seen-set turned away.",
+            Counter::urls_already_seen);
+    counter("crawler_urls_out_of_scope_total", "Links on allowed hosts dropped by the scope rules.",
+            Counter::urls_out_of_scope);
+
+    gauge("crawler_frontier_urls", "URLs queued for fetching.", gauges.frontier);
+    gauge("crawler_in_progress_requests", "Requests handed out whose pages are not processed yet.", gauges.in_progress);
+    gauge("crawler_seen_urls", "URLs in the seen-set.", gauges.seen_urls);
+    gauge("crawler_pages_downloaded", "Pages processed, counting toward max_pages.", gauges.pages_downloaded);
+    gauge("crawler_extraction_queue_documents", "Documents waiting for a text extraction thread.", gauges.extraction_queue);
+
+    const auto& hosts = metrics.hosts();
+    auto per_host = [&](const char* name, const char* help, const std::vector<uint64_t>& values) {
+        write_metric(out, name, "counter", help);
+        for (size_t i = 0; i < hosts.size(); ++i) {
+            out << name << "{host=\"" << escape_label(hosts[i]) << "\"} " << values[i] << '\n';
+        }
+    };
+    per_host("crawler_host_requests_total", "Fetches completed per host.", snapshot.host_requests);
+    per_host("crawler_host_errors_total", "Fetches per host that failed or got a 4xx/5xx.", snapshot.host_errors);
+    per_host("crawler_host_received_bytes_total", "Response body bytes received per host.", snapshot.host_bytes);
+    write_metric(out, "crawler_host_concurrency_limit", "gauge", "Requests allowed in flight per host.");
+    for (size_t i = 0; i < hosts.size() && i < gauges.host_limits.size(); ++i) {
+        out << "crawler_host_concurrency_limit{host=\"" << escape_label(hosts[i]) << "\"} " << gauges.host_limits[i] << '\n';
+    }
+
+    write_metric(out, "crawler_fetch_phase_seconds", "histogram",
+                 "Time spent in each phase of a fetch (dns, connect, tls, ttfb, transfer).");
+    for (size_t phase = 0; phase < kPhaseNames.size(); ++phase) {
+        const auto& counts = snapshot.latency[phase];
+        uint64_t cumulative = 0;
+        int bucket = 0;
+        for (int bit = kFirstBoundBit; bit <= kLastBoundBit; ++bit) {
+            int64_t bound = int64_t {1} << bit;
+            for (; bucket < LatencyHistogram::kBuckets && LatencyHistogram::bucket_end(bucket) <= bound; ++bucket) {
+                cumulative += counts[bucket];
+            }
+            out << "crawler_fetch_phase_seconds_bucket{phase=\"" << kPhaseNames[phase] << "\",le=\"" << bound / 1e6
+                << "\"} " << cumulative << '\n';
+        }
+        for (; bucket < LatencyHistogram::kBuckets; ++bucket) {
+            cumulative += counts[bucket];
+        }
+        out << "crawler_fetch_phase_seconds_bucket{phase=\"" << kPhaseNames[phase] << "\",le=\"+Inf\"} " << cumulative
+            << '\n';
+        out << "crawler_fetch_phase_seconds_sum{phase=\"" << kPhaseNames[phase] << "\"} "
+            << snapshot.latency_sum_us[phase] / 1e6 << '\n';
+        out << "crawler_fetch_phase_seconds_count{phase=\"" << kPhaseNames[phase] << "\"} " << cumulative << '\n';
+    }
+    return out.str();
+}
+
+std::string format_stats_line(const CrawlMetrics& metrics, const CrawlMetrics::Snapshot& current,
+                              const CrawlMetrics::Snapshot& previous, double elapsed_seconds, const CrawlGauges& gauges) {
+    double seconds = std::max(elapsed_seconds, 1e-3);
+    auto delta = [&](Counter counter) { return current[counter] - previous[counter]; };
+    std::ostringstream out;
+    out << "Stats: " << gauges.pages_downloaded << " pages, " << format_rate(delta(Counter::requests) / seconds)
+        << " req/s, " << format_rate(delta(Counter::bytes_received) / seconds / 1e6) << " MB/s, frontier "
+        << gauges.frontier << ", in flight " << gauges.in_progress << ", errors " << delta(Counter::fetch_errors) << "/"
+        << delta(Counter::status_4xx) << "/" << delta(Counter::status_5xx) << " (net/4xx/5xx), retries "
+        << delta(Counter::retries);
+    if (uint64_t checks = delta(Counter::duplicate_checks)) {
+        uint64_t duplicates = delta(Counter::exact_duplicates) + delta(Counter::near_duplicates);
+        out << ", duplicates " << format_rate(100.0 * duplicates / checks) << "%";
+    }
+    if (uint64_t discovered = delta(Counter::urls_discovered)) {
+        out << ", links seen " << format_rate(100.0 * delta(Counter::urls_already_seen) / discovered) << "%";
+    }
+    // Latency quantiles cover the whole crawl so far.
+    out << ", ttfb p50 " << format_duration(current.quantile_us(Phase::ttfb, 0.5)) << " p99 "
+        << format_duration(current.quantile_us(Phase::ttfb, 0.99));
+    const auto& hosts = metrics.hosts();
+    for (size_t i = 0; i < hosts.size() && i < previous.host_requests.size(); ++i) {
+        uint64_t requests = current.host_requests[i] - previous.host_requests[i];
+        if (requests > 0) {
+            out << ", " << hosts[i] << ' ' << format_rate(requests / seconds) << "/s";
+            if (i < gauges.host_limits.size()) {
+                out << " (limit " << gauges.host_limits[i] << ")";
+            }
+        }
+    }
+    return out.str();
+}
+
+}  // namespace crawler
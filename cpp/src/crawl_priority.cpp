@@ -0,0 +1,50 @@
+#include "crawl_priority.hpp"
+
+#include "host_frontier.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace crawler {
+
+namespace {
+
+constexpr double kUnfetchedAgeDays = 30.0;
+
+}  // namespace
+
+CrawlPriority::CrawlPriority(PriorityWeights weights)
+    : weights_(std::move(weights)), promotion_levels_(static_cast<int>(std::lround(weights_.inlinks))) {}
+
+uint8_t CrawlPriority::level(std::string_view url, int depth, uint32_t inlinks, std::optional<double> age_days) const {
+    double score = -weights_.depth * depth + weights_.inlinks * std::log2(std::max<uint32_t>(inlinks, 1)) +
+                   weights_.staleness * std::log2(1.0 + std::max(0.0, age_days.value_or(kUnfetchedAgeDays)));
+    for (const auto& [pattern, weight] : weights_.patterns) {
+        if (url.find(pattern) != std::string_view::npos) {
+            score += weight;
+        }
+    }
+    long level = HostFrontier::kPriorityLevels / 2 + std::lround(score);
+    return static_cast<uint8_t>(std::clamp<long>(level, 0, HostFrontier::kPriorityLevels - 1));
+}
+
+void InlinkCounter::track(uint64_t fingerprint) {
+    Stripe& s = stripe(fingerprint);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.counts.try_emplace(fingerprint, 1);
+}
+
+uint32_t InlinkCounter::add(uint64_t fingerprint) {
+    Stripe& s = stripe(fingerprint);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.counts.find(fingerprint);
+    return it == s.counts.end() ? 0 : ++it->second;
+}
+
+void InlinkCounter::forget(uint64_t fingerprint) {
+    Stripe& s = stripe(fingerprint);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.counts.erase(fingerprint);
+}
+
+}  // namespace crawler
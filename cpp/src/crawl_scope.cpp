@@ -0,0 +1,42 @@
+#include "crawl_scope.hpp"
+
+namespace crawler {
+
+void CrawlScope::include(std::string_view pattern) {
+    if (!restricted_) {
+        // Every target starts with "/", so this is the shortest possible
+        // match: it only decides for URLs no include covers.
+        rules_.add("/", false);
+        restricted_ = true;
+    }
+    rules_.add(pattern, true);
+}
+
+void CrawlScope::exclude(std::string_view pattern) {
+    rules_.add(pattern, false);
+}
+
+CrawlScope::Verdict CrawlScope::check(const CanonicalUrl& url, int depth) const {
+    if (max_depth_ >= 0 && depth > max_depth_) {
+        return Verdict::too_deep;
+    }
+    if (max_query_params_ >= 0) {
+        int params = 0;
+        std::string_view query = url.query();
+        for (size_t i = 0; i < query.size(); ++i) {
+            params += query[i] != '&' && (i == 0 || query[i - 1] == '&') ? 1 : 0;
+        }
+        if (params > max_query_params_) {
+            return Verdict::too_many_query_params;
+        }
+    }
+    if (!rules_.empty()) {
+        std::string_view target = std::string_view(url.str()).substr(url.path().data() - url.str().data());
+        if (!rules_.allowed(target)) {
+            return Verdict::excluded;
+        }
+    }
+    return Verdict::in_scope;
+}
+
+}  // namespace crawler
@@ -0,0 +1,214 @@
+#include "document_text.hpp"
+
+#include "string_util.hpp"
+#include "text_builder.hpp"
+#include "zip_reader.hpp"
+
+#ifdef CRAWLER_WITH_POPPLER
+#include <poppler-document.h>
+#include <poppler-page.h>
+#endif
+
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace crawler {
+
+namespace {
+
+// Caps what one inflated OOXML part may grow to.
+constexpr uint64_t kMaxPartBytes = 256 << 20;
+
+// Adds the text of every `text_tag` element in an OOXML part to `out`.
+// Runs next to each other join up, as Word splits words across runs;
+// any `break_tags` element (opening, closing or empty) separates words.
+void collect_text(std::string_view xml, std::string_view text_tag, std::initializer_list<std::string_view> break_tags,
+                  TextBuilder& out) {
+    std::string decoded;
+    size_t i = 0;
+    while ((i = xml.find('<', i)) != std::string_view::npos) {
+        size_t gt = xml.find('>', i);
+        if (gt == std::string_view::npos) {
+            return;
+        }
+        size_t name_start = i + 1;
+        if (name_start < gt && xml[name_start] == '/') {
+            ++name_start;
+        }
+        size_t name_end = name_start;
+        while (name_end < gt && !is_space(xml[name_end]) && xml[name_end] != '/') {
+            ++name_end;
+        }
+        std::string_view name = xml.substr(name_start, name_end - name_start);
+        bool opening = xml[i + 1] != '/' && xml[gt - 1] != '/';
+        i = gt + 1;
+        if (opening && name == text_tag) {
+            std::string closing = "</" + std::string(text_tag) + ">";
+            size_t end = xml.find(closing, i);
+            if (end == std::string_view::npos) {
+                return;
+            }
+            decoded.clear();
+            append_decoded(decoded, xml.substr(i, end - i));
+            out.add(decoded);
+            i = end + closing.size();
+        } else if (std::find(break_tags.begin(), break_tags.end(), name) != break_tags.end()) {
+            out.separate();
+        }
+    }
+}
+
+// The numbered parts `prefix`N`.xml` (slides, worksheets) in order of N.
+std::vector<const ZipArchive::Entry*> numbered_parts(const ZipArchive& archive, std::string_view prefix) {
+    std::vector<std::pair<unsigned, const ZipArchive::Entry*>> parts;
+    for (const auto& entry : archive.entries()) {
+        std::string_view name = entry.name;
+        if (!name.starts_with(prefix) || !name.ends_with(".xml")) {
+            continue;
+        }
+        std::string_view digits = name.substr(prefix.size(), name.size() - prefix.size() - 4);
+        unsigned number = 0;
+        auto [ptr, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), number);
+        if (ec == std::errc() && ptr == digits.data() + digits.size()) {
+            parts.emplace_back(number, &entry);
+        }
+    }
+    std::sort(parts.begin(), parts.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    std::vector<const ZipArchive::Entry*> out;
+    for (const auto& part : parts) {
+        out.push_back(part.second);
+    }
+    return out;
+}
+
+std::optional<DocumentText> extract_ooxml_text(DocumentFormat format, std::string_view body) {
+    auto archive = ZipArchive::open(body);
+    if (!archive) {
+        return std::nullopt;
+    }
+    TextBuilder out;
+    auto add_part = [&](const ZipArchive::Entry* entry, std::string_view text_tag,
+                        std::initializer_list<std::string_view> break_tags) {
+        auto xml = entry ? archive->read(*entry, kMaxPartBytes) : std::nullopt;
+        if (xml) {
+            collect_text(*xml, text_tag, break_tags, out);
+            out.separate();
+        }
+        return xml.has_value();
+    };
+    switch (format) {
+        case DocumentFormat::docx:
+            if (!add_part(archive->find("word/document.xml"), "w:t", {"w:p", "w:tab", "w:br", "w:cr"})) {
+                return std::nullopt;
+            }
+            break;
+        case DocumentFormat::pptx:
+            for (const auto* slide : numbered_parts(*archive, "ppt/slides/slide")) {
+                add_part(slide, "a:t", {"a:p", "a:br"});
+            }
+            break;
+        case DocumentFormat::xlsx:
+            // Text cells point into the shared strings; inline strings sit in the sheets.
+            add_part(archive->find("xl/sharedStrings.xml"), "t", {"si"});
+            for (const auto* sheet : numbered_parts(*archive, "xl/worksheets/sheet")) {
+                add_part(sheet, "t", {"is", "c"});
+            }
+            break;
+        default:
+            return std::nullopt;
+    }
+    return DocumentText {std::move(out.out), out.words};
+}
+
+#ifdef CRAWLER_WITH_POPPLER
+std::optional<DocumentText> extract_pdf_text(std::string_view body) {
+    if (body.size() > static_cast<size_t>(INT_MAX)) {
+        return std::nullopt;
+    }
+    std::unique_ptr<poppler::document> document(
+        poppler::document::load_from_raw_data(body.data(), static_cast<int>(body.size())));
+    if (!document || document->is_locked()) {
+        return std::nullopt;
+    }
+    TextBuilder out;
+    for (int i = 0; i < document->pages(); ++i) {
+        std::unique_ptr<poppler::page> page(document->create_page(i));
+        if (!page) {
+            continue;
+        }
+        poppler::byte_array utf8 = page->text().to_utf8();
+        out.add(std::string_view(utf8.data(), utf8.size()));
+        out.separate();
+    }
+    return DocumentText {std::move(out.out), out.words};
+}
+#endif
+
+}  // namespace
+
+DocumentFormat document_format(std::string_view content_type, std::string_view extension) {
+    std::string type = to_lower(std::string(content_type.substr(0, content_type.find(';'))));
+    type = trim(type);
+    if (type == "application/pdf") {
+        return DocumentFormat::pdf;
+    }
+    if (type == "application/vnd.openxmlformats-officedocument.wordprocessingml.document") {
+        return DocumentFormat::docx;
+    }
+    if (type == "application/vnd.openxmlformats-officedocument.presentationml.presentation") {
+        return DocumentFormat::pptx;
+    }
+    if (type == "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet") {
+        return DocumentFormat::xlsx;
+    }
+    std::string ext = to_lower(std::string(extension));
+    if (ext == ".pdf") {
+        return DocumentFormat::pdf;
+    }
+    if (ext == ".docx") {
+        return DocumentFormat::docx;
+    }
+    if (ext == ".pptx") {
+        return DocumentFormat::pptx;
+    }
+    if (ext == ".xlsx") {
+        return DocumentFormat::xlsx;
+    }
+    return DocumentFormat::none;
+}
+
+bool can_extract_text(DocumentFormat format) {
+    switch (format) {
+        case DocumentFormat::docx:
+        case DocumentFormat::pptx:
+        case DocumentFormat::xlsx:
+            return true;
+        case DocumentFormat::pdf:
+#ifdef CRAWLER_WITH_POPPLER
+            return true;
+#else
+            return false;
+#endif
+        case DocumentFormat::none:
+            return false;
+    }
+    return false;
+}
+
+std::optional<DocumentText> extract_document_text(DocumentFormat format, std::string_view body) {
+    if (format == DocumentFormat::pdf) {
+#ifdef CRAWLER_WITH_POPPLER
+        return extract_pdf_text(body);
+#else
+        return std::nullopt;
+#endif
+    }
+    return extract_ooxml_text(format, body);
+}
+
+}  // namespace crawler
@@ -0,0 +1,255 @@
+#include "embedding_client.hpp"
+
+#include "json.hpp"
+#include "string_util.hpp"
+
+#include <curl/curl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <thread>
+
+namespace crawler {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::chrono::milliseconds kFirstBackoff {500};
+constexpr std::chrono::milliseconds kMaxBackoff {30000};
+constexpr std::chrono::milliseconds kPollWait {100};
+
+struct Batch {
+    size_t first = 0;
+    size_t count = 0;
+    int attempts = 0;
+    Clock::time_point ready;
+};
+
+struct Request {
+    Batch batch;
+    CURL* easy = nullptr;
+    std::string body;
+    std::string response;
+    long retry_after = -1;
+};
+
+size_t write_callback(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    static_cast<Request*>(userdata)->response.append(ptr, size * nmemb);
+    return size * nmemb;
+}
+
+size_t header_callback(char* buffer, size_t size, size_t nitems, void* userdata) {
+    std::string_view header(buffer, size * nitems);
+    if (starts_with_icase(header, "retry-after:")) {
+        std::string value = trim(std::string(header.substr(header.find(':') + 1)));
+        char* end = nullptr;
+        long seconds = std::strtol(value.c_str(), &end, 10);
+        if (end != value.c_str() && *end == '\0' && seconds >= 0) {
+            static_cast<Request*>(userdata)->retry_after = seconds;
+        }
+    }
+    return size * nitems;
+}
+
+std::string request_body(const EmbeddingClientOptions& options, const std::vector<std::string>& inputs, const Batch& batch) {
+    std::string body = "{\"model\": ";
+    append_json_string(body, options.model);
+    if (options.dimensions > 0) {
+        body += ", \"dimensions\": " + std::to_string(options.dimensions);
+    }
+    body += ", \"encoding_format\": \"float\", \"input\": [";
+    for (size_t i = 0; i < batch.count; ++i) {
+        if (i > 0) {
+            body += ", ";
+        }
+        append_json_string(body, inputs[batch.first + i]);
+    }
+    body += "]}";
+    return body;
+}
+
+// Checks that the response holds one vector per input of `batch` before
+// handing any of them on, so a bad response can be retried as a whole.
+bool deliver(const std::string& response, const Batch& batch, const EmbeddingClient::VectorCallback& on_vector) {
+    auto document = JsonValue::parse(response);
+    const JsonValue* data = document ? document->find("data") : nullptr;
+    if (!data || !data->is_array() || data->items().size() != batch.count) {
+        return false;
+    }
+    size_t dimensions = 0;
+    std::vector<size_t> order(batch.count, batch.count);
+    std::vector<float> vectors;
+    for (size_t i = 0; i < batch.count; ++i) {
+        const JsonValue& item = data->items()[i];
+        const JsonValue* index = item.find("index");
+        const JsonValue* embedding = item.find("embedding");
+        if (!index || !index->is_number() || !embedding || !embedding->is_array() || embedding->items().empty()) {
+            return false;
+        }
+        double position = index->as_number();
+        if (position < 0 || position >= static_cast<double>(batch.count) || order[static_cast<size_t>(position)] != batch.count) {
+            return false;
+        }
+        if (dimensions == 0) {
+            dimensions = embedding->items().size();
+            vectors.reserve(dimensions * batch.count);
+        } else if (embedding->items().size() != dimensions) {
+            return false;
+        }
+        for (const JsonValue& value : embedding->items()) {
+            if (!value.is_number()) {
+                return false;
+            }
+            vectors.push_back(static_cast<float>(value.as_number()));
+        }
+        order[static_cast<size_t>(position)] = i;
+    }
+    for (size_t input = 0; input < batch.count; ++input) {
+        on_vector(batch.first + input, vectors.data() + order[input] * dimensions, dimensions);
+    }
+    return true;
+}
+
+}  // namespace
+
+EmbeddingStats EmbeddingClient::embed(const std::vector<std::string>& inputs, const VectorCallback& on_vector) const {
+    EmbeddingStats stats;
+    CURLM* multi = curl_multi_init();
+    if (!multi) {
+        std::cerr << "Failed to create a curl multi handle\n";
+        stats.failed_inputs = inputs.size();
+        return stats;
+    }
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    curl_slist* headers = curl_slist_append(nullptr, "Content-Type: application/json");
+    std::string authorization;
+    if (!options_.api_key.empty()) {
+        authorization = "Authorization: Bearer " + options_.api_key;
+        headers = curl_slist_append(headers, authorization.c_str());
+    }
+
+    size_t next_input = 0;
+    std::vector<Batch> waiting;
+    int in_flight = 0;
+    auto next_batch = [&](Clock::time_point now) -> std::optional<Batch> {
+        auto ready = std::find_if(waiting.begin(), waiting.end(), [&](const Batch& b) { return b.ready <= now; });
+        if (ready != waiting.end()) {
+            Batch batch = *ready;
+            waiting.erase(ready);
+            return batch;
+        }
+        if (next_input >= inputs.size()) {
+            return std::nullopt;
+        }
+        Batch batch;
+        batch.first = next_input;
+        size_t bytes = 0;
+        while (next_input < inputs.size() && batch.count < std::max<size_t>(1, options_.batch_size) &&
+               (batch.count == 0 || bytes + inputs[next_input].size() <= options_.max_batch_bytes)) {
+            bytes += inputs[next_input].size();
+            ++batch.count;
+            ++next_input;
+        }
+        return batch;
+    };
+    auto start = [&](const Batch& batch) {
+        auto* request = new Request;
+        request->batch = batch;
+        request->body = request_body(options_, inputs, batch);
+        request->easy = curl_easy_init();
+        CURL* easy = request->easy;
+        curl_easy_setopt(easy, CURLOPT_URL, options_.endpoint.c_str());
+        curl_easy_setopt(easy, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDS, request->body.c_str());
+        curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(request->body.size()));
+        curl_easy_setopt(easy, CURLOPT_USERAGENT, options_.user_agent.c_str());
+        curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, write_callback);
+        curl_easy_setopt(easy, CURLOPT_WRITEDATA, request);
+        curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, header_callback);
+        curl_easy_setopt(easy, CURLOPT_HEADERDATA, request);
+        curl_easy_setopt(easy, CURLOPT_PRIVATE, request);
+        curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, static_cast<long>(options_.timeout_seconds * 1000));
+        curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(easy, CURLOPT_ACCEPT_ENCODING, "");
+        curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, static_cast<long>(CURL_HTTP_VERSION_2TLS));
+        curl_easy_setopt(easy, CURLOPT_PIPEWAIT, 1L);
+        curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+        curl_multi_add_handle(multi, easy);
+        ++in_flight;
+        ++stats.requests;
+    };
+    auto finish = [&](CURL* easy, CURLcode code) {
+        Request* request = nullptr;
+        curl_easy_getinfo(easy, CURLINFO_PRIVATE, &request);
+        std::unique_ptr<Request> owned(request);
+        long status = 0;
+        curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &status);
+        curl_multi_remove_handle(multi, easy);
+        curl_easy_cleanup(easy);
+        --in_flight;
+
+        Batch batch = request->batch;
+        if (code == CURLE_OK && status == 200 && deliver(request->response, batch, on_vector)) {
+            return;
+        }
+        std::string problem = code != CURLE_OK ? curl_easy_strerror(code) : "HTTP " + std::to_string(status);
+        if (code == CURLE_OK && status != 200) {
+            problem += ": " + request->response.substr(0, 200);
+        } else if (code == CURLE_OK) {
+            problem += ": malformed response";
+        }
+        bool retryable = code != CURLE_OK || status == 200 || status == 408 || status == 429 || status >= 500;
+        if (retryable && ++batch.attempts < options_.max_attempts) {
+            auto backoff = request->retry_after >= 0 ? std::chrono::milliseconds(request->retry_after * 1000)
+                                                     : std::min(kMaxBackoff, kFirstBackoff * (1 << std::min(batch.attempts - 1, 6)));
+            batch.ready = Clock::now() + backoff;
+            waiting.push_back(batch);
+            ++stats.retries;
+            return;
+        }
+        std::cerr << "Embedding inputs " << batch.first << "-" << batch.first + batch.count - 1 << " failed: " << problem << "\n";
+        stats.failed_inputs += batch.count;
+    };
+
+    while (true) {
+        auto now = Clock::now();
+        while (in_flight < std::max(1, options_.concurrency)) {
+            auto batch = next_batch(now);
+            if (!batch) {
+                break;
+            }
+            start(*batch);
+        }
+        if (in_flight == 0) {
+            if (waiting.empty()) {
+                break;
+            }
+            // Only backed-off batches are left; sleep until the first is due.
+            auto due = std::min_element(waiting.begin(), waiting.end(),
+                                        [](const Batch& a, const Batch& b) { return a.ready < b.ready; });
+            std::this_thread::sleep_until(due->ready);
+            continue;
+        }
+        int running = 0;
+        curl_multi_perform(multi, &running);
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi, &queued)) {
+            if (msg->msg == CURLMSG_DONE) {
+                finish(msg->easy_handle, msg->data.result);
+            }
+        }
+        if (running > 0) {
+            curl_multi_poll(multi, nullptr, 0, static_cast<int>(kPollWait.count()), nullptr);
+        }
+    }
+    curl_slist_free_all(headers);
+    curl_multi_cleanup(multi);
+    return stats;
+}
+
+}  // namespace crawler
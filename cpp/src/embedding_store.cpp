@@ -0,0 +1,172 @@
+#include "embedding_store.hpp"
+
+#include "atomic_file.hpp"
+#include "string_util.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+namespace crawler {
+
+namespace {
+
+constexpr char kStoreMagic[8] = {'F', 'G', 'E', 'M', 'B', '0', '0', '1'};
+
+template <typename T>
+void write_value(std::ofstream& out, T value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+}  // namespace
+
+std::vector<std::string_view> chunk_words(std::string_view text, size_t chunk_words, size_t overlap_words) {
+    std::vector<std::pair<size_t, size_t>> words;
+    size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() && is_space(text[i])) {
+            ++i;
+        }
+        size_t start = i;
+        while (i < text.size() && !is_space(text[i])) {
+            ++i;
+        }
+        if (i > start) {
+            words.emplace_back(start, i);
+        }
+    }
+    std::vector<std::string_view> chunks;
+    if (words.empty()) {
+        return chunks;
+    }
+    size_t size = chunk_words == 0 ? words.size() : chunk_words;
+    size_t step = size - std::min(overlap_words, size - 1);
+    for (size_t first = 0;; first += step) {
+        size_t last = std::min(words.size(), first + size) - 1;
+        chunks.push_back(text.substr(words[first].first, words[last].second - words[first].first));
+        if (last + 1 == words.size()) {
+            break;
+        }
+    }
+    return chunks;
+}
+
+std::optional<EmbeddingStore> EmbeddingStore::load(const std::filesystem::path& path, std::string model) {
+    EmbeddingStore store(std::move(model));
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) {
+        return store;
+    }
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open " << path << "\n";
+        return std::nullopt;
+    }
+    char magic[sizeof(kStoreMagic)] = {};
+    uint32_t dimensions = 0;
+    uint32_t model_length = 0;
+    uint64_t count = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&dimensions), sizeof(dimensions));
+    in.read(reinterpret_cast<char*>(&model_length), sizeof(model_length));
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    uint64_t size = std::filesystem::file_size(path, ec);
+    uint64_t expected = sizeof(magic) + sizeof(dimensions) + sizeof(model_length) + sizeof(count) + model_length +
+                        count * (sizeof(uint64_t) + uint64_t {dimensions} * sizeof(float));
+    if (!in || std::memcmp(magic, kStoreMagic, sizeof(magic)) != 0 || ec || size != expected) {
+        std::cerr << path << " is not a valid embedding store\n";
+        return std::nullopt;
+    }
+    std::string stored_model(model_length, '\0');
+    in.read(stored_model.data(), model_length);
+    if (stored_model != store.model_) {
+        std::cerr << path << " holds " << stored_model << " vectors, not " << store.model_ << "; embedding everything again\n";
+        return store;
+    }
+    store.dimensions_ = dimensions;
+    store.vectors_.resize(count * dimensions);
+    store.index_.reserve(count);
+    for (uint64_t row = 0; row < count; ++row) {
+        uint64_t key = 0;
+        in.read(reinterpret_cast<char*>(&key), sizeof(key));
+        in.read(reinterpret_cast<char*>(store.vectors_.data() + row * dimensions),
+                static_cast<std::streamsize>(dimensions * sizeof(float)));
+        store.index_.emplace(key, row * dimensions);
+    }
+    if (!in) {
+        std::cerr << "Failed to read " << path << "\n";
+        return std::nullopt;
+    }
+    return store;
+}
+
+const float* EmbeddingStore::find(uint64_t key) const {
+    auto it = index_.find(key);
+    return it == index_.end() ? nullptr : vectors_.data() + it->second;
+}
+
+bool EmbeddingStore::add(uint64_t key, const float* vector, size_t dimensions) {
+    if (dimensions == 0 || (dimensions_ != 0 && dimensions != dimensions_)) {
+        return false;
+    }
+    dimensions_ = dimensions;
+    auto [it, inserted] = index_.try_emplace(key, vectors_.size());
+    if (inserted) {
+        vectors_.resize(vectors_.size() + dimensions);
+    }
+    double norm = 0.0;
+    for (size_t i = 0; i < dimensions; ++i) {
+        norm += static_cast<double>(vector[i]) * vector[i];
+    }
+    float scale = norm > 0.0 ? static_cast<float>(1.0 / std::sqrt(norm)) : 1.0f;
+    float* out = vectors_.data() + it->second;
+    for (size_t i = 0; i < dimensions; ++i) {
+        out[i] = vector[i] * scale;
+    }
+    return true;
+}
+
+bool EmbeddingStore::save(const std::filesystem::path& path, const std::vector<uint64_t>& keys) const {
+    std::vector<uint64_t> kept;
+    kept.reserve(keys.size());
+    for (uint64_t key : keys) {
+        if (index_.count(key)) {
+            kept.push_back(key);
+        }
+    }
+    return write_file_atomically(path, [&](std::ofstream& out) {
+        out.write(kStoreMagic, sizeof(kStoreMagic));
+        write_value(out, static_cast<uint32_t>(dimensions_));
+        write_value(out, static_cast<uint32_t>(model_.size()));
+        write_value(out, static_cast<uint64_t>(kept.size()));
+        out.write(model_.data(), static_cast<std::streamsize>(model_.size()));
+        for (uint64_t key : kept) {
+            write_value(out, key);
+            out.write(reinterpret_cast<const char*>(find(key)), static_cast<std::streamsize>(dimensions_ * sizeof(float)));
+        }
+    });
+}
+
+bool write_faiss_flat_index(const std::filesystem::path& path, size_t dimensions, const std::vector<const float*>& rows) {
+    // faiss/impl/index_write.cpp: fourcc, the Index header (d, ntotal, two
+    // unused idx_t, is_trained, metric_type), then the codes as a float count
+    // and the floats.
+    return write_file_atomically(path, [&](std::ofstream& out) {
+        out.write("IxFI", 4);
+        write_value(out, static_cast<int32_t>(dimensions));
+        write_value(out, static_cast<int64_t>(rows.size()));
+        write_value(out, static_cast<int64_t>(1 << 20));
+        write_value(out, static_cast<int64_t>(1 << 20));
+        write_value(out, static_cast<uint8_t>(1));
+        write_value(out, static_cast<int32_t>(0));  // METRIC_INNER_PRODUCT
+        write_value(out, static_cast<uint64_t>(rows.size() * dimensions));
+        for (const float* row : rows) {
+            out.write(reinterpret_cast<const char*>(row), static_cast<std::streamsize>(dimensions * sizeof(float)));
+        }
+    });
+}
+
+}  // namespace crawler
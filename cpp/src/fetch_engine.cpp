@@ -0,0 +1,379 @@
+#include "fetch_engine.hpp"
+
+#include "string_util.hpp"
+
+#include <curl/curl.h>
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <mutex>
+
+namespace crawler {
+
+namespace {
+
+constexpr std::chrono::milliseconds kIdlePoll {1000};
+
+using ShareLocks = std::array<std::mutex, CURL_LOCK_DATA_LAST>;
+
+void lock_share(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+    (*static_cast<ShareLocks*>(userptr))[data].lock();
+}
+
+void unlock_share(CURL*, curl_lock_data data, void* userptr) {
+    (*static_cast<ShareLocks*>(userptr))[data].unlock();
+}
+
+struct Transfer {
+    CURL* easy = nullptr;
+    const FetchEngine::Handlers* handlers = nullptr;
+    bool body_started = false;
+    curl_slist* headers = nullptr;
+    FetchResult result;
+};
+
+size_t write_callback(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    auto* transfer = static_cast<Transfer*>(userdata);
+    FetchResult& result = transfer->result;
+    size_t total = size * nmemb;
+    bool streaming = transfer->handlers && transfer->handlers->open_sink;
+    if (!transfer->body_started) {
+        transfer->body_started = true;
+        curl_off_t length = -1;
+        curl_easy_getinfo(transfer->easy, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+        result.content_length = length;
+        curl_easy_getinfo(transfer->easy, CURLINFO_RESPONSE_CODE, &result.status);
+        if (streaming) {
+            result.sink = transfer->handlers->open_sink(result);
+            result.rejected = !result.sink;
+        }
+    }
+    if (!streaming) {
+        result.body.append(ptr, total);
+        return total;
+    }
+    if (result.rejected || !result.sink->write(std::string_view(ptr, total))) {
+        // Anything but `total` makes curl abort with CURLE_WRITE_ERROR.
+        result.rejected = true;
+        return 0;
+    }
+    return total;
+}
+
+size_t header_callback(char* buffer, size_t size, size_t nitems, void* userdata) {
+    size_t total = size * nitems;
+    auto* transfer = static_cast<Transfer*>(userdata);
+    std::string_view header(buffer, total);
+    if (starts_with_icase(header, "http/")) {
+        // A new status line starts the headers of the next hop in a redirect chain.
+        transfer->result.content_type.clear();
+        transfer->result.content_encoding.clear();
+        transfer->result.retry_after.clear();
+        transfer->result.etag.clear();
+        transfer->result.last_modified.clear();
+    } else if (starts_with_icase(header, "content-type:")) {
+        transfer->result.content_type = trim(std::string(header.substr(header.find(':') + 1)));
+    } else if (starts_with_icase(header, "content-encoding:")) {
+        transfer->result.content_encoding = trim(std::string(header.substr(header.find(':') + 1)));
+    } else if (starts_with_icase(header, "retry-after:")) {
+        transfer->result.retry_after = trim(std::string(header.substr(header.find(':') + 1)));
+    } else if (starts_with_icase(header, "etag:")) {
+        transfer->result.etag = trim(std::string(header.substr(header.find(':') + 1)));
+    } else if (starts_with_icase(header, "last-modified:")) {
+        transfer->result.last_modified = trim(std::string(header.substr(header.find(':') + 1)));
+    }
+    return total;
+}
+
+void configure_handle(CURL* easy, Transfer* transfer, const FetchEngineOptions& options) {
+    curl_easy_setopt(easy, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(easy, CURLOPT_USERAGENT, options.user_agent.c_str());
+    curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(easy, CURLOPT_WRITEDATA, transfer);
+    curl_easy_setopt(easy, CURLOPT_HEADERFUNCTION, header_callback);
+    curl_easy_setopt(easy, CURLOPT_HEADERDATA, transfer);
+    curl_easy_setopt(easy, CURLOPT_PRIVATE, transfer);
+    curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, static_cast<long>(options.timeout_seconds * 1000));
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, static_cast<long>(CURL_HTTP_VERSION_2TLS));
+    curl_easy_setopt(easy, CURLOPT_PIPEWAIT, 1L);
+    curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(easy, CURLOPT_DNS_CACHE_TIMEOUT, options.dns_cache_seconds);
+    if (options.compressed) {
+        curl_easy_setopt(easy, CURLOPT_ACCEPT_ENCODING, options.raw_encoded ? "gzip, deflate" : "");
+        curl_easy_setopt(easy, CURLOPT_HTTP_CONTENT_DECODING, options.raw_encoded ? 0L : 1L);
+    }
+    if (options.share) {
+        options.share->attach(easy);
+    }
+}
+
+// Replaces the transfer's conditional-request headers with those of
+// `request` (none when it carries no validators).
+void set_validators(Transfer& transfer, const FetchRequest& request) {
+    curl_slist_free_all(transfer.headers);
+    transfer.headers = nullptr;
+    if (!request.etag.empty()) {
+        transfer.headers = curl_slist_append(transfer.headers, ("If-None-Match: " + request.etag).c_str());
+    }
+    if (!request.last_modified.empty()) {
+        transfer.headers = curl_slist_append(transfer.headers, ("If-Modified-Since: " + request.last_modified).c_str());
+    }
+    curl_easy_setopt(transfer.easy, CURLOPT_HTTPHEADER, transfer.headers);
+}
+
+// curl reports each phase as the time from the start of the transfer until
+// it ended; the differences are the phase durations.
+TransferTimings read_timings(CURL* easy) {
+    curl_off_t namelookup = 0, connect = 0, appconnect = 0, pretransfer = 0, starttransfer = 0, total = 0;
+    curl_easy_getinfo(easy, CURLINFO_NAMELOOKUP_TIME_T, &namelookup);
+    curl_easy_getinfo(easy, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(easy, CURLINFO_APPCONNECT_TIME_T, &appconnect);
+    curl_easy_getinfo(easy, CURLINFO_PRETRANSFER_TIME_T, &pretransfer);
+    curl_easy_getinfo(easy, CURLINFO_STARTTRANSFER_TIME_T, &starttransfer);
+    curl_easy_getinfo(easy, CURLINFO_TOTAL_TIME_T, &total);
+    TransferTimings timings;
+    timings.dns_us = namelookup;
+    timings.connect_us = std::max<curl_off_t>(0, connect - namelookup);
+    timings.tls_us = appconnect > 0 ? std::max<curl_off_t>(0, appconnect - connect) : 0;
+    timings.ttfb_us = starttransfer > 0 ? std::max<curl_off_t>(0, starttransfer - pretransfer) : 0;
+    timings.transfer_us = std::max<curl_off_t>(0, total - std::max(starttransfer, pretransfer));
+    return timings;
+}
+
+// Fills in the outcome of a finished transfer from its easy handle.
+void finish_result(CURL* easy, CURLcode code, FetchResult& result) {
+    result.ok = code == CURLE_OK;
+    curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &result.status);
+    curl_off_t downloaded = 0;
+    curl_easy_getinfo(easy, CURLINFO_SIZE_DOWNLOAD_T, &downloaded);
+    result.bytes_received = downloaded;
+    result.timings = read_timings(easy);
+    if (result.rejected) {
+        result.ok = false;
+    } else if (!result.ok) {
+        std::cerr << "Failed to fetch " << result.url << ": " << curl_easy_strerror(code) << "\n";
+        result.body.clear();
+    }
+}
+
+}  // namespace
+
+struct FetchShare::State {
+    CURLSH* share = nullptr;
+    ShareLocks locks;
+};
+
+FetchShare::FetchShare() : state_(std::make_unique<State>()) {
+    state_->share = curl_share_init();
+    if (!state_->share) {
+        std::cerr << "Failed to create the curl share; handles keep separate caches\n";
+        return;
+    }
+    curl_share_setopt(state_->share, CURLSHOPT_LOCKFUNC, lock_share);
+    curl_share_setopt(state_->share, CURLSHOPT_UNLOCKFUNC, unlock_share);
+    curl_share_setopt(state_->share, CURLSHOPT_USERDATA, &state_->locks);
+    curl_share_setopt(state_->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(state_->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    // Not CURL_LOCK_DATA_CONNECT: libcurl does not support using a shared
+    // connection cache from several threads at once. Each engine thread's
+    // multi handle keeps its own pool.
+}
+
+FetchShare::~FetchShare() {
+    if (state_->share) {
+        curl_share_cleanup(state_->share);
+    }
+}
+
+void FetchShare::attach(void* easy) const {
+    if (state_->share) {
+        curl_easy_setopt(static_cast<CURL*>(easy), CURLOPT_SHARE, state_->share);
+    }
+}
+
+FetchResult fetch_once(const std::string& url, const FetchEngineOptions& options) {
+    Transfer transfer;
+    transfer.result.url = url;
+    transfer.easy = curl_easy_init();
+    if (!transfer.easy) {
+        return std::move(transfer.result);
+    }
+    configure_handle(transfer.easy, &transfer, options);
+    curl_easy_setopt(transfer.easy, CURLOPT_HTTP_CONTENT_DECODING, 1L);
+    curl_easy_setopt(transfer.easy, CURLOPT_URL, url.c_str());
+    CURLcode code = curl_easy_perform(transfer.easy);
+    finish_result(transfer.easy, code, transfer.result);
+    curl_easy_cleanup(transfer.easy);
+    return std::move(transfer.result);
+}
+
+size_t preresolve(const std::vector<std::string>& origins, const FetchEngineOptions& options) {
+    CURLM* multi = curl_multi_init();
+    if (!multi) {
+        return 0;
+    }
+    std::vector<std::unique_ptr<Transfer>> transfers;
+    for (const auto& origin : origins) {
+        auto transfer = std::make_unique<Transfer>();
+        transfer->easy = curl_easy_init();
+        if (!transfer->easy) {
+            continue;
+        }
+        configure_handle(transfer->easy, transfer.get(), options);
+        transfer->result.url = origin;
+        curl_easy_setopt(transfer->easy, CURLOPT_URL, transfer->result.url.c_str());
+        curl_easy_setopt(transfer->easy, CURLOPT_CONNECT_ONLY, 1L);
+        curl_multi_add_handle(multi, transfer->easy);
+        transfers.push_back(std::move(transfer));
+    }
+    size_t resolved = 0;
+    int running = 1;
+    while (running > 0) {
+        curl_multi_perform(multi, &running);
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi, &queued)) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            Transfer* transfer = nullptr;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &transfer);
+            if (msg->data.result == CURLE_OK) {
+                ++resolved;
+            } else {
+                std::cerr << "Failed to pre-resolve " << transfer->result.url << ": "
+                          << curl_easy_strerror(msg->data.result) << "\n";
+            }
+        }
+        if (running > 0) {
+            curl_multi_poll(multi, nullptr, 0, static_cast<int>(kIdlePoll.count()), nullptr);
+        }
+    }
+    for (auto& transfer : transfers) {
+        curl_multi_remove_handle(multi, transfer->easy);
+        curl_easy_cleanup(transfer->easy);
+    }
+    curl_multi_cleanup(multi);
+    return resolved;
+}
+
+struct FetchEngine::Worker {
+    CURLM* multi = nullptr;
+    std::vector<std::unique_ptr<Transfer>> pool;
+    std::vector<Transfer*> free;
+    // Set while the worker may block in curl_multi_poll; notify() only pays
+    // for a wakeup when it is set.
+    std::atomic<bool> wakeable {false};
+};
+
+FetchEngine::FetchEngine(FetchEngineOptions options, Handlers handlers)
+    : options_(std::move(options)),
+      handlers_(std::move(handlers)) {
+    int threads = std::max(1, options_.threads);
+    int per_thread = std::max(1, (options_.max_in_flight + threads - 1) / threads);
+    for (int i = 0; i < threads; ++i) {
+        auto worker = std::make_unique<Worker>();
+        worker->multi = curl_multi_init();
+        curl_multi_setopt(worker->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        curl_multi_setopt(worker->multi, CURLMOPT_MAX_HOST_CONNECTIONS, options_.max_host_connections);
+        for (int slot = 0; slot < per_thread; ++slot) {
+            auto transfer = std::make_unique<Transfer>();
+            CURL* easy = curl_easy_init();
+            configure_handle(easy, transfer.get(), options_);
+            transfer->easy = easy;
+            transfer->handlers = &handlers_;
+            worker->free.push_back(transfer.get());
+            worker->pool.push_back(std::move(transfer));
+        }
+        workers_.push_back(std::move(worker));
+    }
+}
+
+FetchEngine::~FetchEngine() {
+    stop();
+    for (auto& worker : workers_) {
+        for (auto& transfer : worker->pool) {
+            curl_multi_remove_handle(worker->multi, transfer->easy);
+            curl_easy_cleanup(transfer->easy);
+            curl_slist_free_all(transfer->headers);
+        }
+        curl_multi_cleanup(worker->multi);
+    }
+}
+
+void FetchEngine::start() {
+    for (auto& worker : workers_) {
+        threads_.emplace_back([this, w = worker.get()] { run_worker(*w); });
+    }
+}
+
+void FetchEngine::stop() {
+    stop_.store(true);
+    for (auto& worker : workers_) {
+        curl_multi_wakeup(worker->multi);
+    }
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+}
+
+void FetchEngine::notify() {
+    for (auto& worker : workers_) {
+        if (worker->wakeable.exchange(false)) {
+            curl_multi_wakeup(worker->multi);
+        }
+    }
+}
+
+void FetchEngine::run_worker(Worker& worker) {
+    while (!stop_.load()) {
+        // Armed before asking for work: a request published after `next`
+        // comes back empty will see the flag and wake the poll below.
+        worker.wakeable.store(true);
+        std::chrono::milliseconds wait = kIdlePoll;
+        while (!worker.free.empty()) {
+            auto request = handlers_.next(wait);
+            if (!request) {
+                break;
+            }
+            Transfer* transfer = worker.free.back();
+            worker.free.pop_back();
+            transfer->result = FetchResult {};
+            transfer->body_started = false;
+            set_validators(*transfer, *request);
+            transfer->result.url = std::move(request->url);
+            transfer->result.attempt = request->attempt;
+            transfer->result.depth = request->depth;
+            transfer->result.priority = request->priority;
+            curl_easy_setopt(transfer->easy, CURLOPT_URL, transfer->result.url.c_str());
+            curl_multi_add_handle(worker.multi, transfer->easy);
+        }
+
+        int running = 0;
+        curl_multi_perform(worker.multi, &running);
+
+        bool completed = false;
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(worker.multi, &queued)) {
+            if (msg->msg != CURLMSG_DONE) {
+                continue;
+            }
+            Transfer* transfer = nullptr;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &transfer);
+            curl_multi_remove_handle(worker.multi, msg->easy_handle);
+            FetchResult result = std::move(transfer->result);
+            finish_result(transfer->easy, msg->data.result, result);
+            worker.free.push_back(transfer);
+            handlers_.done(std::move(result));
+            completed = true;
+        }
+        if (completed) {
+            continue;
+        }
+        curl_multi_poll(worker.multi, nullptr, 0, static_cast<int>(wait.count()), nullptr);
+    }
+}
+
+}  // namespace crawler
@@ -0,0 +1,122 @@
+#include "fetch_state.hpp"
+
+#include "atomic_file.hpp"
+#include "segment_store.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace crawler {
+
+namespace {
+
+// Header values are single-line, but keep the TSV intact regardless.
+std::string field(const std::string& value) {
+    std::string out = value;
+    for (char& c : out) {
+        if (c == '\t' || c == '\n' || c == '\r') {
+            c = ' ';
+        }
+    }
+    return out;
+}
+
+std::vector<std::string_view> split_tabs(std::string_view line) {
+    std::vector<std::string_view> fields;
+    size_t start = 0;
+    while (true) {
+        size_t tab = line.find('\t', start);
+        fields.push_back(line.substr(start, tab == std::string_view::npos ? std::string_view::npos : tab - start));
+        if (tab == std::string_view::npos) {
+            return fields;
+        }
+        start = tab + 1;
+    }
+}
+
+}  // namespace
+
+size_t FetchStateStore::load(const std::filesystem::path& path) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        return 0;
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    std::string line;
+    std::getline(in, line);
+    while (std::getline(in, line)) {
+        auto fields = split_tabs(line);
+        // Files from before the simhash and fetched_at columns have fewer fields.
+        if (fields.size() < 6 || fields.size() > 8) {
+            continue;
+        }
+        FetchState state;
+        state.etag = fields[1];
+        state.last_modified = fields[2];
+        state.content_hash = std::strtoull(std::string(fields[3]).c_str(), nullptr, 16);
+        state.path = fields[4];
+        state.content_type = fields[5];
+        if (fields.size() >= 7) {
+            state.simhash = std::strtoull(std::string(fields[6]).c_str(), nullptr, 16);
+        }
+        if (fields.size() == 8) {
+            state.fetched_at = std::strtoll(std::string(fields[7]).c_str(), nullptr, 10);
+        }
+        std::error_code ec;
+        if (!state.path.empty() && !std::filesystem::exists(location_file(state.path), ec)) {
+            continue;
+        }
+        states_[std::string(fields[0])] = std::move(state);
+    }
+    return states_.size();
+}
+
+bool FetchStateStore::save(const std::filesystem::path& path) const {
+    return write_file_atomically(path, [this](std::ofstream& out) {
+        out << "url\tetag\tlast_modified\tcontent_hash\tpath\tcontent_type\tsimhash\tfetched_at\n";
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        for (const auto& [url, state] : states_) {
+            out << url << '\t' << field(state.etag) << '\t' << field(state.last_modified) << '\t' << std::hex
+                << state.content_hash << std::dec << '\t' << state.path << '\t' << field(state.content_type) << '\t'
+                << std::hex << state.simhash << std::dec << '\t' << state.fetched_at << '\n';
+        }
+    });
+}
+
+std::optional<FetchState> FetchStateStore::find(const std::string& url) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = states_.find(url);
+    if (it == states_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void FetchStateStore::update(const std::string& url, FetchState state) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    states_[url] = std::move(state);
+}
+
+bool FetchStateStore::erase(const std::string& url) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    return states_.erase(url) > 0;
+}
+
+void FetchStateStore::for_each(const std::function<void(const std::string& url, const FetchState& state)>& fn) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    for (const auto& [url, state] : states_) {
+        fn(url, state);
+    }
+}
+
+size_t FetchStateStore::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return states_.size();
+}
+
+}  // namespace crawler
@@ -0,0 +1,177 @@
+#include "graph_store.hpp"
+
+#include "atomic_file.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+namespace crawler {
+
+namespace {
+
+constexpr char kGraphMagic[8] = {'F', 'G', 'G', 'R', 'A', 'P', 'H', '1'};
+// Short strings (doc types, content types, domains) repeat on most nodes.
+constexpr size_t kMaxSharedString = 256;
+
+struct StringRef {
+    uint64_t offset = 0;
+    uint64_t length = 0;
+};
+
+struct NodeRecord {
+    StringRef url;
+    StringRef path;
+    StringRef content_type;
+    StringRef doc_type;
+    StringRef title;
+    StringRef domain;
+    StringRef snippet;
+    StringRef text;
+    uint32_t word_count = 0;
+    int32_t duplicate_of = -1;
+    uint32_t flags = 0;
+    uint32_t reserved = 0;
+};
+static_assert(sizeof(NodeRecord) == 144, "graph store node records are 144 bytes");
+
+struct Header {
+    char magic[8];
+    uint64_t node_count;
+    uint64_t edge_count;
+    uint64_t metric_count;
+    uint64_t strings_size;
+    uint64_t nodes;
+    uint64_t edge_offsets;
+    uint64_t edge_targets;
+    uint64_t edge_anchors;
+    uint64_t metric_names;
+    uint64_t metric_values;
+    uint64_t strings;
+};
+
+class StringTable {
+   public:
+    StringRef add(std::string_view value) {
+        if (value.size() <= kMaxSharedString) {
+            auto it = shared_.find(value);
+            if (it != shared_.end()) {
+                return it->second;
+            }
+        }
+        StringRef ref {bytes_.size(), value.size()};
+        bytes_.append(value);
+        if (value.size() <= kMaxSharedString) {
+            shared_.emplace(value, ref);
+        }
+        return ref;
+    }
+
+    const std::string& bytes() const { return bytes_; }
+
+   private:
+    std::string bytes_;
+    // Keys view the caller's strings, which outlive the table.
+    std::unordered_map<std::string_view, StringRef> shared_;
+};
+
+uint64_t align8(uint64_t offset) {
+    return (offset + 7) & ~uint64_t {7};
+}
+
+void pad_to(std::ofstream& out, uint64_t& written, uint64_t offset) {
+    static const char kZeros[8] = {};
+    out.write(kZeros, static_cast<std::streamsize>(offset - written));
+    written = offset;
+}
+
+template <typename T>
+void write_array(std::ofstream& out, uint64_t& written, const std::vector<T>& values) {
+    out.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+    written += values.size() * sizeof(T);
+}
+
+}  // namespace
+
+bool write_graph_store(const std::filesystem::path& path, const std::vector<GraphStoreNode>& nodes,
+                       std::vector<GraphStoreEdge> edges, const std::vector<GraphStoreMetric>& metrics) {
+    StringTable strings;
+    std::vector<NodeRecord> records(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        const GraphStoreNode& node = nodes[i];
+        NodeRecord& record = records[i];
+        record.url = strings.add(node.url);
+        record.path = strings.add(node.path);
+        record.content_type = strings.add(node.content_type);
+        record.doc_type = strings.add(node.doc_type);
+        record.title = strings.add(node.title);
+        record.domain = strings.add(node.domain);
+        record.text = strings.add(node.text);
+        // The snippet is normally the start of the text; share its bytes.
+        record.snippet = node.text.starts_with(node.snippet) ? StringRef {record.text.offset, node.snippet.size()}
+                                                             : strings.add(node.snippet);
+        record.word_count = node.word_count;
+        record.duplicate_of = node.duplicate_of;
+        record.flags = node.flags;
+    }
+
+    std::stable_sort(edges.begin(), edges.end(),
+                     [](const GraphStoreEdge& a, const GraphStoreEdge& b) { return a.source < b.source; });
+    std::vector<uint64_t> offsets(nodes.size() + 1, 0);
+    std::vector<uint32_t> targets;
+    std::vector<StringRef> anchors;
+    targets.reserve(edges.size());
+    anchors.reserve(edges.size());
+    for (const auto& edge : edges) {
+        ++offsets[edge.source + 1];
+        targets.push_back(edge.target);
+        anchors.push_back(strings.add(edge.anchor));
+    }
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    std::vector<StringRef> metric_names;
+    for (const auto& metric : metrics) {
+        metric_names.push_back(strings.add(metric.name));
+    }
+
+    Header header {};
+    std::copy(std::begin(kGraphMagic), std::end(kGraphMagic), header.magic);
+    header.node_count = nodes.size();
+    header.edge_count = edges.size();
+    header.metric_count = metrics.size();
+    header.strings_size = strings.bytes().size();
+    header.nodes = align8(sizeof(Header));
+    header.edge_offsets = align8(header.nodes + records.size() * sizeof(NodeRecord));
+    header.edge_targets = align8(header.edge_offsets + offsets.size() * sizeof(uint64_t));
+    header.edge_anchors = align8(header.edge_targets + targets.size() * sizeof(uint32_t));
+    header.metric_names = align8(header.edge_anchors + anchors.size() * sizeof(StringRef));
+    header.metric_values = align8(header.metric_names + metric_names.size() * sizeof(StringRef));
+    header.strings = align8(header.metric_values + metrics.size() * nodes.size() * sizeof(double));
+
+    return write_file_atomically(path, [&](std::ofstream& out) {
+        uint64_t written = 0;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        written += sizeof(header);
+        pad_to(out, written, header.nodes);
+        write_array(out, written, records);
+        pad_to(out, written, header.edge_offsets);
+        write_array(out, written, offsets);
+        pad_to(out, written, header.edge_targets);
+        write_array(out, written, targets);
+        pad_to(out, written, header.edge_anchors);
+        write_array(out, written, anchors);
+        pad_to(out, written, header.metric_names);
+        write_array(out, written, metric_names);
+        pad_to(out, written, header.metric_values);
+        for (const auto& metric : metrics) {
+            write_array(out, written, metric.values);
+        }
+        pad_to(out, written, header.strings);
+        out.write(strings.bytes().data(), static_cast<std::streamsize>(strings.bytes().size()));
+    });
+}
+
+}  // namespace crawler
@@ -0,0 +1,202 @@
+#include "host_frontier.hpp"
+
+#include "hash.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+
+namespace crawler {
+
+namespace {
+
+HostFrontier::Clock::duration to_duration(double seconds) {
+    return std::chrono::duration_cast<HostFrontier::Clock::duration>(std::chrono::duration<double>(std::max(0.0, seconds)));
+}
+
+}  // namespace
+
+HostFrontier::HostFrontier(double default_interval_seconds)
+    : default_interval_(to_duration(default_interval_seconds)) {}
+
+void HostFrontier::set_interval(const std::string& host, double seconds) {
+    host_queue(host).interval = to_duration(seconds);
+}
+
+void HostFrontier::push(const std::string& host, FetchRequest request) {
+    HostQueue& queue = host_queue(host);
+    add(queue, std::move(request), false);
+    if (!queue.scheduled) {
+        schedule(queue);
+    }
+}
+
+void HostFrontier::push_front(const std::string& host, FetchRequest request) {
+    HostQueue& queue = host_queue(host);
+    add(queue, std::move(request), true);
+    if (!queue.scheduled) {
+        schedule(queue);
+    }
+}
+
+void HostFrontier::push_later(const std::string& host, FetchRequest request, Clock::time_point at) {
+    delayed_.push_back({at, host, std::move(request)});
+    std::push_heap(delayed_.begin(), delayed_.end(), std::greater<Delayed>());
+    ++size_;
+}
+
+void HostFrontier::set_limit(const std::string& host, int limit) {
+    HostQueue& queue = host_queue(host);
+    queue.limit = std::max(0, limit);
+    reschedule(queue);
+}
+
+void HostFrontier::finish(const std::string& host) {
+    HostQueue& queue = host_queue(host);
+    queue.in_flight = std::max(0, queue.in_flight - 1);
+    reschedule(queue);
+}
+
+void HostFrontier::promote(const std::string& host, std::string_view url, int levels) {
+    auto found = hosts_.find(host);
+    if (found == hosts_.end() || levels <= 0) {
+        return;
+    }
+    HostQueue& queue = found->second;
+    uint64_t fingerprint = hash_bytes(url);
+    auto it = queue.requests.find(fingerprint);
+    if (it == queue.requests.end() || it->second.priority == kPriorityLevels - 1) {
+        return;
+    }
+    int level = std::min(it->second.priority + levels, kPriorityLevels - 1);
+    it->second.priority = static_cast<uint8_t>(level);
+    queue.buckets[level].push_back(fingerprint);
+    queue.nonempty |= uint32_t {1} << level;
+}
+
+void HostFrontier::defer(const std::string& host, Clock::time_point now, Clock::duration delay) {
+    HostQueue& queue = host_queue(host);
+    queue.next_allowed = std::max(queue.next_allowed, now + delay);
+}
+
+std::optional<FetchRequest> HostFrontier::pop(Clock::time_point now, std::chrono::milliseconds& wait) {
+    release_delayed(now);
+    if (!delayed_.empty()) {
+        wait = std::min(wait, std::chrono::ceil<std::chrono::milliseconds>(delayed_.front().at - now));
+    }
+    while (!ready_.empty()) {
+        Slot slot = ready_.top();
+        HostQueue& queue = *slot.host;
+        if (slot.at < queue.next_allowed) {
+            // The host was deferred after this slot was scheduled.
+            ready_.pop();
+            ready_.push({queue.next_allowed, &queue});
+            continue;
+        }
+        if (slot.at > now) {
+            wait = std::min(wait, std::chrono::ceil<std::chrono::milliseconds>(slot.at - now));
+            return std::nullopt;
+        }
+        ready_.pop();
+        queue.scheduled = false;
+        if (saturated(queue)) {
+            // finish() puts the host back once a request completes.
+            continue;
+        }
+        auto request = take(queue);
+        if (!request) {
+            continue;
+        }
+        ++queue.in_flight;
+        queue.next_allowed = now + queue.interval;
+        if (!queue.requests.empty() && !saturated(queue)) {
+            schedule(queue);
+        }
+        return request;
+    }
+    return std::nullopt;
+}
+
+void HostFrontier::append_urls(std::vector<std::string>& out) const {
+    out.reserve(out.size() + size_);
+    for (const auto& [host, queue] : hosts_) {
+        for (const auto& [fingerprint, request] : queue.requests) {
+            out.push_back(request.url);
+        }
+    }
+    for (const auto& delayed : delayed_) {
+        out.push_back(delayed.request.url);
+    }
+}
+
+HostFrontier::HostQueue& HostFrontier::host_queue(const std::string& host) {
+    auto [it, inserted] = hosts_.try_emplace(host);
+    if (inserted) {
+        it->second.interval = default_interval_;
+    }
+    return it->second;
+}
+
+void HostFrontier::release_delayed(Clock::time_point now) {
+    while (!delayed_.empty() && delayed_.front().at <= now) {
+        std::pop_heap(delayed_.begin(), delayed_.end(), std::greater<Delayed>());
+        Delayed due = std::move(delayed_.back());
+        delayed_.pop_back();
+        --size_;
+        push_front(due.host, std::move(due.request));
+    }
+}
+
+// Puts a host that pop() set aside at its limit back in line.
+void HostFrontier::reschedule(HostQueue& queue) {
+    if (!queue.scheduled && !queue.requests.empty() && !saturated(queue)) {
+        schedule(queue);
+    }
+}
+
+void HostFrontier::schedule(HostQueue& queue) {
+    ready_.push({queue.next_allowed, &queue});
+    queue.scheduled = true;
+}
+
+void HostFrontier::add(HostQueue& queue, FetchRequest request, bool front) {
+    uint64_t fingerprint = hash_bytes(request.url);
+    int level = std::min<int>(request.priority, kPriorityLevels - 1);
+    request.priority = static_cast<uint8_t>(level);
+    auto [it, inserted] = queue.requests.insert_or_assign(fingerprint, std::move(request));
+    if (inserted) {
+        ++size_;
+    }
+    auto& bucket = queue.buckets[level];
+    if (front) {
+        bucket.push_front(fingerprint);
+    } else {
+        bucket.push_back(fingerprint);
+    }
+    queue.nonempty |= uint32_t {1} << level;
+}
+
+// Pops from the highest non-empty bucket, dropping entries left behind by
+// promote() (or by a request pushed again) on the way.
+std::optional<FetchRequest> HostFrontier::take(HostQueue& queue) {
+    while (queue.nonempty != 0) {
+        int level = std::bit_width(queue.nonempty) - 1;
+        auto& bucket = queue.buckets[level];
+        uint64_t fingerprint = bucket.front();
+        bucket.pop_front();
+        if (bucket.empty()) {
+            queue.nonempty &= ~(uint32_t {1} << level);
+        }
+        auto it = queue.requests.find(fingerprint);
+        if (it == queue.requests.end() || it->second.priority != level) {
+            continue;
+        }
+        FetchRequest request = std::move(it->second);
+        queue.requests.erase(it);
+        --size_;
+        return request;
+    }
+    return std::nullopt;
+}
+
+}  // namespace crawler
@@ -0,0 +1,340 @@
+#include "html_links.hpp"
+
+#include "string_util.hpp"
+
+#include <cstring>
+
+namespace crawler {
+
+namespace {
+
+// Appends a lowercase character to a fixed name buffer. Names longer than
+// the buffer are marked with length capacity + 1 so they never match.
+inline void append_name(char* buffer, uint8_t& length, size_t capacity, char c) {
+    if (length < capacity) {
+        buffer[length++] = ascii_lower(c);
+    } else {
+        length = static_cast<uint8_t>(capacity + 1);
+    }
+}
+
+// Decodes the character references in storage[from..] in place.
+void decode_references(std::string& storage, size_t from) {
+    if (storage.find('&', from) == std::string::npos) {
+        return;
+    }
+    std::string decoded;
+    append_decoded(decoded, std::string_view(storage).substr(from));
+    storage.resize(from);
+    storage += decoded;
+}
+
+}  // namespace
+
+// Keeps the buffers' capacity so one extractor can be reused across pages.
+void LinkExtractor::reset() {
+    state_ = State::Data;
+    tag_length_ = 0;
+    attribute_length_ = 0;
+    capture_ = false;
+    dashes_ = 0;
+    raw_match_ = 0;
+    storage_.clear();
+    spans_.clear();
+    base_.reset();
+}
+
+std::string_view LinkExtractor::link(size_t index) const {
+    const Span& span = spans_[index];
+    return std::string_view(storage_).substr(span.first, span.second);
+}
+
+std::optional<std::string_view> LinkExtractor::base_href() const {
+    if (!base_) {
+        return std::nullopt;
+    }
+    return std::string_view(storage_).substr(base_->first, base_->second);
+}
+
+bool LinkExtractor::tag_is(std::string_view name) const {
+    return tag_length_ == name.size() && std::memcmp(tag_, name.data(), name.size()) == 0;
+}
+
+bool LinkExtractor::attribute_is(std::string_view name) const {
+    return attribute_length_ == name.size() && std::memcmp(attribute_, name.data(), name.size()) == 0;
+}
+
+void LinkExtractor::start_value() {
+    capture_ = attribute_is("href") || (attribute_is("src") && !tag_is("base"));
+    value_start_ = storage_.size();
+}
+
+void LinkExtractor::finish_value() {
+    if (!capture_) {
+        return;
+    }
+    capture_ = false;
+    decode_references(storage_, value_start_);
+    std::string_view value(storage_.data() + value_start_, storage_.size() - value_start_);
+    size_t lead = 0;
+    while (lead < value.size() && is_space(value[lead])) {
+        ++lead;
+    }
+    size_t tail = value.size();
+    while (tail > lead && is_space(value[tail - 1])) {
+        --tail;
+    }
+    if (tail == lead) {
+        storage_.resize(value_start_);
+        return;
+    }
+    Span span {static_cast<uint32_t>(value_start_ + lead), static_cast<uint32_t>(tail - lead)};
+    if (tag_is("base")) {
+        if (!base_) {
+            base_ = span;
+        }
+        return;
+    }
+    spans_.push_back(span);
+}
+
+void LinkExtractor::finish_tag() {
+    if (tag_is("script")) {
+        state_ = State::RawText;
+        raw_end_ = "</script";
+    } else if (tag_is("style")) {
+        state_ = State::RawText;
+        raw_end_ = "</style";
+    } else {
+        state_ = State::Data;
+    }
+    raw_match_ = 0;
+}
+
+void LinkExtractor::feed(std::string_view chunk) {
+    const char* data = chunk.data();
+    size_t size = chunk.size();
+    size_t i = 0;
+    while (i < size) {
+        char c = data[i];
+        switch (state_) {
+            case State::Data: {
+                const void* next = std::memchr(data + i, '<', size - i);
+                if (!next) {
+                    return;
+                }
+                i = static_cast<size_t>(static_cast<const char*>(next) - data) + 1;
+                state_ = State::TagOpen;
+                continue;
+            }
+            case State::TagOpen:
+                if (c == '!') {
+                    state_ = State::MarkupDeclaration;
+                    dashes_ = 0;
+                } else if (c == '/') {
+                    state_ = State::EndTag;
+                } else if (is_alpha(c)) {
+                    state_ = State::TagName;
+                    tag_length_ = 0;
+                    append_name(tag_, tag_length_, kNameCapacity, c);
+                } else if (c == '?') {
+                    state_ = State::BogusComment;
+                } else if (c != '<') {
+                    state_ = State::Data;
+                }
+                ++i;
+                continue;
+            case State::MarkupDeclaration:
+                if (c == '-' && ++dashes_ == 2) {
+                    state_ = State::Comment;
+                    dashes_ = 0;
+                    ++i;
+                } else if (c != '-') {
+                    state_ = State::BogusComment;
+                } else {
+                    ++i;
+                }
+                continue;
+            case State::Comment:
+                if (dashes_ == 0) {
+                    const void* next = std::memchr(data + i, '-', size - i);
+                    if (!next) {
+                        return;
+                    }
+                    i = static_cast<size_t>(static_cast<const char*>(next) - data) + 1;
+                    dashes_ = 1;
+                    continue;
+                }
+                if (c == '-') {
+                    if (dashes_ < 2) {
+                        ++dashes_;
+                    }
+                } else if (c == '>' && dashes_ >= 2) {
+                    state_ = State::Data;
+                    dashes_ = 0;
+                } else {
+                    dashes_ = 0;
+                }
+                ++i;
+                continue;
+            case State::BogusComment:
+            case State::EndTag: {
+                const void* next = std::memchr(data + i, '>', size - i);
+                if (!next) {
+                    return;
+                }
+                i = static_cast<size_t>(static_cast<const char*>(next) - data) + 1;
+                state_ = State::Data;
+                continue;
+            }
+            case State::TagName:
+                if (is_space(c) || c == '/') {
+                    state_ = State::BeforeAttributeName;
+                } else if (c == '>') {
+                    finish_tag();
+                } else {
+                    append_name(tag_, tag_length_, kNameCapacity, c);
+                }
+                ++i;
+                continue;
+            case State::BeforeAttributeName:
+                if (c == '>') {
+                    finish_tag();
+                } else if (!is_space(c) && c != '/') {
+                    state_ = State::AttributeName;
+                    attribute_length_ = 0;
+                    append_name(attribute_, attribute_length_, kNameCapacity, c);
+                }
+                ++i;
+                continue;
+            case State::AttributeName:
+                if (c == '=') {
+                    state_ = State::BeforeAttributeValue;
+                } else if (is_space(c)) {
+                    state_ = State::AfterAttributeName;
+                } else if (c == '/') {
+                    state_ = State::BeforeAttributeName;
+                } else if (c == '>') {
+                    finish_tag();
+                } else {
+                    append_name(attribute_, attribute_length_, kNameCapacity, c);
+                }
+                ++i;
+                continue;
+            case State::AfterAttributeName:
+                if (c == '=') {
+                    state_ = State::BeforeAttributeValue;
+                } else if (c == '>') {
+                    finish_tag();
+                } else if (c == '/') {
+                    state_ = State::BeforeAttributeName;
+                } else if (!is_space(c)) {
+                    state_ = State::AttributeName;
+                    attribute_length_ = 0;
+                    append_name(attribute_, attribute_length_, kNameCapacity, c);
+                }
+                ++i;
+                continue;
+            case State::BeforeAttributeValue:
+                if (is_space(c)) {
+                    ++i;
+                } else if (c == '"' || c == '\'') {
+                    quote_ = c;
+                    start_value();
+                    state_ = State::AttributeValueQuoted;
+                    ++i;
+                } else if (c == '>') {
+                    finish_tag();
+                    ++i;
+                } else {
+                    start_value();
+                    state_ = State::AttributeValueUnquoted;
+                }
+                continue;
+            case State::AttributeValueQuoted: {
+                const void* next = std::memchr(data + i, quote_, size - i);
+                size_t end = next ? static_cast<size_t>(static_cast<const char*>(next) - data) : size;
+                if (capture_) {
+                    storage_.append(data + i, end - i);
+                }
+                if (!next) {
+                    return;
+                }
+                finish_value();
+                state_ = State::BeforeAttributeName;
+                i = end + 1;
+                continue;
+            }
+            case State::AttributeValueUnquoted:
+                if (is_space(c)) {
+                    finish_value();
+                    state_ = State::BeforeAttributeName;
+                } else if (c == '>') {
+                    finish_value();
+                    finish_tag();
+                } else if (capture_) {
+                    storage_.push_back(c);
+                }
+                ++i;
+                continue;
+            case State::RawText:
+                if (raw_match_ == 0) {
+                    const void* next = std::memchr(data + i, '<', size - i);
+                    if (!next) {
+                        return;
+                    }
+                    i = static_cast<size_t>(static_cast<const char*>(next) - data) + 1;
+                    raw_match_ = 1;
+                    continue;
+                }
+                if (ascii_lower(c) == raw_end_[raw_match_]) {
+                    ++i;
+                    if (++raw_match_ == raw_end_.size()) {
+                        state_ = State::EndTag;
+                        raw_match_ = 0;
+                    }
+                } else {
+                    // Re-examine this character: it may open the real end tag.
+                    raw_match_ = 0;
+                    if (c != '<') {
+                        ++i;
+                    }
+                }
+                continue;
+        }
+    }
+}
+
+std::vector<CanonicalUrl> extract_links(const LinkExtractor& extractor, const CanonicalUrl& page,
+                                        const NormalizeOptions& options) {
+    std::optional<CanonicalUrl> base;
+    if (auto base_href = extractor.base_href()) {
+        base = resolve_url(&page, *base_href, options);
+    }
+    const CanonicalUrl& resolve_against = base ? *base : page;
+    std::vector<CanonicalUrl> links;
+    links.reserve(extractor.size());
+    for (size_t i = 0; i < extractor.size(); ++i) {
+        if (auto absolute = resolve_url(&resolve_against, extractor.link(i), options)) {
+            links.push_back(std::move(*absolute));
+        }
+    }
+    return links;
+}
+
+void PageLinks::resolve(const LinkExtractor& extractor, const CanonicalUrl& page, const NormalizeOptions& options) {
+    auto base_href = extractor.base_href();
+    const CanonicalUrl& resolve_against =
+        base_href && resolve_url_into(base_, &page, *base_href, options) ? base_ : page;
+    size_ = 0;
+    for (size_t i = 0; i < extractor.size(); ++i) {
+        if (size_ == urls_.size()) {
+            urls_.emplace_back();
+        }
+        if (resolve_url_into(urls_[size_], &resolve_against, extractor.link(i), options)) {
+            ++size_;
+        }
+    }
+}
+
+}  // namespace crawler
@@ -0,0 +1,254 @@
+#include "html_text.hpp"
+
+#include "string_util.hpp"
+#include "text_builder.hpp"
+
+namespace crawler {
+
+namespace {
+
+constexpr size_t kAnchorTextLimit = 200;
+
+std::string_view strip(std::string_view text) {
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t n = space_length(text, start);
+        if (n == 0) {
+            break;
+        }
+        start += n;
+    }
+    size_t end = text.size();
+    while (end > start) {
+        // Walk back to the start of the last UTF-8 character.
+        size_t lead = end - 1;
+        while (lead > start && (static_cast<unsigned char>(text[lead]) & 0xC0) == 0x80) {
+            --lead;
+        }
+        size_t n = space_length(text, lead);
+        if (n == 0 || lead + n != end) {
+            break;
+        }
+        end = lead;
+    }
+    return text.substr(start, end - start);
+}
+
+// Cuts a UTF-8 string to at most `limit` characters.
+void truncate_chars(std::string& text, size_t limit) {
+    size_t chars = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if ((static_cast<unsigned char>(text[i]) & 0xC0) != 0x80 && chars++ == limit) {
+            text.resize(i);
+            return;
+        }
+    }
+}
+
+size_t find_icase(std::string_view haystack, std::string_view needle, size_t from) {
+    while (from < haystack.size()) {
+        size_t lt = haystack.find('<', from);
+        if (lt == std::string_view::npos || haystack.size() - lt < needle.size()) {
+            return std::string_view::npos;
+        }
+        bool match = true;
+        for (size_t j = 1; j < needle.size() && match; ++j) {
+            match = ascii_lower(haystack[lt + j]) == needle[j];
+        }
+        if (match) {
+            return lt;
+        }
+        from = lt + 1;
+    }
+    return std::string_view::npos;
+}
+
+bool is_skipped(std::string_view tag) {
+    return tag == "noscript" || tag == "svg" || tag == "template";
+}
+
+}  // namespace
+
+HtmlText extract_html_text(std::string_view html) {
+    HtmlText result;
+    TextBuilder body;
+    std::string decoded;
+    std::string attribute_value;
+    std::string skip_tag;
+    size_t skip_depth = 0;
+    // Navigation text is left out of the body, but its links still count.
+    size_t nav_depth = 0;
+    bool in_title = false;
+    bool title_done = false;
+    bool in_anchor = false;
+
+    size_t i = 0;
+    while (i < html.size()) {
+        size_t lt = html.find('<', i);
+        size_t text_end = lt == std::string_view::npos ? html.size() : lt;
+        if (text_end > i && skip_depth == 0) {
+            decoded.clear();
+            append_decoded(decoded, html.substr(i, text_end - i));
+            if (nav_depth == 0) {
+                body.add(decoded);
+            }
+            if (in_title && nav_depth == 0) {
+                result.title += decoded;
+            }
+            if (in_anchor) {
+                result.anchors.back().second += strip(decoded);
+            }
+        }
+        if (lt == std::string_view::npos) {
+            break;
+        }
+        i = lt + 1;
+        if (i >= html.size()) {
+            break;
+        }
+
+        if (html.compare(i, 3, "!--") == 0) {
+            size_t end = html.find("-->", i + 3);
+            i = end == std::string_view::npos ? html.size() : end + 3;
+            continue;
+        }
+        if (html[i] == '!' || html[i] == '?') {
+            size_t end = html.find('>', i);
+            i = end == std::string_view::npos ? html.size() : end + 1;
+            continue;
+        }
+        bool closing = html[i] == '/';
+        size_t name_start = closing ? i + 1 : i;
+        if (name_start >= html.size() || !is_alpha(html[name_start])) {
+            if (closing) {
+                size_t end = html.find('>', i);
+                i = end == std::string_view::npos ? html.size() : end + 1;
+            } else if (skip_depth == 0) {
+                // A bare '<' is text.
+                if (nav_depth == 0) {
+                    body.add("<");
+                }
+                if (in_title && nav_depth == 0) {
+                    result.title += '<';
+                }
+                if (in_anchor) {
+                    result.anchors.back().second += '<';
+                }
+            }
+            continue;
+        }
+
+        size_t name_end = name_start;
+        std::string tag;
+        while (name_end < html.size() && !is_space(html[name_end]) && html[name_end] != '/' && html[name_end] != '>') {
+            tag.push_back(ascii_lower(html[name_end++]));
+        }
+
+        // Attributes: only an <a>'s href is kept.
+        bool self_closing = false;
+        bool has_href = false;
+        attribute_value.clear();
+        size_t j = name_end;
+        while (j < html.size() && html[j] != '>') {
+            if (is_space(html[j])) {
+                ++j;
+                continue;
+            }
+            if (html[j] == '/') {
+                self_closing = true;
+                ++j;
+                continue;
+            }
+            self_closing = false;
+            size_t attr_start = j;
+            while (j < html.size() && !is_space(html[j]) && html[j] != '=' && html[j] != '>' && html[j] != '/') {
+                ++j;
+            }
+            std::string_view attr = html.substr(attr_start, j - attr_start);
+            while (j < html.size() && is_space(html[j])) {
+                ++j;
+            }
+            std::string_view value;
+            if (j < html.size() && html[j] == '=') {
+                ++j;
+                while (j < html.size() && is_space(html[j])) {
+                    ++j;
+                }
+                if (j < html.size() && (html[j] == '"' || html[j] == '\'')) {
+                    size_t close = html.find(html[j], j + 1);
+                    size_t end = close == std::string_view::npos ? html.size() : close;
+                    value = html.substr(j + 1, end - j - 1);
+                    j = close == std::string_view::npos ? html.size() : close + 1;
+                } else {
+                    size_t start = j;
+                    while (j < html.size() && !is_space(html[j]) && html[j] != '>') {
+                        ++j;
+                    }
+                    value = html.substr(start, j - start);
+                }
+            }
+            if (!closing && tag == "a" && !has_href && attr.size() == 4 && ascii_lower(attr[0]) == 'h' &&
+                ascii_lower(attr[1]) == 'r' && ascii_lower(attr[2]) == 'e' && ascii_lower(attr[3]) == 'f') {
+                has_href = true;
+                append_decoded(attribute_value, value);
+            }
+        }
+        i = j < html.size() ? j + 1 : html.size();
+
+        if (skip_depth > 0) {
+            if (tag == skip_tag) {
+                if (closing) {
+                    --skip_depth;
+                } else if (!self_closing) {
+                    ++skip_depth;
+                }
+            }
+            continue;
+        }
+        // Every tag boundary separates text nodes.
+        body.separate();
+        if (closing) {
+            if (tag == "title") {
+                in_title = false;
+            } else if (tag == "a") {
+                in_anchor = false;
+            } else if (tag == "nav" && nav_depth > 0) {
+                --nav_depth;
+            }
+            continue;
+        }
+        if (tag == "script" || tag == "style") {
+            size_t end = find_icase(html, tag == "script" ? "</script" : "</style", i);
+            if (end == std::string_view::npos) {
+                break;
+            }
+            size_t close = html.find('>', end);
+            i = close == std::string_view::npos ? html.size() : close + 1;
+        } else if (is_skipped(tag)) {
+            if (!self_closing) {
+                skip_tag = tag;
+                skip_depth = 1;
+            }
+        } else if (tag == "nav") {
+            nav_depth += self_closing ? 0 : 1;
+        } else if (tag == "title") {
+            in_title = !title_done && !self_closing;
+            title_done = true;
+        } else if (tag == "a") {
+            in_anchor = has_href;
+            if (has_href) {
+                result.anchors.emplace_back(std::string(strip(attribute_value)), std::string());
+            }
+        }
+    }
+
+    result.title = std::string(strip(result.title));
+    for (auto& anchor : result.anchors) {
+        truncate_chars(anchor.second, kAnchorTextLimit);
+    }
+    result.text = std::move(body.out);
+    result.word_count = body.words;
+    return result;
+}
+
+}  // namespace crawler
@@ -0,0 +1,357 @@
+#include "json.hpp"
+
+#include "string_util.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+
+namespace crawler {
+
+namespace {
+
+constexpr int kMaxDepth = 64;
+
+}  // namespace
+
+// Recursive descent over the RFC 8259 grammar, in one pass.
+class JsonParser {
+   public:
+    explicit JsonParser(std::string_view text) : text_(text) {}
+
+    std::optional<JsonValue> parse_document(std::string* error) {
+        JsonValue value;
+        skip_whitespace();
+        bool ok = parse_value(value, 0);
+        if (ok) {
+            skip_whitespace();
+            if (pos_ != text_.size()) {
+                ok = fail("unexpected trailing characters");
+            }
+        }
+        if (!ok) {
+            if (error) {
+                *error = describe_error();
+            }
+            return std::nullopt;
+        }
+        return value;
+    }
+
+   private:
+    bool parse_value(JsonValue& out, int depth) {
+        if (pos_ >= text_.size()) {
+            return fail("unexpected end of input");
+        }
+        switch (text_[pos_]) {
+            case '{':
+                return parse_object(out, depth);
+            case '[':
+                return parse_array(out, depth);
+            case '"':
+                out = JsonValue(std::string());
+                return parse_string(out.string_);
+            case 't':
+                out = JsonValue(true);
+                return literal("true");
+            case 'f':
+                out = JsonValue(false);
+                return literal("false");
+            case 'n':
+                out = JsonValue();
+                return literal("null");
+            default:
+                return parse_number(out);
+        }
+    }
+
+    bool parse_object(JsonValue& out, int depth) {
+        if (depth >= kMaxDepth) {
+            return fail("nesting too deep");
+        }
+        out = JsonValue::object();
+        ++pos_;
+        skip_whitespace();
+        if (consume('}')) {
+            return true;
+        }
+        while (true) {
+            skip_whitespace();
+            if (pos_ >= text_.size() || text_[pos_] != '"') {
+                return fail("expected a string key");
+            }
+            std::string key;
+            if (!parse_string(key)) {
+                return false;
+            }
+            skip_whitespace();
+            if (!consume(':')) {
+                return fail("expected ':'");
+            }
+            skip_whitespace();
+            JsonValue value;
+            if (!parse_value(value, depth + 1)) {
+                return false;
+            }
+            out.members_.emplace_back(std::move(key), std::move(value));
+            skip_whitespace();
+            if (consume('}')) {
+                return true;
+            }
+            if (!consume(',')) {
+                return fail("expected ',' or '}'");
+            }
+        }
+    }
+
+    bool parse_array(JsonValue& out, int depth) {
+        if (depth >= kMaxDepth) {
+            return fail("nesting too deep");
+        }
+        out = JsonValue::array();
+        ++pos_;
+        skip_whitespace();
+        if (consume(']')) {
+            return true;
+        }
+        while (true) {
+            skip_whitespace();
+            JsonValue value;
+            if (!parse_value(value, depth + 1)) {
+                return false;
+            }
+            out.items_.push_back(std::move(value));
+            skip_whitespace();
+            if (consume(']')) {
+                return true;
+            }
+            if (!consume(',')) {
+                return fail("expected ',' or ']'");
+            }
+        }
+    }
+
+    // Called with pos_ on the opening quote.
+    bool parse_string(std::string& out) {
+        ++pos_;
+        while (pos_ < text_.size()) {
+            char c = text_[pos_];
+            if (c == '"') {
+                ++pos_;
+                return true;
+            }
+            if (static_cast<unsigned char>(c) < 0x20) {
+                return fail("control character in string");
+            }
+            if (c != '\\') {
+                // Copy the run up to the next quote or escape at once.
+                size_t end = text_.find_first_of("\"\\", pos_);
+                end = end == std::string_view::npos ? text_.size() : end;
+                for (size_t i = pos_; i < end; ++i) {
+                    if (static_cast<unsigned char>(text_[i]) < 0x20) {
+                        end = i;
+                        break;
+                    }
+                }
+                out.append(text_.substr(pos_, end - pos_));
+                pos_ = end;
+                continue;
+            }
+            if (++pos_ >= text_.size()) {
+                break;
+            }
+            char escape = text_[pos_++];
+            switch (escape) {
+                case '"':
+                case '\\':
+                case '/':
+                    out.push_back(escape);
+                    break;
+                case 'b':
+                    out.push_back('\b');
+                    break;
+                case 'f':
+                    out.push_back('\f');
+                    break;
+                case 'n':
+                    out.push_back('\n');
+                    break;
+                case 'r':
+                    out.push_back('\r');
+                    break;
+                case 't':
+                    out.push_back('\t');
+                    break;
+                case 'u': {
+                    uint32_t code_point = 0;
+                    if (!hex4(code_point)) {
+                        return false;
+                    }
+                    if (code_point >= 0xD800 && code_point < 0xDC00) {
+                        uint32_t low = 0;
+                        if (text_.substr(pos_, 2) != "\\u" || (pos_ += 2, !hex4(low)) || low < 0xDC00 || low >= 0xE000) {
+                            return fail("unpaired surrogate in \\u escape");
+                        }
+                        code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                    } else if (code_point >= 0xDC00 && code_point < 0xE000) {
+                        return fail("unpaired surrogate in \\u escape");
+                    }
+                    append_utf8(out, code_point);
+                    break;
+                }
+                default:
+                    --pos_;
+                    return fail("invalid escape");
+            }
+        }
+        return fail("unterminated string");
+    }
+
+    bool hex4(uint32_t& out) {
+        if (pos_ + 4 > text_.size()) {
+            return fail("truncated \\u escape");
+        }
+        for (int i = 0; i < 4; ++i) {
+            char c = text_[pos_++];
+            out <<= 4;
+            if (c >= '0' && c <= '9') {
+                out |= static_cast<uint32_t>(c - '0');
+            } else if (c >= 'a' && c <= 'f') {
+                out |= static_cast<uint32_t>(c - 'a' + 10);
+            } else if (c >= 'A' && c <= 'F') {
+                out |= static_cast<uint32_t>(c - 'A' + 10);
+            } else {
+                --pos_;
+                return fail("invalid hex digit in \\u escape");
+            }
+        }
+        return true;
+    }
+
+    bool parse_number(JsonValue& out) {
+        size_t start = pos_;
+        consume('-');
+        if (consume('0')) {
+        } else if (!digits()) {
+            pos_ = start;
+            return fail("unexpected character");
+        }
+        if (consume('.') && !digits()) {
+            return fail("expected digits after '.'");
+        }
+        if (consume('e') || consume('E')) {
+            if (!consume('+')) {
+                consume('-');
+            }
+            if (!digits()) {
+                return fail("expected exponent digits");
+            }
+        }
+        // The grammar check above guarantees strtod consumes exactly this.
+        std::string token(text_.substr(start, pos_ - start));
+        out = JsonValue(std::strtod(token.c_str(), nullptr));
+        return true;
+    }
+
+    bool digits() {
+        size_t start = pos_;
+        while (pos_ < text_.size() && text_[pos_] >= '0' && text_[pos_] <= '9') {
+            ++pos_;
+        }
+        return pos_ > start;
+    }
+
+    bool literal(std::string_view word) {
+        if (text_.substr(pos_, word.size()) != word) {
+            return fail("unexpected character");
+        }
+        pos_ += word.size();
+        return true;
+    }
+
+    bool consume(char c) {
+        if (pos_ < text_.size() && text_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    void skip_whitespace() {
+        while (pos_ < text_.size() &&
+               (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' || text_[pos_] == '\r')) {
+            ++pos_;
+        }
+    }
+
+    bool fail(const char* message) {
+        if (!message_) {
+            message_ = message;
+            error_pos_ = pos_;
+        }
+        return false;
+    }
+
+    std::string describe_error() const {
+        size_t line = 1;
+        size_t column = 1;
+        for (size_t i = 0; i < error_pos_ && i < text_.size(); ++i) {
+            if (text_[i] == '\n') {
+                ++line;
+                column = 1;
+            } else {
+                ++column;
+            }
+        }
+        return std::string(message_ ? message_ : "invalid JSON") + " at line " + std::to_string(line) + ", column " +
+               std::to_string(column);
+    }
+
+    std::string_view text_;
+    size_t pos_ = 0;
+    const char* message_ = nullptr;
+    size_t error_pos_ = 0;
+};
+
+std::optional<JsonValue> JsonValue::parse(std::string_view text, std::string* error) {
+    return JsonParser(text).parse_document(error);
+}
+
+const JsonValue* JsonValue::find(std::string_view key) const {
+    // Last match, so a repeated key behaves like a later assignment.
+    for (auto it = members_.rbegin(); it != members_.rend(); ++it) {
+        if (it->first == key) {
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
+
+void JsonValue::set(std::string key, JsonValue value) {
+    for (auto it = members_.rbegin(); it != members_.rend(); ++it) {
+        if (it->first == key) {
+            it->second = std::move(value);
+            return;
+        }
+    }
+    members_.emplace_back(std::move(key), std::move(value));
+}
+
+const char* json_type_name(JsonValue::Type type) {
+    switch (type) {
+        case JsonValue::Type::null:
+            return "null";
+        case JsonValue::Type::boolean:
+            return "a boolean";
+        case JsonValue::Type::number:
+            return "a number";
+        case JsonValue::Type::string:
+            return "a string";
+        case JsonValue::Type::array:
+            return "an array";
+        case JsonValue::Type::object:
+            return "an object";
+    }
+    return "unknown";
+}
+
+}  // namespace crawler
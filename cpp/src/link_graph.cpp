@@ -0,0 +1,193 @@
+#include "link_graph.hpp"
+
+#include "atomic_file.hpp"
+#include "hash.hpp"
+#include "json.hpp"
+#include "string_util.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <system_error>
+
+namespace crawler {
+
+namespace {
+
+constexpr char kCsrMagic[8] = {'F', 'G', 'C', 'S', 'R', '0', '0', '1'};
+
+}  // namespace
+
+uint32_t LinkGraph::node_id(std::string_view url) {
+    uint64_t fingerprint = hash_bytes(url);
+    NodeShard& shard = nodes_[fingerprint % kShards];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto [it, inserted] = shard.ids.try_emplace(fingerprint, 0);
+    if (inserted) {
+        it->second = next_id_.fetch_add(1);
+        shard.urls.emplace_back(it->second, std::string(url));
+    }
+    return it->second;
+}
+
+void LinkGraph::add_edges(uint32_t source, const std::vector<uint32_t>& targets) {
+    EdgeShard& shard = edges_[source % kShards];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (uint32_t target : targets) {
+        shard.edges.emplace_back(source, target);
+    }
+}
+
+size_t LinkGraph::node_count() const {
+    return next_id_.load();
+}
+
+std::vector<std::string> LinkGraph::urls() const {
+    std::vector<std::string> urls(node_count());
+    for (const auto& shard : nodes_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& [id, url] : shard.urls) {
+            if (id < urls.size()) {
+                urls[id] = url;
+            }
+        }
+    }
+    return urls;
+}
+
+CsrGraph LinkGraph::build_csr() const {
+    size_t nodes = node_count();
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    for (const auto& shard : edges_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        edges.insert(edges.end(), shard.edges.begin(), shard.edges.end());
+    }
+    // Edges added meanwhile may name nodes past the count read above; the
+    // next snapshot has them.
+    std::erase_if(edges, [nodes](const auto& edge) { return edge.first >= nodes || edge.second >= nodes; });
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+    CsrGraph graph;
+    graph.offsets.assign(nodes + 1, 0);
+    graph.targets.reserve(edges.size());
+    for (const auto& [source, target] : edges) {
+        ++graph.offsets[source + 1];
+        graph.targets.push_back(target);
+    }
+    for (size_t i = 0; i < nodes; ++i) {
+        graph.offsets[i + 1] += graph.offsets[i];
+    }
+    return graph;
+}
+
+bool write_csr(const std::filesystem::path& path, const CsrGraph& graph) {
+    return write_file_atomically(path, [&](std::ofstream& out) {
+        uint64_t counts[2] = {graph.node_count(), graph.edge_count()};
+        out.write(kCsrMagic, sizeof(kCsrMagic));
+        out.write(reinterpret_cast<const char*>(counts), sizeof(counts));
+        out.write(reinterpret_cast<const char*>(graph.offsets.data()),
+                  static_cast<std::streamsize>(graph.offsets.size() * sizeof(uint64_t)));
+        out.write(reinterpret_cast<const char*>(graph.targets.data()),
+                  static_cast<std::streamsize>(graph.targets.size() * sizeof(uint32_t)));
+    });
+}
+
+std::optional<CsrGraph> read_csr(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open " << path << "\n";
+        return std::nullopt;
+    }
+    char magic[sizeof(kCsrMagic)] = {};
+    uint64_t counts[2] = {};
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(counts), sizeof(counts));
+    std::error_code ec;
+    uint64_t size = std::filesystem::file_size(path, ec);
+    uint64_t expected = sizeof(magic) + sizeof(counts) + (counts[0] + 1) * sizeof(uint64_t) + counts[1] * sizeof(uint32_t);
+    if (!in || std::memcmp(magic, kCsrMagic, sizeof(magic)) != 0 || ec || counts[0] > UINT32_MAX || size != expected) {
+        std::cerr << path << " is not a valid CSR link graph\n";
+        return std::nullopt;
+    }
+    CsrGraph graph;
+    graph.offsets.resize(counts[0] + 1);
+    graph.targets.resize(counts[1]);
+    in.read(reinterpret_cast<char*>(graph.offsets.data()), static_cast<std::streamsize>(graph.offsets.size() * sizeof(uint64_t)));
+    in.read(reinterpret_cast<char*>(graph.targets.data()), static_cast<std::streamsize>(graph.targets.size() * sizeof(uint32_t)));
+    bool valid = in && graph.offsets.front() == 0 && graph.offsets.back() == counts[1] &&
+                 std::is_sorted(graph.offsets.begin(), graph.offsets.end()) &&
+                 std::all_of(graph.targets.begin(), graph.targets.end(), [&](uint32_t t) { return t < counts[0]; });
+    if (!valid) {
+        std::cerr << path << " is not a valid CSR link graph\n";
+        return std::nullopt;
+    }
+    return graph;
+}
+
+bool write_link_map_json(const std::filesystem::path& path, const std::string& start_url, uint64_t pages,
+                         const std::vector<std::string>& urls, const CsrGraph& graph) {
+    return write_file_atomically(path, [&](std::ofstream& out) {
+        std::string buffer = "{\"start_url\": ";
+        append_json_string(buffer, start_url);
+        buffer += ",\n \"pages\": " + std::to_string(pages) + ",\n \"node_count\": " + std::to_string(urls.size()) +
+                  ",\n \"edge_count\": " + std::to_string(graph.edge_count()) + ",\n \"nodes\": [";
+        for (size_t i = 0; i < urls.size(); ++i) {
+            buffer += i == 0 ? "\n  " : ",\n  ";
+            append_json_string(buffer, urls[i]);
+            if (buffer.size() > (1 << 16)) {
+                out << buffer;
+                buffer.clear();
+            }
+        }
+        buffer += "],\n \"edges\": [";
+        bool first = true;
+        for (size_t source = 0; source < graph.node_count(); ++source) {
+            for (uint64_t e = graph.offsets[source]; e < graph.offsets[source + 1]; ++e) {
+                buffer += first ? "\n  [" : ",\n  [";
+                first = false;
+                buffer += std::to_string(source) + ", " + std::to_string(graph.targets[e]) + "]";
+            }
+            if (buffer.size() > (1 << 16)) {
+                out << buffer;
+                buffer.clear();
+            }
+        }
+        buffer += "]}\n";
+        out << buffer;
+    });
+}
+
+std::optional<std::vector<std::string>> read_link_map_nodes(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open " << path << "\n";
+        return std::nullopt;
+    }
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::string error;
+    auto document = JsonValue::parse(text, &error);
+    if (!document) {
+        std::cerr << path << " is not valid JSON: " << error << "\n";
+        return std::nullopt;
+    }
+    const JsonValue* nodes = document->find("nodes");
+    if (!nodes || !nodes->is_array()) {
+        std::cerr << path << " has no nodes array\n";
+        return std::nullopt;
+    }
+    std::vector<std::string> urls;
+    urls.reserve(nodes->items().size());
+    for (const JsonValue& node : nodes->items()) {
+        if (!node.is_string()) {
+            std::cerr << path << " has a node that is not a URL string\n";
+            return std::nullopt;
+        }
+        urls.push_back(node.as_string());
+    }
+    return urls;
+}
+
+}  // namespace crawler
@@ -1,3 +1,32 @@
+#include "aimd_limiter.hpp"
+#include "body_spool.hpp"
+#include "checkpoint.hpp"
+#include "content_decoder.hpp"
+#include "crawl_metrics.hpp"
+#include "crawl_priority.hpp"
+#include "crawl_scope.hpp"
+#include "document_text.hpp"
+#include "fetch_engine.hpp"
+#include "fetch_state.hpp"
+#include "hash.hpp"
+#include "host_frontier.hpp"
+#include "html_links.hpp"
+#include "html_text.hpp"
+#include "json.hpp"
+#include "link_graph.hpp"
+#include "manifest_writer.hpp"
+#include "metrics_server.hpp"
+#include "near_duplicates.hpp"
+#include "robots.hpp"
+#include "seen_set.hpp"
+#include "segment_store.hpp"
+#include "shard_exchange.hpp"
+#include "sitemap.hpp"
+#include "string_util.hpp"
+#include "task_pool.hpp"
+#include "url.hpp"
+#include "work_scheduler.hpp"
+
 #include <curl/curl.h>
 #include <omp.h>
 
@@ -6,32 +35,145 @@
 #include <chrono>
 #include <condition_variable>
 #include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
 #include <filesystem>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <optional>
-#include <queue>
-#include <regex>
+#include <random>
 #include <set>
+#include <span>
 #include <sstream>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+extern char** environ;
+
 namespace fs = std::filesystem;
 
 namespace {
 
+using crawler::CanonicalUrl;
+using crawler::FetchEngine;
+using crawler::FetchRequest;
+using crawler::FetchResult;
+using crawler::to_lower;
+
 struct Config {
     std::string start_url = "https://www.bgsu.edu";
+    // More seeds, queued alongside start_url.
+    std::vector<std::string> start_urls;
     std::vector<std::string> allowed_domains {"www.bgsu.edu", "bgsu.edu"};
     fs::path raw_output = fs::path("data") / "raw";
+    fs::path checkpoint_path;
+    double checkpoint_interval_seconds = 60.0;
+    // Seconds between "Stats:" progress lines; 0 disables them.
+    double stats_interval_seconds = 30.0;
+    // Serves Prometheus metrics at http://metrics_address:metrics_port/metrics
+    // when the port is set.
+    long metrics_port = 0;
+    std::string metrics_address = "127.0.0.1";
+    bool resume = false;
+    bool full_recrawl = false;
     long max_pages = -1;
     double request_delay_seconds = 0.25;
     double timeout_seconds = 20.0;
+    // libcurl's DNS cache lifetime; -1 never expires entries.
+    long dns_cache_seconds = 60;
     int threads = 8;
+    int fetch_threads = 2;
+    int fetch_concurrency = 64;
+    // Network errors, 408, 429 and 5xx responses are retried up to
+    // max_retries times, after retry_base_delay * 2^attempt seconds (capped
+    // at retry_max_delay, jittered) or the server's Retry-After if longer.
+    int max_retries = 3;
+    double retry_base_delay_seconds = 1.0;
+    double retry_max_delay_seconds = 60.0;
+    // Requests in flight per host: AIMD-controlled between 1 and
+    // concurrency.max_limit when adaptive, otherwise fixed at max_limit.
+    bool adaptive_concurrency = true;
+    crawler::AimdOptions concurrency;
+    // Per-host overrides from the `hosts` object, keyed by lowercase host.
+    struct HostSettings {
+        std::optional<double> delay_seconds;
+        std::optional<int> max_concurrency;
+    };
+    std::unordered_map<std::string, HostSettings> host_settings;
+    bool sort_query_params = false;
+    // Lowercase query parameter names dropped from every URL.
+    std::vector<std::string> strip_query_params;
+    // Crawl scope within the allowed hosts; see CrawlScope.
+    std::vector<std::string> scope_include;
+    std::vector<std::string> scope_exclude;
+    long max_depth = -1;
+    long max_query_params = -1;
+    long seen_capacity = 1 << 20;
+    bool seen_bloom_filter = false;
+    // Pack bodies into raw_output/segments; false keeps one file per URL
+    // under html/ and files/.
+    bool segment_storage = true;
+    long segment_size_mb = 1024;
+    // Ask servers for compressed bodies. With store_compressed, gzip and
+    // deflate bodies go into segments as sent (flagged with their encoding)
+    // and are only decoded for link and text extraction.
+    bool compression = true;
+    bool store_compressed = false;
+    // Bodies over these sizes are abandoned mid-transfer (or before it, when
+    // Content-Length announces them). Only the first link_scan_kb of HTML
+    // feed link extraction; bodies spill to disk past body_memory_kb.
+    long max_html_mb = 8;
+    long max_file_mb = 256;
+    long link_scan_kb = 2048;
+    long body_memory_kb = 1024;
+    // Content-type prefixes (e.g. "video/") whose bodies are never downloaded.
+    std::vector<std::string> blocked_content_types;
+    // Write title, clean text and anchors of saved HTML to text.ndjson.
+    bool extract_text = false;
+    // With extract_text, saved Office documents (and PDFs in a poppler
+    // build) get their text there too, from extract_threads threads (0: one
+    // per core) fed through a queue of at most extract_queue documents.
+    int extract_threads = 0;
+    int extract_queue = 64;
+    // Crawl link graph: JSON link map here plus a CSR file (.csr) next to
+    // it; empty disables. Only the first link_map_max_pages pages that link
+    // anywhere contribute edges (-1: all).
+    fs::path link_map_output = fs::path("data") / "link_map.json";
+    long link_map_max_pages = -1;
+    // Pages whose body repeats a kept page, byte for byte or within
+    // near_duplicate_distance bits of its text SimHash, are listed in
+    // duplicates.tsv. "skip" also leaves them out of the saved bodies and
+    // metadata.tsv (their links are still followed); "flag" saves them
+    // anyway; "off" disables the check.
+    enum class DuplicatePolicy { off, flag, skip };
+    DuplicatePolicy duplicate_policy = DuplicatePolicy::flag;
+    long near_duplicate_distance = 3;
+    // frontier_order "priority" fetches each host's most important URLs
+    // first (see CrawlPriority); "fifo" keeps discovery order.
+    bool priority_frontier = true;
+    crawler::PriorityWeights priority_weights;
+    // Skip URLs robots.txt disallows for our user agent.
+    bool respect_robots = true;
+    // Seed the frontier from the sitemaps robots.txt names plus `sitemaps`.
+    // With sitemap_skip_unchanged, URLs whose <lastmod> is older than their
+    // last fetch are not fetched again this run.
+    bool use_sitemaps = true;
+    std::vector<std::string> sitemaps;
+    bool sitemap_skip_unchanged = false;
+    // Sharded crawl: this process is shard shard_index of shard_count and
+    // fetches only the URLs shard_of assigns it, with its own raw_output
+    // subdirectory; links owned by other shards go to them through the file
+    // queue in shard_exchange_dir.
+    int shard_count = 1;
+    int shard_index = 0;
+    fs::path shard_exchange_dir;
     std::unordered_set<std::string> allowed_extensions {
         ".html", ".htm", ".php", ".asp", ".aspx", ".jsp",
         ".pdf",  ".txt", ".json", ".csv",  ".xml",
@@ -52,53 +194,100 @@ std::string read_file(const fs::path& path) {
     return ss.str();
 }
 
-std::string read_string(const std::string& data, const std::string& key, const std::string& fallback) {
-    std::regex pattern("\\\"" + key + "\\\"\\s*:\\s*\\\"([^\\\"]*)\\\"");
-    std::smatch match;
-    if (std::regex_search(data, match, pattern)) {
-        return match[1].str();
+// Typed reads from one config object (the top level of pipeline.json, or a
+// `hosts` entry). A value of the wrong type is reported and the fallback
+// used; warn_unknown lists the keys nothing asked for, which are usually
+// typos.
+class ConfigReader {
+   public:
+    ConfigReader(const crawler::JsonValue& object, std::string where) : object_(object), where_(std::move(where)) {}
+
+    std::string read_string(const std::string& key, const std::string& fallback) {
+        const auto* value = lookup(key, crawler::JsonValue::Type::string);
+        return value ? value->as_string() : fallback;
     }
-    return fallback;
-}
 
-long read_long(const std::string& data, const std::string& key, long fallback) {
-    std::regex pattern("\\\"" + key + "\\\"\\s*:\\s*([-0-9]+)");
-    std::smatch match;
-    if (std::regex_search(data, match, pattern)) {
-        return std::stol(match[1].str());
+    long read_long(const std::string& key, long fallback) {
+        const auto* value = lookup(key, crawler::JsonValue::Type::number);
+        if (!value) {
+            return fallback;
+        }
+        double number = value->as_number();
+        if (number != std::floor(number) || std::abs(number) > 9.0e15) {
+            std::cerr << "Config " << where_ << key << " should be an integer; ignoring it.\n";
+            return fallback;
+        }
+        return static_cast<long>(number);
     }
-    return fallback;
-}
 
-double read_double(const std::string& data, const std::string& key, double fallback) {
-    std::regex pattern("\\\"" + key + "\\\"\\s*:\\s*([-0-9.]+)");
-    std::smatch match;
-    if (std::regex_search(data, match, pattern)) {
-        return std::stod(match[1].str());
+    bool read_bool(const std::string& key, bool fallback) {
+        const auto* value = lookup(key, crawler::JsonValue::Type::boolean);
+        return value ? value->as_bool() : fallback;
     }
-    return fallback;
-}
 
-std::vector<std::string> read_string_array(const std::string& data, const std::string& key, const std::vector<std::string>& fallback) {
-    std::regex pattern("\\\"" + key + "\\\"\\s*:\\s*\\[(.*?)\\]");
-    std::smatch match;
-    if (!std::regex_search(data, match, pattern)) {
-        return fallback;
-    }
-    std::vector<std::string> values;
-    std::string content = match[1].str();
-    std::regex value_pattern("\\\"([^\\\"]+)\\\"");
-    auto begin = std::sregex_iterator(content.begin(), content.end(), value_pattern);
-    auto end = std::sregex_iterator();
-    for (auto it = begin; it != end; ++it) {
-        values.push_back((*it)[1].str());
-    }
-    return values.empty() ? fallback : values;
-}
+    double read_double(const std::string& key, double fallback) {
+        const auto* value = lookup(key, crawler::JsonValue::Type::number);
+        return value ? value->as_number() : fallback;
+    }
+
+    // An empty array also gives `fallback`.
+    std::vector<std::string> read_string_array(const std::string& key, const std::vector<std::string>& fallback) {
+        const auto* value = lookup(key, crawler::JsonValue::Type::array);
+        if (!value) {
+            return fallback;
+        }
+        std::vector<std::string> values;
+        for (const auto& item : value->items()) {
+            if (item.is_string()) {
+                values.push_back(item.as_string());
+            } else {
+                std::cerr << "Config " << where_ << key << " should hold only strings; skipping "
+                          << crawler::json_type_name(item.type()) << ".\n";
+            }
+        }
+        return values.empty() ? fallback : values;
+    }
+
+    const crawler::JsonValue* read_object(const std::string& key) { return lookup(key, crawler::JsonValue::Type::object); }
+
+    void warn_unknown(const std::unordered_set<std::string>& ignored = {}) const {
+        for (const auto& [key, value] : object_.members()) {
+            if (!read_.count(key) && !ignored.count(key)) {
+                std::cerr << "Unknown config key " << where_ << key << "; ignoring it.\n";
+            }
+        }
+    }
+
+   private:
+    const crawler::JsonValue* lookup(const std::string& key, crawler::JsonValue::Type type) {
+        read_.insert(key);
+        const auto* value = object_.find(key);
+        if (!value || value->is_null()) {
+            return nullptr;
+        }
+        if (value->type() != type) {
+            std::cerr << "Config " << where_ << key << " should be " << crawler::json_type_name(type) << ", not "
+                      << crawler::json_type_name(value->type()) << "; ignoring it.\n";
+            return nullptr;
+        }
+        return value;
+    }
 
-std::string to_lower(std::string value) {
-    std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
-    return value;
+    const crawler::JsonValue& object_;
+    std::string where_;
+    std::unordered_set<std::string> read_;
+};
+
+// Keys in pipeline.json that only the Python scripts read.
+const std::unordered_set<std::string> kScriptConfigKeys {"processed_output", "root_url", "graph_snippet_chars",
+                                                         "cleaning_checkpoint_interval"};
+
+// `--set key=value` and PIPELINE_<KEY>=value overrides. The value is taken
+// as JSON when it parses (numbers, true/false, arrays, objects) and as a
+// plain string otherwise.
+crawler::JsonValue override_value(const std::string& text) {
+    auto parsed = crawler::JsonValue::parse(text);
+    return parsed ? std::move(*parsed) : crawler::JsonValue(text);
 }
 
 fs::path resolve_path(const fs::path& repo_root, const std::string& raw_path) {
@@ -112,373 +301,1315 @@ fs::path resolve_path(const fs::path& repo_root, const std::string& raw_path) {
     return repo_root / path;
 }
 
-Config load_config(const fs::path& starting_dir) {
+struct ConfigOverrides {
+    // --config; otherwise $PIPELINE_CONFIG, then config/pipeline.json
+    // found by walking up from the working directory.
+    fs::path config_path;
+    // --set key=value, applied in order after PIPELINE_<KEY> variables.
+    std::vector<std::pair<std::string, std::string>> values;
+};
+
+std::optional<Config> load_config(const fs::path& starting_dir, const ConfigOverrides& overrides) {
     Config cfg;
-    fs::path repo_root = starting_dir;
     const fs::path config_rel_path = "config/pipeline.json";
-    while (!repo_root.empty() && !fs::exists(repo_root / config_rel_path)) {
-        if (repo_root.has_parent_path()) {
-            repo_root = repo_root.parent_path();
-        } else {
-            break;
-        }
+    fs::path repo_root = starting_dir;
+    while (!fs::exists(repo_root / config_rel_path) && repo_root.has_parent_path() &&
+           repo_root.parent_path() != repo_root) {
+        repo_root = repo_root.parent_path();
     }
-    if (fs::exists(repo_root / config_rel_path)) {
-        std::cout << "Using config at " << repo_root / config_rel_path << "\n";
-    } else {
-        std::cerr << "Config not found starting from " << starting_dir << ". Using defaults.\n";
+    if (!fs::exists(repo_root / config_rel_path)) {
+        repo_root = starting_dir;
+    }
+    fs::path config_path = overrides.config_path;
+    if (const char* env = std::getenv("PIPELINE_CONFIG"); config_path.empty() && env && *env) {
+        config_path = env;
+    }
+    bool explicit_path = !config_path.empty();
+    if (!explicit_path) {
+        config_path = repo_root / config_rel_path;
     }
 
     cfg.raw_output = repo_root / cfg.raw_output;
+    cfg.link_map_output = repo_root / cfg.link_map_output;
     cfg.threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
 
-    fs::path config_path = repo_root / "config" / "pipeline.json";
+    auto root = crawler::JsonValue::object();
     if (fs::exists(config_path)) {
-        std::string data = read_file(config_path);
-        if (!data.empty()) {
-            cfg.start_url = read_string(data, "start_url", cfg.start_url);
-            cfg.allowed_domains = read_string_array(data, "allowed_domains", cfg.allowed_domains);
-            std::string raw_output_str = read_string(data, "raw_output", cfg.raw_output.string());
-            cfg.raw_output = resolve_path(repo_root, raw_output_str);
-            cfg.max_pages = read_long(data, "max_pages", cfg.max_pages);
-            cfg.request_delay_seconds = read_double(data, "delay", cfg.request_delay_seconds);
-            cfg.timeout_seconds = read_double(data, "timeout", cfg.timeout_seconds);
-            long link_threads = read_long(data, "crawler_threads", cfg.threads);
-            if (link_threads > 0) {
-                cfg.threads = static_cast<int>(link_threads);
-            }
-            auto extensions = read_string_array(data, "extensions", {});
-            if (!extensions.empty()) {
-                cfg.allowed_extensions.clear();
-                for (const auto& ext : extensions) {
-                    if (!ext.empty() && ext[0] == '.') {
-                        cfg.allowed_extensions.insert(ext);
-                    } else if (!ext.empty()) {
-                        cfg.allowed_extensions.insert('.' + ext);
-                    }
-                }
-            }
+        std::string error;
+        auto parsed = crawler::JsonValue::parse(read_file(config_path), &error);
+        if (!parsed || !parsed->is_object()) {
+            std::cerr << "Cannot read config " << config_path << ": "
+                      << (parsed ? "expected a JSON object" : error) << "\n";
+            return std::nullopt;
         }
+        root = std::move(*parsed);
+        std::cout << "Using config at " << config_path << "\n";
+    } else if (explicit_path) {
+        std::cerr << "Config not found at " << config_path << "\n";
+        return std::nullopt;
     } else {
-        std::cerr << "Config not found at " << config_path << ". Using defaults.\n";
+        std::cerr << "Config not found starting from " << starting_dir << ". Using defaults.\n";
     }
-    for (auto& domain : cfg.allowed_domains) {
-        domain = to_lower(domain);
+    // Environment overrides first, so --set wins over them.
+    constexpr std::string_view kEnvPrefix = "PIPELINE_";
+    for (char** env = environ; *env; ++env) {
+        std::string_view entry = *env;
+        size_t eq = entry.find('=');
+        if (eq == std::string_view::npos || entry.substr(0, kEnvPrefix.size()) != kEnvPrefix ||
+            entry.substr(0, eq) == "PIPELINE_CONFIG") {
+            continue;
+        }
+        root.set(to_lower(std::string(entry.substr(kEnvPrefix.size(), eq - kEnvPrefix.size()))),
+                 override_value(std::string(entry.substr(eq + 1))));
     }
-    return cfg;
-}
-
-std::string trim(const std::string& input) {
-    size_t start = input.find_first_not_of(" \t\n\r");
-    size_t end = input.find_last_not_of(" \t\n\r");
-    if (start == std::string::npos || end == std::string::npos) {
-        return "";
+    for (const auto& [key, value] : overrides.values) {
+        root.set(key, override_value(value));
     }
-    return input.substr(start, end - start + 1);
-}
 
-struct UrlParts {
-    std::string scheme;
-    std::string host;
-    std::string path;
-};
-
-std::optional<UrlParts> parse_url(const std::string& url) {
-    static const std::regex pattern(R"(^([a-zA-Z][a-zA-Z0-9+.-]*)://([^/]+)(/.*)?$)");
-    std::smatch match;
-    if (!std::regex_match(url, match, pattern)) {
-        return std::nullopt;
+    ConfigReader data(root, "");
+    cfg.start_url = data.read_string("start_url", cfg.start_url);
+    cfg.start_urls = data.read_string_array("start_urls", {});
+    cfg.allowed_domains = data.read_string_array("allowed_domains", cfg.allowed_domains);
+    std::string raw_output_str = data.read_string("raw_output", cfg.raw_output.string());
+    cfg.raw_output = resolve_path(repo_root, raw_output_str);
+    cfg.max_pages = data.read_long("max_pages", cfg.max_pages);
+    cfg.request_delay_seconds = data.read_double("delay", cfg.request_delay_seconds);
+    cfg.timeout_seconds = data.read_double("timeout", cfg.timeout_seconds);
+    cfg.dns_cache_seconds = std::max(-1L, data.read_long("dns_cache_seconds", cfg.dns_cache_seconds));
+    std::string checkpoint_str = data.read_string("checkpoint_path", "");
+    if (!checkpoint_str.empty()) {
+        cfg.checkpoint_path = resolve_path(repo_root, checkpoint_str);
     }
-    UrlParts parts;
-    parts.scheme = to_lower(match[1].str());
-    parts.host = to_lower(match[2].str());
-    parts.path = match[3].matched ? match[3].str() : "/";
-    return parts;
-}
-
-std::string strip_fragment(const std::string& url) {
-    auto pos = url.find('#');
-    if (pos != std::string::npos) {
-        return url.substr(0, pos);
+    cfg.checkpoint_interval_seconds = data.read_double("checkpoint_interval", cfg.checkpoint_interval_seconds);
+    cfg.stats_interval_seconds = data.read_double("stats_interval", cfg.stats_interval_seconds);
+    cfg.metrics_port = data.read_long("metrics_port", cfg.metrics_port);
+    cfg.metrics_address = data.read_string("metrics_address", cfg.metrics_address);
+    long link_threads = data.read_long("crawler_threads", cfg.threads);
+    if (link_threads > 0) {
+        cfg.threads = static_cast<int>(link_threads);
     }
-    return url;
-}
-
-std::string make_absolute(const std::string& base_url, const std::string& href) {
-    std::string link = trim(href);
-    if (link.empty()) {
-        return {};
+    long fetch_threads = data.read_long("fetch_threads", cfg.fetch_threads);
+    if (fetch_threads > 0) {
+        cfg.fetch_threads = static_cast<int>(fetch_threads);
     }
-    if (link.rfind("mailto:", 0) == 0 || link.rfind("javascript:", 0) == 0) {
-        return {};
+    long fetch_concurrency = data.read_long("fetch_concurrency", cfg.fetch_concurrency);
+    if (fetch_concurrency > 0) {
+        cfg.fetch_concurrency = static_cast<int>(fetch_concurrency);
+    }
+    cfg.max_retries = static_cast<int>(std::max(0L, data.read_long("max_retries", cfg.max_retries)));
+    cfg.retry_base_delay_seconds = data.read_double("retry_base_delay", cfg.retry_base_delay_seconds);
+    cfg.retry_max_delay_seconds = data.read_double("retry_max_delay", cfg.retry_max_delay_seconds);
+    cfg.adaptive_concurrency = data.read_bool("adaptive_concurrency", cfg.adaptive_concurrency);
+    long host_max = data.read_long("host_max_concurrency", cfg.concurrency.max_limit);
+    if (host_max > 0) {
+        cfg.concurrency.max_limit = static_cast<int>(host_max);
     }
-    if (link.rfind("http://", 0) == 0 || link.rfind("https://", 0) == 0) {
-        return strip_fragment(link);
+    long host_initial = data.read_long("host_initial_concurrency", cfg.concurrency.initial_limit);
+    if (host_initial > 0) {
+        cfg.concurrency.initial_limit = static_cast<int>(host_initial);
     }
-    if (link.rfind("//", 0) == 0) {
-        auto base_parts = parse_url(base_url);
-        if (!base_parts) {
-            return {};
+    cfg.sort_query_params = data.read_bool("sort_query_params", cfg.sort_query_params);
+    for (const auto& name : data.read_string_array("strip_query_params", {})) {
+        if (!name.empty()) {
+            cfg.strip_query_params.push_back(to_lower(name));
         }
-        return base_parts->scheme + ":" + strip_fragment(link);
     }
-    auto base_parts = parse_url(base_url);
-    if (!base_parts) {
-        return {};
+    for (const auto& pattern : data.read_string_array("scope_include", {})) {
+        if (pattern.empty() || (pattern[0] != '/' && pattern[0] != '*')) {
+            std::cerr << "Ignoring scope_include pattern \"" << pattern << "\" (expected a path starting with /)\n";
+        } else {
+            cfg.scope_include.push_back(pattern);
+        }
     }
-    std::string base_path = base_parts->path;
-    if (link.front() == '/') {
-        base_path = link;
-    } else {
-        auto slash = base_path.find_last_of('/');
-        std::string directory = slash == std::string::npos ? "/" : base_path.substr(0, slash + 1);
-        base_path = directory + link;
+    for (const auto& pattern : data.read_string_array("scope_exclude", {})) {
+        if (pattern.empty() || (pattern[0] != '/' && pattern[0] != '*')) {
+            std::cerr << "Ignoring scope_exclude pattern \"" << pattern << "\" (expected a path starting with /)\n";
+        } else {
+            cfg.scope_exclude.push_back(pattern);
+        }
     }
-    return base_parts->scheme + "://" + base_parts->host + base_path;
-}
-
-std::string extension_from_url(const std::string& url) {
-    auto clean = strip_fragment(url);
-    auto query_pos = clean.find('?');
-    if (query_pos != std::string::npos) {
-        clean = clean.substr(0, query_pos);
+    cfg.max_depth = std::max(-1L, data.read_long("max_depth", cfg.max_depth));
+    cfg.max_query_params = std::max(-1L, data.read_long("max_query_params", cfg.max_query_params));
+    long seen_capacity = data.read_long("seen_capacity", cfg.seen_capacity);
+    if (seen_capacity > 0) {
+        cfg.seen_capacity = seen_capacity;
     }
-    auto slash = clean.find_last_of('/');
-    std::string filename = slash == std::string::npos ? clean : clean.substr(slash + 1);
-    auto dot = filename.find_last_of('.');
-    if (dot == std::string::npos) {
-        return {};
+    cfg.seen_bloom_filter = data.read_bool("seen_bloom_filter", cfg.seen_bloom_filter);
+    cfg.segment_storage = data.read_string("storage", "segments") != "files";
+    cfg.compression = data.read_bool("compression", cfg.compression);
+    cfg.store_compressed = data.read_bool("store_compressed", cfg.store_compressed);
+    for (auto [key, field] : {std::pair<const char*, long*> {"max_html_mb", &cfg.max_html_mb},
+                              {"max_file_mb", &cfg.max_file_mb},
+                              {"link_scan_kb", &cfg.link_scan_kb},
+                              {"body_memory_kb", &cfg.body_memory_kb}}) {
+        long value = data.read_long(key, *field);
+        if (value > 0) {
+            *field = value;
+        }
     }
-    std::string ext = filename.substr(dot);
-    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
-    return ext;
-}
-
-bool query_indicates_download(const std::string& url) {
-    auto lower = to_lower(url);
-    if (lower.find("format=pdf") != std::string::npos) {
-        return true;
+    cfg.blocked_content_types = data.read_string_array("blocked_content_types", {});
+    cfg.extract_text = data.read_bool("extract_text", cfg.extract_text);
+    cfg.extract_threads = static_cast<int>(std::max(0L, data.read_long("extract_threads", cfg.extract_threads)));
+    long extract_queue = data.read_long("extract_queue", cfg.extract_queue);
+    if (extract_queue > 0) {
+        cfg.extract_queue = static_cast<int>(extract_queue);
     }
-    if (lower.find("format=doc") != std::string::npos) {
-        return true;
+    std::string link_map_str = data.read_string("link_map_output", cfg.link_map_output.string());
+    cfg.link_map_output = link_map_str.empty() ? fs::path() : resolve_path(repo_root, link_map_str);
+    cfg.link_map_max_pages = data.read_long("link_map_max_pages", cfg.link_map_max_pages);
+    std::string duplicates = data.read_string("duplicate_policy", "flag");
+    if (duplicates == "off") {
+        cfg.duplicate_policy = Config::DuplicatePolicy::off;
+    } else if (duplicates == "skip") {
+        cfg.duplicate_policy = Config::DuplicatePolicy::skip;
+    } else if (duplicates != "flag") {
+        std::cerr << "Unknown duplicate_policy \"" << duplicates << "\"; using flag.\n";
     }
-    if (lower.find("download=1") != std::string::npos) {
-        return true;
+    cfg.priority_frontier = data.read_string("frontier_order", "priority") != "fifo";
+    cfg.priority_weights.depth = data.read_double("priority_depth_weight", cfg.priority_weights.depth);
+    cfg.priority_weights.inlinks = data.read_double("priority_inlink_weight", cfg.priority_weights.inlinks);
+    cfg.priority_weights.staleness = data.read_double("priority_staleness_weight", cfg.priority_weights.staleness);
+    // Entries are "substring=weight", e.g. "/admissions/=2".
+    for (const auto& entry : data.read_string_array("priority_patterns", {})) {
+        size_t eq = entry.rfind('=');
+        char* end = nullptr;
+        double weight = eq == std::string::npos ? 0.0 : std::strtod(entry.c_str() + eq + 1, &end);
+        if (eq == std::string::npos || eq == 0 || end == entry.c_str() + eq + 1 || *end != '\0') {
+            std::cerr << "Ignoring priority pattern \"" << entry << "\" (expected substring=weight)\n";
+            continue;
+        }
+        cfg.priority_weights.patterns.emplace_back(entry.substr(0, eq), weight);
     }
-    return false;
-}
-
-std::string sanitize_filename(const UrlParts& parts, const std::string& extension, const std::string& prefix) {
-    std::string path = parts.path;
-    if (path.empty() || path == "/") {
-        path = "/index";
+    cfg.respect_robots = data.read_bool("respect_robots", cfg.respect_robots);
+    cfg.use_sitemaps = data.read_bool("use_sitemaps", cfg.use_sitemaps);
+    cfg.sitemaps = data.read_string_array("sitemaps", {});
+    cfg.sitemap_skip_unchanged = data.read_bool("sitemap_skip_unchanged", cfg.sitemap_skip_unchanged);
+    long distance = data.read_long("near_duplicate_distance", cfg.near_duplicate_distance);
+    if (distance >= 0 && distance < 64) {
+        cfg.near_duplicate_distance = distance;
+    }
+    long segment_size_mb = data.read_long("segment_size_mb", cfg.segment_size_mb);
+    if (segment_size_mb > 0) {
+        cfg.segment_size_mb = segment_size_mb;
+    }
+    auto extensions = data.read_string_array("extensions", {});
+    if (!extensions.empty()) {
+        cfg.allowed_extensions.clear();
+        for (const auto& ext : extensions) {
+            if (!ext.empty() && ext[0] == '.') {
+                cfg.allowed_extensions.insert(ext);
+            } else if (!ext.empty()) {
+                cfg.allowed_extensions.insert('.' + ext);
+            }
+        }
+    }
+    // Per-host overrides: "hosts": {"www.bgsu.edu": {"delay": 1.0, ...}}.
+    if (const auto* hosts = data.read_object("hosts")) {
+        for (const auto& [name, block] : hosts->members()) {
+            std::string host = to_lower(name);
+            if (!block.is_object()) {
+                std::cerr << "Config hosts." << name << " should be an object; ignoring it.\n";
+                continue;
+            }
+            ConfigReader host_data(block, "hosts." + name + ".");
+            Config::HostSettings& settings = cfg.host_settings[host];
+            double delay = host_data.read_double("delay", -1.0);
+            if (delay >= 0.0) {
+                settings.delay_seconds = delay;
+            }
+            long max_concurrency = host_data.read_long("host_max_concurrency", 0);
+            if (max_concurrency > 0) {
+                settings.max_concurrency = static_cast<int>(max_concurrency);
+            }
+            host_data.warn_unknown();
+        }
     }
-    std::string safe = path;
-    std::replace(safe.begin(), safe.end(), '/', '_');
-    std::string file_name = prefix + "__" + parts.host + safe;
-    if (!extension.empty() && file_name.find(extension) == std::string::npos) {
-        file_name += extension;
+    cfg.shard_count = static_cast<int>(std::max(1L, data.read_long("shard_count", cfg.shard_count)));
+    cfg.shard_index = static_cast<int>(data.read_long("shard_index", cfg.shard_index));
+    std::string exchange_str = data.read_string("shard_exchange_dir", "");
+    if (!exchange_str.empty()) {
+        cfg.shard_exchange_dir = resolve_path(repo_root, exchange_str);
+    }
+    data.warn_unknown(kScriptConfigKeys);
+    if (cfg.shard_count > 1) {
+        if (cfg.shard_index < 0 || cfg.shard_index >= cfg.shard_count) {
+            std::cerr << "shard_index " << cfg.shard_index << " is outside 0.." << cfg.shard_count - 1 << "\n";
+            return std::nullopt;
+        }
+        if (cfg.shard_exchange_dir.empty()) {
+            cfg.shard_exchange_dir = cfg.raw_output / "exchange";
+        }
+        std::string shard = "shard-" + std::to_string(cfg.shard_index);
+        cfg.raw_output /= shard;
+        if (!cfg.checkpoint_path.empty()) {
+            cfg.checkpoint_path += "." + shard;
+        }
+        if (!cfg.link_map_output.empty()) {
+            cfg.link_map_output.replace_filename(cfg.link_map_output.stem().string() + "." + shard +
+                                                 cfg.link_map_output.extension().string());
+        }
+        // Every shard fetches from every host, so delays and concurrency
+        // limits, which are per-host budgets for the whole crawl, are split
+        // between them.
+        auto split = [&](int limit) { return std::max(1, (limit + cfg.shard_count - 1) / cfg.shard_count); };
+        cfg.request_delay_seconds *= cfg.shard_count;
+        cfg.concurrency.max_limit = split(cfg.concurrency.max_limit);
+        cfg.concurrency.initial_limit = std::min(cfg.concurrency.initial_limit, cfg.concurrency.max_limit);
+        for (auto& [host, settings] : cfg.host_settings) {
+            if (settings.delay_seconds) {
+                *settings.delay_seconds *= cfg.shard_count;
+            }
+            if (settings.max_concurrency) {
+                settings.max_concurrency = split(*settings.max_concurrency);
+            }
+        }
     }
-    static const std::regex invalid("[^A-Za-z0-9._-]+");
-    file_name = std::regex_replace(file_name, invalid, "_");
-    if (file_name.size() > 240) {
-        file_name = file_name.substr(0, 240);
+    if (cfg.checkpoint_path.empty()) {
+        cfg.checkpoint_path = cfg.raw_output / "crawl.checkpoint";
     }
-    return file_name;
+    for (auto& domain : cfg.allowed_domains) {
+        domain = to_lower(domain);
+    }
+    for (const auto& [host, settings] : cfg.host_settings) {
+        if (std::find(cfg.allowed_domains.begin(), cfg.allowed_domains.end(), host) == cfg.allowed_domains.end()) {
+            std::cerr << "Config hosts." << host << " is not in allowed_domains.\n";
+        }
+    }
+    for (auto& type : cfg.blocked_content_types) {
+        type = to_lower(type);
+    }
+    if (cfg.store_compressed && (!cfg.compression || !cfg.segment_storage)) {
+        // Plain files carry nowhere to say how they are encoded.
+        std::cerr << "Config store_compressed needs compression and segment storage; ignoring it.\n";
+        cfg.store_compressed = false;
+    }
+    return cfg;
 }
 
-struct FetchResult {
-    std::string body;
-    std::string content_type;
-};
-
-size_t write_callback(char* ptr, size_t size, size_t nmemb, void* userdata) {
-    auto* buffer = static_cast<std::string*>(userdata);
-    buffer->append(ptr, size * nmemb);
-    return size * nmemb;
+bool is_html_type(const std::string& content_type) {
+    return content_type.empty() || to_lower(content_type).find("text/html") != std::string::npos;
 }
 
-size_t header_callback(char* buffer, size_t size, size_t nitems, void* userdata) {
-    size_t total = size * nitems;
-    std::string header(buffer, total);
-    auto* content_type = static_cast<std::string*>(userdata);
-    std::string lower = to_lower(header);
-    if (lower.rfind("content-type:", 0) == 0) {
-        auto colon = header.find(':');
-        if (colon != std::string::npos) {
-            std::string value = header.substr(colon + 1);
-            *content_type = trim(value);
+// Spools a page body while it downloads, feeding the first `scan_bytes` of
+// HTML to the link extractor on the way, and aborts the transfer once the
+// body grows past `max_bytes`. A body kept in `encoding` is spooled as sent
+// and decoded only as far as the scan goes. Sinks are pooled, so their
+// buffers are reused from page to page.
+struct PageSink : crawler::BodySink {
+    PageSink(fs::path spill_dir, size_t memory_limit) : body(std::move(spill_dir), memory_limit) {}
+
+    // Readies the sink for the next response.
+    void reset(uint64_t max_body_bytes, uint64_t scan_bytes, size_t keep_bytes,
+               crawler::ContentEncoding body_encoding = crawler::ContentEncoding::identity) {
+        body.reset(keep_bytes);
+        extractor.reset();
+        max_bytes = max_body_bytes;
+        scan_left = scan_bytes;
+        encoding = body_encoding;
+        if (encoding != crawler::ContentEncoding::identity) {
+            decoder.reset(encoding, scan_bytes);
         }
     }
-    return total;
+
+    bool write(std::string_view chunk) override {
+        if (body.size() + chunk.size() > max_bytes) {
+            return false;
+        }
+        if (scan_left > 0) {
+            std::string_view scanned = chunk.substr(0, static_cast<size_t>(std::min<uint64_t>(scan_left, chunk.size())));
+            if (encoding != crawler::ContentEncoding::identity) {
+                decoded.clear();
+                if (!decoder.feed(chunk, decoded)) {
+                    return false;
+                }
+                scanned = decoded;
+            }
+            extractor.feed(scanned);
+            scan_left -= scanned.size();
+            if (encoding != crawler::ContentEncoding::identity && decoder.finished()) {
+                scan_left = 0;
+            }
+        }
+        return body.append(chunk);
+    }
+
+    crawler::BodySpool body;
+    crawler::LinkExtractor extractor;
+    crawler::ContentEncoding encoding = crawler::ContentEncoding::identity;
+    crawler::ContentDecoder decoder;
+    std::string decoded;
+    uint64_t max_bytes = 0;
+    uint64_t scan_left = 0;
+};
+
+// One text.ndjson line: the page's text plus its anchors, resolved like
+// crawl links so edge targets match node URLs.
+std::string format_text_record(const std::string& url, const std::string& path, const std::string& content_type,
+                               const crawler::HtmlText& text, const CanonicalUrl& page,
+                               const crawler::LinkExtractor& extractor, const crawler::NormalizeOptions& options) {
+    std::optional<CanonicalUrl> base;
+    if (auto base_href = extractor.base_href()) {
+        base = crawler::resolve_url(&page, *base_href, options);
+    }
+    const CanonicalUrl& resolve_against = base ? *base : page;
+    std::string out = "{\"url\":";
+    crawler::append_json_string(out, url);
+    out += ",\"path\":";
+    crawler::append_json_string(out, path);
+    out += ",\"content_type\":";
+    crawler::append_json_string(out, content_type);
+    out += ",\"title\":";
+    crawler::append_json_string(out, text.title);
+    out += ",\"word_count\":" + std::to_string(text.word_count) + ",\"clean_text\":";
+    crawler::append_json_string(out, text.text);
+    out += ",\"links\":[";
+    bool first = true;
+    for (const auto& [href, anchor_text] : text.anchors) {
+        auto target = crawler::resolve_url(&resolve_against, href, options);
+        if (!target) {
+            continue;
+        }
+        out += first ? "[" : ",[";
+        first = false;
+        crawler::append_json_string(out, target->str());
+        out.push_back(',');
+        crawler::append_json_string(out, anchor_text);
+        out.push_back(']');
+    }
+    out += "]}\n";
+    return out;
 }
 
-FetchResult fetch_url(const std::string& url, double timeout_seconds) {
-    FetchResult result;
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        return result;
-    }
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, "FalconGraphCrawler/1.0");
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &result.body);
-    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
-    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &result.content_type);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, static_cast<long>(timeout_seconds));
-    CURLcode res = curl_easy_perform(curl);
-    if (res != CURLE_OK) {
-        std::cerr << "Failed to fetch " << url << ": " << curl_easy_strerror(res) << "\n";
-        result.body.clear();
-    }
-    curl_easy_cleanup(curl);
-    return result;
+// The text.ndjson line of a PDF or Office document: like a page's, without
+// a title or links.
+std::string format_document_record(const std::string& url, const std::string& path, const std::string& content_type,
+                                   const crawler::DocumentText& text) {
+    std::string out = "{\"url\":";
+    crawler::append_json_string(out, url);
+    out += ",\"path\":";
+    crawler::append_json_string(out, path);
+    out += ",\"content_type\":";
+    crawler::append_json_string(out, content_type);
+    out += ",\"title\":\"\",\"word_count\":" + std::to_string(text.word_count) + ",\"clean_text\":";
+    crawler::append_json_string(out, text.text);
+    out += ",\"links\":[]}\n";
+    return out;
 }
 
-std::vector<std::string> extract_links(const std::string& html, const std::string& base_url) {
-    static const std::regex href_regex(R"(href\s*=\s*['\"]([^'\"]+)['\"])", std::regex::icase);
-    std::vector<std::string> links;
-    auto begin = std::sregex_iterator(html.begin(), html.end(), href_regex);
-    auto end = std::sregex_iterator();
-    for (auto it = begin; it != end; ++it) {
-        std::string raw_link = (*it)[1].str();
-        std::string absolute = make_absolute(base_url, raw_link);
-        if (!absolute.empty()) {
-            links.push_back(absolute);
-        }
+// Retry-After is either a number of seconds or an HTTP date.
+std::optional<std::chrono::seconds> parse_retry_after(const std::string& value) {
+    if (value.empty()) {
+        return std::nullopt;
+    }
+    if (std::all_of(value.begin(), value.end(), [](unsigned char c) { return std::isdigit(c); })) {
+        return std::chrono::seconds(std::stol(value));
+    }
+    time_t when = curl_getdate(value.c_str(), nullptr);
+    if (when < 0) {
+        return std::nullopt;
     }
-    return links;
+    return std::chrono::seconds(std::max<long>(0, static_cast<long>(when - std::time(nullptr))));
 }
 
 class ParallelCrawler {
    public:
     explicit ParallelCrawler(Config config)
-        : config_(std::move(config)) {
+        : config_(std::move(config)),
+          scheduler_(config_.threads),
+          frontier_(config_.request_delay_seconds),
+          seen_(static_cast<size_t>(config_.seen_capacity), config_.seen_bloom_filter),
+          duplicates_(static_cast<int>(config_.near_duplicate_distance)),
+          priority_(config_.priority_weights),
+          metrics_(config_.allowed_domains),
+          limiter_(config_.concurrency),
+          jitter_(std::random_device {}()) {
+        url_options_.sort_query = config_.sort_query_params;
+        url_options_.strip_query_params = config_.strip_query_params;
+        for (const auto& pattern : config_.scope_include) {
+            scope_.include(pattern);
+        }
+        for (const auto& pattern : config_.scope_exclude) {
+            scope_.exclude(pattern);
+        }
+        scope_.set_max_depth(static_cast<int>(config_.max_depth));
+        scope_.set_max_query_params(static_cast<int>(config_.max_query_params));
         fs::create_directories(config_.raw_output);
         html_dir_ = config_.raw_output / "html";
         files_dir_ = config_.raw_output / "files";
-        fs::create_directories(html_dir_);
-        fs::create_directories(files_dir_);
+        if (config_.segment_storage) {
+            segments_ = std::make_unique<crawler::SegmentWriter>(config_.raw_output / "segments",
+                                                                 static_cast<uint64_t>(config_.segment_size_mb) << 20);
+        } else {
+            fs::create_directories(html_dir_);
+            fs::create_directories(files_dir_);
+        }
+        // Spill files left behind by a killed crawl are never reused.
+        spill_dir_ = config_.raw_output / "tmp";
+        fs::remove_all(spill_dir_);
         metadata_path_ = config_.raw_output / "metadata.tsv";
         if (!fs::exists(metadata_path_)) {
             std::ofstream out(metadata_path_);
             out << "url\tpath\tcontent_type\n";
         }
+        fetch_state_path_ = config_.raw_output / "fetch_state.tsv";
+        delta_path_ = config_.raw_output / "delta.tsv";
+        fs::path text_path = config_.extract_text ? config_.raw_output / "text.ndjson" : fs::path();
+        // A resumed crawl keeps adding to the interrupted run's delta.
+        if (!config_.resume || !fs::exists(delta_path_)) {
+            std::ofstream out(delta_path_, std::ios::trunc);
+            out << "url\tpath\tcontent_type\tchange\n";
+        }
+        fs::path duplicates_path;
+        if (config_.duplicate_policy != Config::DuplicatePolicy::off) {
+            duplicates_path = config_.raw_output / "duplicates.tsv";
+            if (!fs::exists(duplicates_path)) {
+                std::ofstream out(duplicates_path);
+                out << "url\tduplicate_of\tmatch\tdistance\n";
+            }
+        }
+        manifest_ = std::make_unique<crawler::ManifestWriter>(metadata_path_, delta_path_, text_path, duplicates_path);
+        if (config_.shard_count > 1) {
+            exchange_ = std::make_unique<crawler::ShardExchange>(config_.shard_exchange_dir, config_.shard_count,
+                                                                 config_.shard_index);
+        }
     }
 
     void run() {
         curl_global_init(CURL_GLOBAL_DEFAULT);
-        enqueue_url(config_.start_url);
 
-        std::atomic<bool> stop {false};
+        crawler::FetchEngineOptions options;
+        options.threads = config_.fetch_threads;
+        options.max_in_flight = config_.fetch_concurrency;
+        options.timeout_seconds = config_.timeout_seconds;
+        options.dns_cache_seconds = config_.dns_cache_seconds;
+        options.compressed = config_.compression;
+        options.raw_encoded = config_.store_compressed;
+        options.share = std::make_shared<crawler::FetchShare>();
+        options.max_host_connections = config_.concurrency.max_limit;
+        for (const auto& [host, settings] : config_.host_settings) {
+            options.max_host_connections = std::max<long>(options.max_host_connections, settings.max_concurrency.value_or(0));
+        }
+        FetchEngine::Handlers handlers;
+        handlers.next = [this](std::chrono::milliseconds& wait) { return next_request(wait); };
+        handlers.done = [this](FetchResult&& result) { on_fetched(std::move(result)); };
+        handlers.open_sink = [this](const FetchResult& headers) { return open_page_sink(headers); };
+        engine_ = std::make_unique<FetchEngine>(options, std::move(handlers));
+
+        for (const auto& [host, settings] : config_.host_settings) {
+            if (settings.delay_seconds) {
+                frontier_.set_interval(host, *settings.delay_seconds);
+            }
+            if (settings.max_concurrency) {
+                limiter_.set_max_limit(host, *settings.max_concurrency);
+            }
+        }
+        for (const auto& host : config_.allowed_domains) {
+            frontier_.set_limit(host, host_limit(host));
+        }
+        preresolve_hosts(options);
+        auto sitemaps = load_robots(options);
+        if (size_t known = fetch_state_.load(fetch_state_path_)) {
+            std::cout << "Loaded fetch state for " << known << " URLs"
+                      << (config_.full_recrawl ? " (full recrawl, no conditional requests)" : "") << "\n";
+        }
+        if (config_.duplicate_policy != Config::DuplicatePolicy::off) {
+            // Pages kept by earlier crawls are what later pages duplicate.
+            fetch_state_.for_each([this](const std::string& url, const crawler::FetchState& state) {
+                if (!state.path.empty()) {
+                    duplicates_.find_or_insert(url, state.content_hash,
+                                               state.simhash ? std::optional<uint64_t>(state.simhash) : std::nullopt);
+                }
+            });
+        }
+        if (config_.resume) {
+            resume();
+        }
+        // On resume the start URLs are normally seen already and this is a
+        // no-op. Each shard queues only the seeds it owns.
+        std::vector<std::string> seeds {config_.start_url};
+        seeds.insert(seeds.end(), config_.start_urls.begin(), config_.start_urls.end());
+        for (const auto& start_url : seeds) {
+            auto seed = crawler::canonicalize_url(start_url, url_options_);
+            if (!seed || !is_allowed_domain(seed->authority())) {
+                std::cerr << "Start URL " << start_url << " is not an allowed http(s) URL.\n";
+            } else if (owns(*seed)) {
+                enqueue_url(*seed, 0);
+            }
+        }
+        if (config_.use_sitemaps) {
+            sitemaps.insert(sitemaps.end(), config_.sitemaps.begin(), config_.sitemaps.end());
+            seed_from_sitemaps(options, sitemaps);
+        }
+        engine_->start();
+
+        std::thread exchanger;
+        if (exchange_) {
+            // Held until every shard is done, so running out of local work
+            // does not end this one early.
+            scheduler_.retain();
+            exchange_->publish(false);
+            std::cout << "Running as shard " << config_.shard_index << " of " << config_.shard_count << ", exchanging URLs through "
+                      << config_.shard_exchange_dir << "\n";
+            exchanger = std::thread([this] { exchange_loop(); });
+        }
+        std::thread checkpointer;
+        if (config_.checkpoint_interval_seconds > 0) {
+            // Written up front so a crash before the first interval still
+            // resumes this run rather than falling back to metadata.tsv.
+            save_checkpoint();
+            checkpointer = std::thread([this] { checkpoint_loop(); });
+        }
+        std::thread reporter;
+        if (config_.stats_interval_seconds > 0) {
+            reporter = std::thread([this] { stats_loop(); });
+        }
+        crawler::MetricsServer metrics_server([this] { return crawler::format_prometheus(metrics_, metrics_.snapshot(), gauges()); });
+        if (config_.metrics_port > 0 && metrics_server.start(config_.metrics_address, static_cast<int>(config_.metrics_port))) {
+            std::cout << "Serving metrics at http://" << config_.metrics_address << ":" << config_.metrics_port << "/metrics\n";
+        }
+
+        if (config_.extract_text) {
+            int threads = config_.extract_threads > 0 ? config_.extract_threads
+                                                      : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+            extraction_pool_ = std::make_unique<crawler::BoundedTaskPool>(threads, static_cast<size_t>(config_.extract_queue));
+        }
 
         #pragma omp parallel num_threads(config_.threads)
         {
-            while (true) {
-                if (stop.load()) {
-                    break;
+            int worker = omp_get_thread_num();
+            while (auto page = scheduler_.pop(worker)) {
+                bool keep_running = process_page(*page);
+                recycle_sink(std::move(page->sink));
+                scheduler_.task_done();
+                if (!keep_running) {
+                    scheduler_.stop();
                 }
-                std::string url;
-                {
-                    std::lock_guard<std::mutex> lock(queue_mutex_);
-                    if (!frontier_.empty()) {
-                        url = frontier_.front();
-                        frontier_.pop();
-                        active_workers_.fetch_add(1);
-                    } else {
-                        if (active_workers_.load() == 0) {
-                            stop.store(true);
-                            break;
-                        }
-                        continue;
+            }
+        }
+        if (extraction_pool_) {
+            extraction_pool_->close();
+        }
+
+        engine_->stop();
+        {
+            std::lock_guard<std::mutex> lock(done_mutex_);
+            crawl_done_ = true;
+        }
+        done_cv_.notify_all();
+        if (reporter.joinable()) {
+            reporter.join();
+        }
+        if (exchanger.joinable()) {
+            exchanger.join();
+            // A shard stopped by max_pages leaves later URLs queued for it.
+            exchange_->flush();
+            exchange_->publish(true, !shards_finished_);
+        }
+        metrics_server.stop();
+        if (checkpointer.joinable()) {
+            checkpointer.join();
+            save_checkpoint();
+        } else {
+            fetch_state_.save(fetch_state_path_);
+        }
+        manifest_->close();
+        if (!config_.link_map_output.empty()) {
+            write_link_map(true);
+        }
+        engine_.reset();
+        curl_global_cleanup();
+    }
+
+   private:
+    static constexpr std::chrono::milliseconds kShardPollInterval {500};
+    // Body buffers up to this size stay with a pooled sink.
+    static constexpr size_t kPooledBodyBytes = 512 << 10;
+
+    // Warms the seen-set and frontier from the last checkpoint, or, without
+    // one, from metadata.tsv: every recorded URL counts as seen and the
+    // frontier is rebuilt from the links of the saved HTML pages.
+    void resume() {
+        if (!config_.link_map_output.empty()) {
+            restore_link_map();
+        }
+        if (auto checkpoint = crawler::MappedCheckpoint::open(config_.checkpoint_path)) {
+            for (size_t i = 0; i < checkpoint->fingerprint_count(); ++i) {
+                seen_.insert_fingerprint(checkpoint->fingerprints()[i]);
+            }
+            // Pages recorded after the checkpoint was taken are done; only
+            // the rest of its frontier needs fetching again. Their links were
+            // found after the snapshot, so they are taken from the saved
+            // bodies below.
+            std::unordered_set<std::string> recorded_since;
+            std::vector<std::pair<std::string, std::string>> pages;
+            crawler::for_each_metadata_row(metadata_path_, [&](const std::string& url, const std::string& saved_path, const std::string& content_type) {
+                if (recorded_since.insert(url).second && is_html_type(content_type)) {
+                    pages.emplace_back(url, saved_path);
+                }
+            }, checkpoint->metadata_offset());
+            restore_page_count(static_cast<long>(checkpoint->pages_downloaded() + recorded_since.size()));
+            {
+                std::lock_guard<std::mutex> lock(frontier_mutex_);
+                for (std::string_view raw : checkpoint->frontier()) {
+                    auto url = crawler::canonicalize_url(raw, url_options_);
+                    if (url && recorded_since.count(url->str()) == 0) {
+                        seen_.insert(url->str());
+                        // Checkpoints do not keep depths; resumed URLs all count as depth 0.
+                        FetchRequest request {url->str()};
+                        request.priority = priority_for(request.url, 0);
+                        track_inlinks(crawler::url_fingerprint(request.url));
+                        scheduler_.retain();
+                        frontier_.push(std::string(url->authority()), std::move(request));
                     }
                 }
+            }
+            requeue_saved_links(pages);
+            std::lock_guard<std::mutex> lock(frontier_mutex_);
+            std::cout << "Resumed from " << config_.checkpoint_path << ": " << seen_.size() << " seen URLs, "
+                      << frontier_.size() << " queued\n";
+            return;
+        }
+
+        long recorded = 0;
+        std::vector<std::pair<std::string, std::string>> pages;
+        crawler::for_each_metadata_row(metadata_path_, [&](const std::string& url, const std::string& saved_path, const std::string& content_type) {
+            seen_.insert(url);
+            ++recorded;
+            if (is_html_type(content_type)) {
+                pages.emplace_back(url, saved_path);
+            }
+        });
+        restore_page_count(recorded);
+        requeue_saved_links(pages);
+        std::lock_guard<std::mutex> lock(frontier_mutex_);
+        std::cout << "Resumed from " << metadata_path_ << ": " << recorded << " recorded URLs, " << frontier_.size()
+                  << " queued\n";
+    }
+
+    // Loads the interrupted run's link map so write_link_map extends it
+    // instead of replacing it with only this run's edges. Called before any
+    // page is recorded, so every URL keeps its node ID.
+    void restore_link_map() {
+        fs::path csr_path = config_.link_map_output;
+        csr_path.replace_extension(".csr");
+        if (!fs::exists(csr_path) || !fs::exists(config_.link_map_output)) {
+            return;
+        }
+        auto graph = crawler::read_csr(csr_path);
+        auto urls = graph ? crawler::read_link_map_nodes(config_.link_map_output) : std::nullopt;
+        if (!urls || urls->size() != graph->node_count()) {
+            std::cerr << "Ignoring link map " << config_.link_map_output << ": it does not match " << csr_path << "\n";
+            return;
+        }
+        for (const auto& url : *urls) {
+            link_graph_.node_id(url);
+        }
+        long sources = 0;
+        for (size_t node = 0; node < graph->node_count(); ++node) {
+            auto begin = graph->targets.begin() + static_cast<std::ptrdiff_t>(graph->offsets[node]);
+            auto end = graph->targets.begin() + static_cast<std::ptrdiff_t>(graph->offsets[node + 1]);
+            if (begin != end) {
+                link_graph_.add_edges(static_cast<uint32_t>(node), std::vector<uint32_t>(begin, end));
+                ++sources;
+            }
+        }
+        link_map_pages_ = sources;
+        std::cout << "Loaded link map with " << graph->node_count() << " nodes and " << graph->edge_count()
+                  << " edges from " << config_.link_map_output << "\n";
+    }
+
+    // Queues the links of saved HTML pages, given as (url, saved path).
+    void requeue_saved_links(const std::vector<std::pair<std::string, std::string>>& pages) {
+        for (const auto& [url, saved_path] : pages) {
+            auto page = crawler::canonicalize_url(url, url_options_);
+            std::string body = crawler::read_saved_body(saved_path);
+            if (!page || body.empty()) {
+                continue;
+            }
+            crawler::LinkExtractor extractor;
+            extractor.feed(body);
+            crawler::PageLinks links;
+            links.resolve(extractor, *page, url_options_);
+            // The run that fetched the page may have died before its link
+            // map was written.
+            if (!config_.link_map_output.empty()) {
+                record_links(*page, links);
+            }
+            enqueue_links(std::span(links.begin(), links.size()), 1);
+        }
+    }
 
-                if (!mark_visited(url)) {
-                    decrement_active();
+    void restore_page_count(long pages) {
+        pages_downloaded_ = pages;
+        std::lock_guard<std::mutex> lock(frontier_mutex_);
+        pages_reserved_ = pages;
+    }
+
+    // Polls the shard inbox, sends what other shards own and, once the
+    // whole crawl has drained, drops the hold that kept this shard running.
+    void exchange_loop() {
+        std::unique_lock<std::mutex> lock(done_mutex_);
+        while (!done_cv_.wait_for(lock, kShardPollInterval, [this] { return crawl_done_; })) {
+            lock.unlock();
+            size_t received = exchange_->receive([this](std::string_view raw, int depth) {
+                if (auto url = crawler::canonicalize_url(raw, url_options_)) {
+                    enqueue_url(*url, depth);
+                }
+            });
+            metrics_.add(crawler::Counter::shard_urls_received, received);
+            // Read before flushing: with only the hold left, nothing can
+            // forward more after the flush.
+            bool idle = scheduler_.pending() == 1;
+            exchange_->flush();
+            exchange_->publish(idle);
+            if (idle && exchange_->finished()) {
+                shards_finished_ = true;
+                scheduler_.release();
+                return;
+            }
+            lock.lock();
+        }
+    }
+
+    void checkpoint_loop() {
+        auto interval = std::chrono::duration<double>(config_.checkpoint_interval_seconds);
+        std::unique_lock<std::mutex> lock(done_mutex_);
+        while (!done_cv_.wait_for(lock, interval, [this] { return crawl_done_; })) {
+            lock.unlock();
+            save_checkpoint();
+            lock.lock();
+        }
+    }
+
+    // Prints a progress line every stats_interval, with rates over the
+    // interval, and a last one covering the whole crawl when it ends.
+    void stats_loop() {
+        auto interval = std::chrono::duration<double>(config_.stats_interval_seconds);
+        auto started = std::chrono::steady_clock::now();
+        auto last_time = started;
+        auto last = metrics_.snapshot();
+        auto first = last;
+        std::unique_lock<std::mutex> lock(done_mutex_);
+        while (!done_cv_.wait_for(lock, interval, [this] { return crawl_done_; })) {
+            lock.unlock();
+            auto now = std::chrono::steady_clock::now();
+            auto current = metrics_.snapshot();
+            std::cout << crawler::format_stats_line(metrics_, current, last, std::chrono::duration<double>(now - last_time).count(), gauges())
+                      << "\n";
+            last = std::move(current);
+            last_time = now;
+            lock.lock();
+        }
+        lock.unlock();
+        std::cout << crawler::format_stats_line(metrics_, metrics_.snapshot(), first,
+                                                std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count(), gauges())
+                  << "\n";
+    }
+
+    crawler::CrawlGauges gauges() {
+        crawler::CrawlGauges gauges;
+        gauges.seen_urls = seen_.size();
+        gauges.pages_downloaded = static_cast<uint64_t>(std::max(0L, pages_downloaded_.load()));
+        gauges.extraction_queue = extraction_pool_ ? extraction_pool_->queued() : 0;
+        std::lock_guard<std::mutex> lock(frontier_mutex_);
+        gauges.frontier = frontier_.size();
+        gauges.in_progress = in_progress_.size();
+        for (const auto& host : metrics_.hosts()) {
+            gauges.host_limits.push_back(host_limit(host));
+        }
+        return gauges;
+    }
+
+    // Taken under the frontier lock, which enqueue_url also holds while it
+    // inserts, so every fingerprint belongs to a URL that is queued, in
+    // progress, or already processed. Fetch state is saved alongside.
+    // Rows of finished pages are queued before they leave in_progress_, so
+    // the manifest mark taken here lands after all of them.
+    void save_checkpoint() {
+        crawler::CheckpointSnapshot snapshot;
+        std::future<uint64_t> metadata_offset;
+        {
+            std::lock_guard<std::mutex> lock(frontier_mutex_);
+            snapshot.fingerprints = seen_.fingerprints();
+            frontier_.append_urls(snapshot.frontier);
+            snapshot.frontier.insert(snapshot.frontier.end(), in_progress_.begin(), in_progress_.end());
+            snapshot.pages_downloaded = static_cast<uint64_t>(pages_downloaded_.load());
+            // Segment records go to disk before the rows that point at them.
+            metadata_offset = manifest_->mark([this] {
+                if (segments_) {
+                    segments_->sync();
+                }
+            });
+        }
+        snapshot.metadata_offset = metadata_offset.get();
+        // Forwarded URLs are in the seen-set snapshot, so they must be on
+        // disk before it is.
+        if (exchange_) {
+            exchange_->flush();
+        }
+        crawler::write_checkpoint(config_.checkpoint_path, snapshot);
+        fetch_state_.save(fetch_state_path_);
+        // So a killed crawl still leaves the edges of the pages it recorded.
+        if (!config_.link_map_output.empty()) {
+            write_link_map(false);
+        }
+    }
+
+    // Pages skipped because max_pages was reached stay in progress, so a
+    // resumed crawl fetches them again.
+    void finish_page(const std::string& url) {
+        std::lock_guard<std::mutex> lock(frontier_mutex_);
+        in_progress_.erase(url);
+    }
+
+    // A fetched page that ends up not saved hands its max_pages slot back,
+    // like a failed fetch does in on_fetched.
+    void release_page(const std::string& url) {
+        {
+            std::lock_guard<std::mutex> lock(frontier_mutex_);
+            in_progress_.erase(url);
+            --pages_reserved_;
+        }
+        engine_->notify();
+    }
+
+    // Looks up every allowed host at once before the first fetch, so neither
+    // robots.txt nor the crawl waits on DNS host by host.
+    void preresolve_hosts(const crawler::FetchEngineOptions& options) {
+        auto start = crawler::canonicalize_url(config_.start_url);
+        std::string scheme = start ? std::string(start->scheme()) : "https";
+        std::vector<std::string> origins;
+        for (const auto& host : config_.allowed_domains) {
+            origins.push_back(scheme + "://" + host);
+        }
+        auto begin = std::chrono::steady_clock::now();
+        size_t resolved = crawler::preresolve(origins, options);
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin);
+        std::cout << "Pre-resolved " << resolved << " of " << origins.size() << " hosts in " << elapsed.count()
+                  << " ms\n";
+    }
+
+    // Each allowed host gets its own interval: `delay`, raised to the host's
+    // robots.txt Crawl-delay when that is longer. Its Allow/Disallow rules
+    // are kept for should_enqueue. Returns the sitemaps robots.txt names.
+    std::vector<std::string> load_robots(const crawler::FetchEngineOptions& options) {
+        auto start = crawler::canonicalize_url(config_.start_url);
+        std::string scheme = start ? std::string(start->scheme()) : "https";
+        std::vector<std::string> sitemaps;
+        for (const auto& host : config_.allowed_domains) {
+            auto robots = crawler::fetch_once(scheme + "://" + host + "/robots.txt", options);
+            if (!robots.ok || robots.status != 200) {
+                continue;
+            }
+            auto policy = crawler::parse_robots(robots.body, options.user_agent);
+            // Like `delay`, a Crawl-delay is shared between the shards.
+            double crawl_delay = policy.crawl_delay_seconds.value_or(0.0) * config_.shard_count;
+            if (crawl_delay > host_delay(host)) {
+                std::cout << "Using Crawl-delay " << *policy.crawl_delay_seconds << "s for " << host << "\n";
+                frontier_.set_interval(host, crawl_delay);
+            }
+            if (config_.respect_robots && !policy.rules.empty()) {
+                robots_rules_.emplace_back(host, std::move(policy.rules));
+            }
+            sitemaps.insert(sitemaps.end(), policy.sitemaps.begin(), policy.sitemaps.end());
+        }
+        return sitemaps;
+    }
+
+    // Fetches the sitemaps (following sitemap indexes) on allowed hosts and
+    // queues every page they list that should_enqueue accepts.
+    void seed_from_sitemaps(const crawler::FetchEngineOptions& options, std::vector<std::string> pending) {
+        constexpr size_t kMaxSitemaps = 1000;
+        // The sitemap protocol's limit on an uncompressed sitemap.
+        constexpr uint64_t kMaxSitemapBytes = 50 << 20;
+        std::unordered_set<std::string> fetched;
+        size_t queued = 0;
+        size_t unchanged = 0;
+        while (!pending.empty() && fetched.size() < kMaxSitemaps) {
+            auto url = crawler::canonicalize_url(pending.back(), url_options_);
+            pending.pop_back();
+            if (!url || !is_allowed_domain(url->authority()) || !fetched.insert(url->str()).second) {
+                continue;
+            }
+            auto result = crawler::fetch_once(url->str(), options);
+            if (!result.ok || result.status != 200) {
+                std::cerr << "Failed to fetch sitemap " << url->str() << " (status " << result.status << ")\n";
+                continue;
+            }
+            // A sitemap.xml.gz sent without Content-Encoding arrives still
+            // compressed; fetch_once has already undone one that had it.
+            if (result.body.starts_with("\x1f\x8b")) {
+                auto decoded = crawler::decode_body(crawler::ContentEncoding::gzip, result.body, kMaxSitemapBytes);
+                if (!decoded) {
+                    std::cerr << "Failed to decompress sitemap " << url->str() << "\n";
+                    continue;
+                }
+                result.body = std::move(*decoded);
+            }
+            auto sitemap = crawler::parse_sitemap(result.body);
+            for (auto& entry : sitemap.entries) {
+                if (sitemap.is_index) {
+                    pending.push_back(std::move(entry.loc));
                     continue;
                 }
+                auto page = crawler::canonicalize_url(entry.loc, url_options_);
+                if (!page || !should_enqueue(*page, 1) || !owns(*page) || seen_.contains(page->str())) {
+                    continue;
+                }
+                if (config_.sitemap_skip_unchanged && entry.lastmod) {
+                    auto state = fetch_state_.find(page->str());
+                    if (state && state->fetched_at >= *entry.lastmod) {
+                        seen_.insert(page->str());
+                        ++unchanged;
+                        continue;
+                    }
+                }
+                enqueue_url(*page, 1, entry.lastmod);
+                ++queued;
+            }
+        }
+        if (!fetched.empty()) {
+            std::cout << "Queued " << queued << " URLs from " << fetched.size() << " sitemaps";
+            if (unchanged > 0) {
+                std::cout << " (" << unchanged << " unchanged since their last fetch skipped)";
+            }
+            std::cout << "\n";
+        }
+    }
 
-                bool keep_running = process_url(url);
-                decrement_active();
-                if (!keep_running) {
-                    stop.store(true);
-                    break;
+    // Called by fetch threads whenever they have a free slot.
+    std::optional<FetchRequest> next_request(std::chrono::milliseconds& wait) {
+        std::lock_guard<std::mutex> lock(frontier_mutex_);
+        if (frontier_.empty() || (config_.max_pages >= 0 && pages_reserved_ >= config_.max_pages)) {
+            return std::nullopt;
+        }
+        auto request = frontier_.pop(std::chrono::steady_clock::now(), wait);
+        if (request) {
+            ++pages_reserved_;
+            in_progress_.insert(request->url);
+            if (config_.priority_frontier) {
+                inlinks_.forget(crawler::url_fingerprint(request->url));
+            }
+            if (!config_.full_recrawl) {
+                if (auto state = fetch_state_.find(request->url)) {
+                    request->etag = state->etag;
+                    request->last_modified = state->last_modified;
                 }
             }
         }
+        return request;
+    }
 
-        curl_global_cleanup();
+    // Decides from the response headers whether a body is worth receiving:
+    // only 2xx bodies of allowed types and sizes are; error pages are not saved.
+    std::unique_ptr<crawler::BodySink> open_page_sink(const FetchResult& headers) {
+        if (headers.status < 200 || headers.status >= 300) {
+            return nullptr;
+        }
+        std::string content_type = to_lower(headers.content_type);
+        for (const auto& blocked : config_.blocked_content_types) {
+            if (content_type.rfind(blocked, 0) == 0) {
+                std::cerr << "Skipping " << headers.url << ": content type " << content_type << " is blocked\n";
+                return nullptr;
+            }
+        }
+        uint64_t max_bytes = static_cast<uint64_t>(is_html_type(content_type) ? config_.max_html_mb : config_.max_file_mb) << 20;
+        if (headers.content_length > 0 && static_cast<uint64_t>(headers.content_length) > max_bytes) {
+            std::cerr << "Skipping " << headers.url << ": " << headers.content_length << " bytes is over the size limit\n";
+            return nullptr;
+        }
+        uint64_t scan_bytes = is_html_type(content_type) ? static_cast<uint64_t>(config_.link_scan_kb) << 10 : 0;
+        auto encoding = crawler::ContentEncoding::identity;
+        if (config_.store_compressed) {
+            auto parsed = crawler::parse_content_encoding(headers.content_encoding);
+            if (!parsed) {
+                std::cerr << "Skipping " << headers.url << ": content encoding " << headers.content_encoding
+                          << " cannot be decoded\n";
+                return nullptr;
+            }
+            encoding = *parsed;
+        }
+        std::unique_ptr<PageSink> sink;
+        {
+            std::lock_guard<std::mutex> lock(sink_pool_mutex_);
+            if (!sink_pool_.empty()) {
+                sink = std::move(sink_pool_.back());
+                sink_pool_.pop_back();
+            }
+        }
+        if (!sink) {
+            sink = std::make_unique<PageSink>(spill_dir_, static_cast<size_t>(config_.body_memory_kb) << 10);
+        }
+        sink->reset(max_bytes, scan_bytes, kPooledBodyBytes, encoding);
+        if (headers.content_length > 0) {
+            sink->body.expect(static_cast<uint64_t>(headers.content_length));
+        }
+        return sink;
     }
 
-   private:
-    bool mark_visited(const std::string& url) {
-        std::lock_guard<std::mutex> lock(visited_mutex_);
-        auto [it, inserted] = visited_.insert(url);
-        if (inserted) {
-            queued_.erase(url);
+    // Returns a processed page's sink to the pool, up to one per request
+    // the fetch engine can have in flight.
+    void recycle_sink(std::unique_ptr<crawler::BodySink> sink) {
+        if (!sink) {
+            return;
         }
-        return inserted;
+        // Every sink comes from open_page_sink.
+        std::unique_ptr<PageSink> page_sink(static_cast<PageSink*>(sink.release()));
+        page_sink->reset(0, 0, kPooledBodyBytes);
+        std::lock_guard<std::mutex> lock(sink_pool_mutex_);
+        if (sink_pool_.size() < static_cast<size_t>(config_.fetch_concurrency)) {
+            sink_pool_.push_back(std::move(page_sink));
+        }
+    }
+
+    void on_fetched(FetchResult&& result) {
+        metrics_.record_fetch(result);
+        // Requested URLs are canonical already, so this only recovers the host.
+        auto url = crawler::canonicalize_url(result.url);
+        std::string host = url ? std::string(url->authority()) : std::string();
+        {
+            std::lock_guard<std::mutex> lock(frontier_mutex_);
+            if (config_.adaptive_concurrency) {
+                frontier_.set_limit(host, limiter_.record(host, congestion(result), result.timings.ttfb_us));
+            }
+            frontier_.finish(host);
+        }
+
+        bool not_modified = result.status == 304;
+        bool success = result.status >= 200 && result.status < 300 && result.sink;
+        if (result.ok && (success || not_modified)) {
+            scheduler_.push(-1, std::move(result));
+            scheduler_.release();
+            engine_->notify();
+            return;
+        }
+        if (result.rejected && result.sink) {
+            std::cerr << "Skipping " << result.url << ": body is over the size limit\n";
+        }
+        bool answered = result.ok || result.rejected;
+        if (answered && (result.status == 404 || result.status == 410)) {
+            // A page that is gone is no longer what others duplicate.
+            duplicates_.remove(result.url);
+            if (fetch_state_.erase(result.url)) {
+                manifest_->append(crawler::ManifestWriter::Stream::delta, result.url + "\t\t\tremoved\n");
+            }
+        }
+        // A failed or throttled fetch hands its max_pages slot back.
+        std::lock_guard<std::mutex> lock(frontier_mutex_);
+        --pages_reserved_;
+        in_progress_.erase(result.url);
+        auto now = std::chrono::steady_clock::now();
+        auto retry_after = throttled(result) ? parse_retry_after(result.retry_after) : std::nullopt;
+        if (retry_after) {
+            // Retry-After holds off the whole host, not just this URL.
+            frontier_.defer(host, now, *retry_after);
+        }
+        if (retryable(result)) {
+            if (result.attempt < config_.max_retries) {
+                auto delay = std::max<std::chrono::steady_clock::duration>(backoff(result.attempt),
+                                                                           retry_after.value_or(std::chrono::seconds(0)));
+                // The re-queued request keeps the scheduler retain it already holds.
+                FetchRequest retry {result.url, result.attempt + 1};
+                retry.depth = result.depth;
+                retry.priority = result.priority;
+                frontier_.push_later(host, std::move(retry), now + delay);
+                metrics_.add(crawler::Counter::retries);
+                engine_->notify();
+                return;
+            }
+            std::cerr << "Giving up on " << result.url << " after " << result.attempt + 1 << " attempts"
+                      << (answered ? " (status " + std::to_string(result.status) + ")" : std::string()) << "\n";
+        }
+        engine_->notify();
+        scheduler_.release();
+    }
+
+    static bool throttled(const FetchResult& result) {
+        return (result.status == 429 || result.status == 503) && !result.retry_after.empty();
+    }
+
+    // Transient failures: no response at all, a request timeout, rate
+    // limiting or a server error. open_page_sink turns down every non-2xx
+    // body, so a rejected result is judged by its status like any answer;
+    // one refused for its size or type is a 2xx and is not retried.
+    static bool retryable(const FetchResult& result) {
+        if (!result.ok && !result.rejected) {
+            return true;
+        }
+        return result.status == 408 || result.status == 429 || result.status >= 500;
+    }
+
+    // Rate limiting, an overloaded gateway or no answer at all tell the
+    // limiter to back off; anything else is a latency sample.
+    static crawler::AimdLimiter::Outcome congestion(const FetchResult& result) {
+        if (!result.ok && !result.rejected) {
+            return crawler::AimdLimiter::Outcome::failed;
+        }
+        switch (result.status) {
+            case 429:
+            case 502:
+            case 503:
+            case 504:
+                return crawler::AimdLimiter::Outcome::throttled;
+            default:
+                return crawler::AimdLimiter::Outcome::ok;
+        }
+    }
+
+    double host_delay(const std::string& host) const {
+        auto it = config_.host_settings.find(host);
+        return it != config_.host_settings.end() && it->second.delay_seconds ? *it->second.delay_seconds
+                                                                              : config_.request_delay_seconds;
     }
 
-    void decrement_active() {
-        auto remaining = active_workers_.fetch_sub(1) - 1;
-        if (remaining < 0) {
-            active_workers_.store(0);
+    // The host's current in-flight limit. Called under the frontier lock.
+    int host_limit(const std::string& host) const {
+        if (config_.adaptive_concurrency) {
+            return limiter_.limit(host);
         }
+        auto it = config_.host_settings.find(host);
+        return it != config_.host_settings.end() && it->second.max_concurrency ? *it->second.max_concurrency
+                                                                                : config_.concurrency.max_limit;
     }
 
-    bool process_url(const std::string& url) {
+    // Exponential backoff with "equal jitter": half the capped delay is
+    // fixed, the other half random, so retries of URLs that failed together
+    // spread out. Called under the frontier lock, which guards jitter_.
+    std::chrono::steady_clock::duration backoff(int attempt) {
+        double capped = std::min(config_.retry_max_delay_seconds, config_.retry_base_delay_seconds * std::ldexp(1.0, attempt));
+        double seconds = capped / 2 + std::uniform_real_distribution<double>(0.0, capped / 2)(jitter_);
+        return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(std::max(0.0, seconds)));
+    }
+
+    // Saves a page unless it is unchanged since the last crawl (a 304, or
+    // the same content hash) or, with duplicate_policy "skip", repeats a
+    // page already kept. New and changed pages go to delta.tsv; only URLs
+    // new to the crawl, or saved under a new path, get a metadata row.
+    bool process_page(const FetchResult& result) {
+        const std::string& url = result.url;
         if (config_.max_pages >= 0 && pages_downloaded_.load() >= config_.max_pages) {
             return false;
         }
 
-        auto result = fetch_url(url, config_.timeout_seconds);
-        if (result.body.empty()) {
+        auto page = crawler::canonicalize_url(url, url_options_);
+        auto previous = fetch_state_.find(url);
+        bool not_modified = result.status == 304;
+        if (!page || (not_modified && !previous)) {
+            release_page(url);
             return true;
         }
 
-        std::string content_type = to_lower(result.content_type);
-        bool is_html = content_type.find("text/html") != std::string::npos || content_type.empty();
-        auto parts = parse_url(url);
-        if (!parts) {
-            return true;
-        }
+        std::string content_type = not_modified ? previous->content_type : to_lower(result.content_type);
+        bool is_html = is_html_type(content_type);
+        // Every 2xx result carries the PageSink open_page_sink built.
+        auto* sink = static_cast<PageSink*>(result.sink.get());
 
-        fs::path saved_path;
-        if (is_html) {
-            saved_path = html_dir_ / sanitize_filename(*parts, ".html", "html");
-            std::ofstream out(saved_path, std::ios::binary);
-            out << result.body;
-        } else {
-            std::string ext = extension_from_url(url);
-            if (ext.empty()) {
-                ext = ".bin";
+        crawler::FetchState state = previous.value_or(crawler::FetchState {});
+        // A 304 may omit validators that are still current.
+        if (!not_modified || !result.etag.empty()) {
+            state.etag = result.etag;
+        }
+        if (!not_modified || !result.last_modified.empty()) {
+            state.last_modified = result.last_modified;
+        }
+        bool changed = false;
+        bool skipped_duplicate = false;
+        std::optional<crawler::HtmlText> text;
+        if (!not_modified) {
+            state.content_hash = sink->body.hash();
+            state.content_type = content_type;
+            // Segment records are never rewritten, so only a new body moves a
+            // page there; a file path can also change with the content type.
+            std::string file_path = segments_ ? std::string() : file_path_for(*page, is_html);
+            // A page skipped as a duplicate last time (no path) is checked
+            // again: what it repeated may have changed or gone since.
+            changed = !previous || previous->path.empty() || previous->content_hash != state.content_hash ||
+                      previous->content_type != content_type ||
+                      (!segments_ && previous->path != file_path);
+            bool check_duplicates = config_.duplicate_policy != Config::DuplicatePolicy::off;
+            if (changed && is_html && (config_.extract_text || check_duplicates)) {
+                // Before save_body, which may move the spill file away.
+                std::string spilled = sink->body.spilled() ? sink->body.read_all() : std::string();
+                std::string_view stored = sink->body.spilled() ? std::string_view(spilled) : sink->body.memory();
+                if (sink->encoding == crawler::ContentEncoding::identity) {
+                    text = crawler::extract_html_text(stored);
+                } else if (auto decoded = crawler::decode_body(sink->encoding, stored,
+                                                               static_cast<uint64_t>(config_.max_html_mb) << 20)) {
+                    text = crawler::extract_html_text(*decoded);
+                }
+            }
+            if (changed && check_duplicates) {
+                auto fingerprint = text ? crawler::simhash(text->text) : std::nullopt;
+                state.simhash = fingerprint.value_or(0);
+                auto match = duplicates_.find_or_insert(url, state.content_hash, fingerprint);
+                metrics_.add(crawler::Counter::duplicate_checks);
+                if (match) {
+                    metrics_.add(match->exact ? crawler::Counter::exact_duplicates : crawler::Counter::near_duplicates);
+                }
+                // A recrawled page always gets a row, so an older flag is cleared.
+                if (match || previous) {
+                    record_duplicate(url, match);
+                }
+                skipped_duplicate = match && config_.duplicate_policy == Config::DuplicatePolicy::skip;
             }
-            saved_path = files_dir_ / sanitize_filename(*parts, ext, "file");
-            std::ofstream out(saved_path, std::ios::binary);
-            out << result.body;
+            if (skipped_duplicate) {
+                // No validators, so the next crawl gets the body to check again.
+                state.path.clear();
+                state.etag.clear();
+                state.last_modified.clear();
+            } else if (changed) {
+                auto location = save_body(url, content_type, *sink, file_path);
+                if (!location) {
+                    release_page(url);
+                    return true;
+                }
+                state.path = std::move(*location);
+            }
+        }
+        state.fetched_at = static_cast<int64_t>(std::time(nullptr));
+        fetch_state_.update(url, state);
+        if (!changed) {
+            metrics_.add(crawler::Counter::pages_unchanged);
+        } else if (!skipped_duplicate) {
+            metrics_.add(crawler::Counter::pages_saved);
         }
 
-        {
-            std::lock_guard<std::mutex> lock(metadata_mutex_);
-            std::ofstream meta(metadata_path_, std::ios::app);
-            meta << url << '\t' << saved_path.generic_string() << '\t' << (content_type.empty() ? "" : content_type) << '\n';
+        if (skipped_duplicate) {
+            if (previous && !previous->path.empty()) {
+                manifest_->append(crawler::ManifestWriter::Stream::delta, url + "\t\t\tremoved\n");
+            }
+        } else if (changed) {
+            std::string row = url + '\t' + state.path + '\t' + content_type;
+            if (!previous || previous->path != state.path) {
+                manifest_->append(crawler::ManifestWriter::Stream::metadata, row + '\n');
+            }
+            manifest_->append(crawler::ManifestWriter::Stream::delta, row + (previous ? "\tchanged\n" : "\tnew\n"));
+            if (text) {
+                manifest_->append(crawler::ManifestWriter::Stream::text,
+                                  format_text_record(url, state.path, content_type, *text, *page, sink->extractor, url_options_));
+            } else if (!is_html && extraction_pool_) {
+                extract_document(url, state.path, content_type,
+                                 crawler::document_format(content_type, crawler::extension_from_url(*page)));
+            }
         }
+        finish_page(url);
 
         long current = pages_downloaded_.fetch_add(1) + 1;
         if (is_html) {
-            auto links = extract_links(result.body, url);
-            for (const auto& link : links) {
-                if (should_enqueue(link)) {
-                    enqueue_url(link);
-                }
+            crawler::LinkExtractor saved;
+            if (not_modified) {
+                std::string body = crawler::read_saved_body(state.path);
+                saved.feed(std::string_view(body).substr(0, static_cast<size_t>(config_.link_scan_kb) << 10));
             }
-        }
-
-        if (config_.request_delay_seconds > 0) {
-            std::this_thread::sleep_for(std::chrono::duration<double>(config_.request_delay_seconds));
+            const auto& extractor = not_modified ? saved : sink->extractor;
+            // Per-worker, so its URL buffers are reused page after page.
+            thread_local crawler::PageLinks links;
+            links.resolve(extractor, *page, url_options_);
+            if (!config_.link_map_output.empty()) {
+                record_links(*page, links);
+            }
+            enqueue_links(std::span(links.begin(), links.size()), result.depth + 1);
+            engine_->notify();
         }
 
         if (config_.max_pages >= 0 && current >= config_.max_pages) {
@@ -487,78 +1618,366 @@ class ParallelCrawler {
         return true;
     }
 
-    bool should_enqueue(const std::string& url) {
-        auto normalized = strip_fragment(url);
-        if (normalized.empty()) {
-            return false;
+    // Queues a saved document for the extraction pool, which reads it back
+    // and appends its text.ndjson line. Waits while the pool's queue is
+    // full, so a backlog of slow PDFs slows page processing instead of
+    // piling up in memory; fetches keep running on the engine threads.
+    void extract_document(const std::string& url, const std::string& path, const std::string& content_type,
+                          crawler::DocumentFormat format) {
+        if (!crawler::can_extract_text(format)) {
+            return;
+        }
+        bool waited = extraction_pool_->submit([this, url, path, content_type, format] {
+            std::string body = crawler::read_saved_body(path);
+            auto text = body.empty() ? std::nullopt : crawler::extract_document_text(format, body);
+            if (!text) {
+                metrics_.add(crawler::Counter::document_extraction_failures);
+                std::cerr << "Failed to extract text from " << url << "\n";
+                return;
+            }
+            metrics_.add(crawler::Counter::documents_extracted);
+            manifest_->append(crawler::ManifestWriter::Stream::text, format_document_record(url, path, content_type, *text));
+        });
+        if (waited) {
+            metrics_.add(crawler::Counter::extraction_queue_waits);
+        }
+    }
+
+    void record_duplicate(const std::string& url, const std::optional<crawler::DuplicateMatch>& match) {
+        std::string row = url + '\t';
+        if (match) {
+            row += match->url + (match->exact ? "\texact\t" : "\tnear\t") + std::to_string(match->distance);
+        } else {
+            row += "\t\t";
+        }
+        manifest_->append(crawler::ManifestWriter::Stream::duplicates, row + '\n');
+    }
+
+    // Edges to allowed hosts only, the same scope the crawl itself covers.
+    void record_links(const CanonicalUrl& page, const crawler::PageLinks& links) {
+        auto in_scope = [this](const CanonicalUrl& link) { return is_allowed_domain(link.authority()); };
+        if (std::none_of(links.begin(), links.end(), in_scope)) {
+            return;
+        }
+        if (config_.link_map_max_pages >= 0 && link_map_pages_.fetch_add(1) >= config_.link_map_max_pages) {
+            return;
+        }
+        uint32_t source = link_graph_.node_id(page.str());
+        std::vector<uint32_t> targets;
+        for (const auto& link : links) {
+            if (in_scope(link)) {
+                targets.push_back(link_graph_.node_id(link.str()));
+            }
+        }
+        link_graph_.add_edges(source, targets);
+    }
+
+    void write_link_map(bool report) {
+        auto graph = link_graph_.build_csr();
+        // Pages recorded since build_csr may have added nodes.
+        auto urls = link_graph_.urls();
+        urls.resize(graph.node_count());
+        fs::path csr_path = config_.link_map_output;
+        csr_path.replace_extension(".csr");
+        fs::create_directories(config_.link_map_output.parent_path());
+        if (crawler::write_csr(csr_path, graph) &&
+            crawler::write_link_map_json(config_.link_map_output, config_.start_url,
+                                         static_cast<uint64_t>(pages_downloaded_.load()), urls, graph) &&
+            report) {
+            std::cout << "Wrote link map with " << graph.node_count() << " nodes and " << graph.edge_count()
+                      << " edges to " << config_.link_map_output << "\n";
+        }
+    }
+
+    std::string file_path_for(const CanonicalUrl& page, bool is_html) const {
+        if (is_html) {
+            return (html_dir_ / sanitize_filename(page, ".html", "html")).generic_string();
+        }
+        std::string ext = crawler::extension_from_url(page);
+        if (ext.empty()) {
+            ext = ".bin";
+        }
+        return (files_dir_ / sanitize_filename(page, ext, "file")).generic_string();
+    }
+
+    // Returns where the body was saved: a segment locator, or `file_path`
+    // when bodies are kept one file per URL.
+    std::optional<std::string> save_body(const std::string& url, const std::string& content_type, PageSink& sink,
+                                         const std::string& file_path) {
+        crawler::BodySpool& body = sink.body;
+        if (segments_) {
+            if (body.spilled()) {
+                return segments_->append_file(url, content_type, body.spill_fd(), body.size(), sink.encoding);
+            }
+            return segments_->append(url, content_type, body.memory(), sink.encoding);
         }
-        if (!is_allowed_domain(normalized)) {
+        if (!body.move_to(file_path)) {
+            std::cerr << "Failed to write " << file_path << "\n";
+            return std::nullopt;
+        }
+        return file_path;
+    }
+
+    bool should_enqueue(const CanonicalUrl& url, int depth) {
+        if (!is_allowed_domain(url.authority()) || !robots_allowed(url)) {
             return false;
         }
-        std::string ext = extension_from_url(normalized);
+        std::string ext = crawler::extension_from_url(url);
         if (!ext.empty()) {
             if (config_.allowed_extensions.find(ext) == config_.allowed_extensions.end()) {
                 return false;
             }
-        } else if (!query_indicates_download(normalized)) {
+        } else if (!crawler::query_indicates_download(url)) {
             // treat extension-less as HTML
         }
+        if (scope_.check(url, depth) != crawler::CrawlScope::Verdict::in_scope) {
+            metrics_.add(crawler::Counter::urls_out_of_scope);
+            return false;
+        }
         return true;
     }
 
-    bool is_allowed_domain(const std::string& url) {
-        auto parts = parse_url(url);
-        if (!parts) {
+    bool robots_allowed(const CanonicalUrl& url) const {
+        for (const auto& [host, rules] : robots_rules_) {
+            if (host == url.authority()) {
+                // Everything after the authority: path and query.
+                std::string_view target = std::string_view(url.str()).substr(url.path().data() - url.str().data());
+                return rules.allowed(target);
+            }
+        }
+        return true;
+    }
+
+    bool owns(const CanonicalUrl& url) const {
+        return !exchange_ || crawler::shard_of(url, config_.shard_count) == config_.shard_index;
+    }
+
+    // allowed_domains is lowercased at load time and authorities are
+    // canonical, so this is a plain comparison.
+    bool is_allowed_domain(std::string_view authority) const {
+        return std::find(config_.allowed_domains.begin(), config_.allowed_domains.end(), authority) != config_.allowed_domains.end();
+    }
+
+    // A URL past the seen-set probe, ready to be admitted under the lock.
+    struct PendingUrl {
+        uint64_t fingerprint = 0;
+        int shard = 0;
+        std::string host;
+        FetchRequest request;
+    };
+
+    PendingUrl pending_url(const CanonicalUrl& url, uint64_t fingerprint, int depth,
+                           std::optional<int64_t> lastmod = std::nullopt) const {
+        PendingUrl pending {fingerprint, exchange_ ? crawler::shard_of(url, config_.shard_count) : 0,
+                            std::string(url.authority()), FetchRequest {url.str()}};
+        pending.request.depth = depth;
+        if (pending.shard == config_.shard_index) {
+            pending.request.priority = priority_for(pending.request.url, depth, lastmod);
+        }
+        return pending;
+    }
+
+    // Caller holds frontier_mutex_. A URL enters the seen-set once, when
+    // first queued, so every URL is fetched at most once; inserting under
+    // the frontier lock lets checkpoints see seen-set and frontier agree,
+    // and keeps them from seeing a forwarded URL before it is in the outbox.
+    // Returns false if another thread got there first.
+    bool admit(PendingUrl& pending) {
+        if (!seen_.insert_fingerprint(pending.fingerprint)) {
             return false;
         }
-        std::string host = parts->host;
-        for (const auto& domain : config_.allowed_domains) {
-            if (host == to_lower(domain)) {
-                return true;
-            }
+        if (pending.shard != config_.shard_index) {
+            // The owner dedupes too; seen_ just keeps repeats off the wire.
+            exchange_->forward(pending.shard, pending.request.url, pending.request.depth);
+            metrics_.add(crawler::Counter::shard_urls_sent);
+            return true;
         }
-        return false;
+        track_inlinks(pending.fingerprint);
+        scheduler_.retain();
+        frontier_.push(pending.host, std::move(pending.request));
+        return true;
     }
 
-    void enqueue_url(const std::string& url) {
-        auto normalized = strip_fragment(url);
-        if (normalized.empty()) {
+    void enqueue_url(const CanonicalUrl& url, int depth, std::optional<int64_t> lastmod = std::nullopt) {
+        // Already-seen links, the common case, are turned away by the
+        // lock-free probe.
+        uint64_t fingerprint = crawler::url_fingerprint(url.str());
+        metrics_.add(crawler::Counter::urls_discovered);
+        if (seen_.contains_fingerprint(fingerprint)) {
+            metrics_.add(crawler::Counter::urls_already_seen);
+            count_inlink(url, fingerprint);
             return;
         }
-        if (!is_allowed_domain(normalized)) {
+        PendingUrl pending = pending_url(url, fingerprint, depth, lastmod);
+        std::lock_guard<std::mutex> lock(frontier_mutex_);
+        if (!admit(pending)) {
+            metrics_.add(crawler::Counter::urls_already_seen);
+        }
+    }
+
+    // Queues a page's links with one frontier-lock acquisition rather than
+    // one per link. Before the lock, repeats within the page go (counting
+    // once towards in-links), then links this worker saw recently, then
+    // whatever the seen-set's lock-free probe knows.
+    void enqueue_links(std::span<const CanonicalUrl> links, int depth) {
+        thread_local std::vector<std::pair<uint64_t, uint32_t>> page;
+        thread_local std::vector<PendingUrl> fresh;
+        thread_local crawler::RecentFingerprints recent;
+        page.clear();
+        fresh.clear();
+        for (size_t i = 0; i < links.size(); ++i) {
+            if (should_enqueue(links[i], depth)) {
+                page.emplace_back(crawler::url_fingerprint(links[i].str()), static_cast<uint32_t>(i));
+            }
+        }
+        if (page.empty()) {
             return;
         }
-        std::lock_guard<std::mutex> lock(visited_mutex_);
-        if (visited_.count(normalized) > 0 || queued_.count(normalized) > 0) {
+        size_t discovered = page.size();
+        // Keep the first of each repeat, then restore page order, which sets
+        // the order links are fetched in.
+        std::sort(page.begin(), page.end());
+        page.erase(std::unique(page.begin(), page.end(), [](const auto& a, const auto& b) { return a.first == b.first; }),
+                   page.end());
+        std::sort(page.begin(), page.end(), [](const auto& a, const auto& b) { return a.second < b.second; });
+        size_t already_seen = discovered - page.size();
+        for (const auto& [fingerprint, index] : page) {
+            const CanonicalUrl& url = links[index];
+            if (recent.contains(fingerprint) || seen_.contains_fingerprint(fingerprint)) {
+                recent.insert(fingerprint);
+                ++already_seen;
+                count_inlink(url, fingerprint);
+                continue;
+            }
+            fresh.push_back(pending_url(url, fingerprint, depth));
+        }
+        if (!fresh.empty()) {
+            std::lock_guard<std::mutex> lock(frontier_mutex_);
+            for (auto& pending : fresh) {
+                already_seen += admit(pending) ? 0 : 1;
+            }
+        }
+        for (const auto& pending : fresh) {
+            recent.insert(pending.fingerprint);
+        }
+        metrics_.add(crawler::Counter::urls_discovered, discovered);
+        metrics_.add(crawler::Counter::urls_already_seen, already_seen);
+    }
+
+    // A sitemap <lastmod> newer than the last fetch makes the URL count as
+    // never fetched; an older one as just fetched.
+    uint8_t priority_for(const std::string& url, int depth, std::optional<int64_t> lastmod = std::nullopt) const {
+        if (!config_.priority_frontier) {
+            return 0;
+        }
+        std::optional<double> age_days;
+        if (auto state = fetch_state_.find(url); state && state->fetched_at > 0) {
+            if (!lastmod) {
+                age_days = static_cast<double>(std::time(nullptr) - state->fetched_at) / 86400.0;
+            } else if (*lastmod <= state->fetched_at) {
+                age_days = 0.0;
+            }
+        }
+        return priority_.level(url, depth, 1, age_days);
+    }
+
+    void track_inlinks(uint64_t fingerprint) {
+        if (config_.priority_frontier && priority_.promotion_levels() > 0) {
+            inlinks_.track(fingerprint);
+        }
+    }
+
+    // A queued URL moves up each time its in-link count doubles; the lock
+    // is only taken for those promotions.
+    void count_inlink(const CanonicalUrl& url, uint64_t fingerprint) {
+        if (!config_.priority_frontier || priority_.promotion_levels() <= 0) {
             return;
         }
-        queued_.insert(normalized);
-        {
-            std::lock_guard<std::mutex> qlock(queue_mutex_);
-            frontier_.push(normalized);
+        uint32_t count = inlinks_.add(fingerprint);
+        if (count >= 2 && (count & (count - 1)) == 0) {
+            std::lock_guard<std::mutex> lock(frontier_mutex_);
+            frontier_.promote(std::string(url.authority()), url.str(), priority_.promotion_levels());
         }
     }
 
     Config config_;
     fs::path html_dir_;
     fs::path files_dir_;
+    fs::path spill_dir_;
     fs::path metadata_path_;
+    fs::path fetch_state_path_;
+    fs::path delta_path_;
+    crawler::NormalizeOptions url_options_;
+    crawler::CrawlScope scope_;
 
-    std::queue<std::string> frontier_;
-    std::unordered_set<std::string> visited_;
-    std::unordered_set<std::string> queued_;
-    std::mutex queue_mutex_;
-    std::mutex visited_mutex_;
-    std::mutex metadata_mutex_;
+    crawler::WorkStealingScheduler<FetchResult> scheduler_;
+    std::unique_ptr<FetchEngine> engine_;
+    crawler::HostFrontier frontier_;
+    std::mutex frontier_mutex_;
+    // Requests issued minus those that failed, so max_pages bounds fetches too.
+    long pages_reserved_ = 0;
+    // Requests handed to the engine whose pages are not processed yet.
+    std::unordered_set<std::string> in_progress_;
+    crawler::SeenSet seen_;
+    crawler::DuplicateIndex duplicates_;
+    crawler::CrawlPriority priority_;
+    crawler::InlinkCounter inlinks_;
+    // Allow/Disallow rules by host; filled before the crawl starts, then
+    // read without locking.
+    std::vector<std::pair<std::string, crawler::RobotsRules>> robots_rules_;
+    crawler::FetchStateStore fetch_state_;
+    std::unique_ptr<crawler::ManifestWriter> manifest_;
+    std::unique_ptr<crawler::ShardExchange> exchange_;
+    std::mutex sink_pool_mutex_;
+    std::vector<std::unique_ptr<PageSink>> sink_pool_;
+    std::atomic<bool> shards_finished_ {false};
+    std::unique_ptr<crawler::SegmentWriter> segments_;
+    // Set with extract_text; closed once page processing is over.
+    std::unique_ptr<crawler::BoundedTaskPool> extraction_pool_;
+    crawler::LinkGraph link_graph_;
+    std::atomic<long> link_map_pages_ {0};
+    crawler::CrawlMetrics metrics_;
+    // Both guarded by frontier_mutex_.
+    crawler::AimdLimiter limiter_;
+    std::mt19937_64 jitter_;
+    // Wakes the checkpoint and stats threads when the crawl ends.
+    std::mutex done_mutex_;
+    std::condition_variable done_cv_;
+    bool crawl_done_ = false;
     std::atomic<long> pages_downloaded_ {0};
-    std::atomic<long> active_workers_ {0};
 };
 
 }  // namespace
 
-int main() {
-    Config config = load_config(fs::current_path());
-    ParallelCrawler crawler(std::move(config));
+int main(int argc, char** argv) {
+    bool resume = false;
+    bool full_recrawl = false;
+    ConfigOverrides overrides;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--resume") {
+            resume = true;
+        } else if (arg == "--full") {
+            full_recrawl = true;
+        } else if (arg == "--config" && has_value) {
+            overrides.config_path = argv[++i];
+        } else if (arg == "--set" && has_value && std::string_view(argv[i + 1]).find('=') != std::string_view::npos) {
+            std::string assignment = argv[++i];
+            size_t eq = assignment.find('=');
+            overrides.values.emplace_back(assignment.substr(0, eq), assignment.substr(eq + 1));
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--resume] [--full] [--config path] [--set key=value]...\n";
+            return 1;
+        }
+    }
+    auto config = load_config(fs::current_path(), overrides);
+    if (!config) {
+        return 1;
+    }
+    config->resume = resume;
+    config->full_recrawl = full_recrawl;
+    ParallelCrawler crawler(std::move(*config));
     crawler.run();
     std::cout << "Parallel crawler finished." << std::endl;
     return 0;
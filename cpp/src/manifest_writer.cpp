@@ -0,0 +1,197 @@
+#include "manifest_writer.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+namespace crawler {
+
+namespace {
+
+// A full buffer is written out without waiting for the next interval.
+constexpr size_t kBufferLimit = 1 << 16;
+
+int open_append(const std::filesystem::path& path, uint64_t& size) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to open " << path << ": " << std::strerror(errno) << "\n";
+        return fd;
+    }
+    struct stat info {};
+    size = fstat(fd, &info) == 0 ? static_cast<uint64_t>(info.st_size) : 0;
+    return fd;
+}
+
+}  // namespace
+
+ManifestWriter::ManifestWriter(const std::filesystem::path& metadata_path, const std::filesystem::path& delta_path,
+                               const std::filesystem::path& text_path, const std::filesystem::path& duplicates_path,
+                               std::chrono::milliseconds flush_interval)
+    : flush_interval_(flush_interval) {
+    file(Stream::metadata).fd = open_append(metadata_path, file(Stream::metadata).size);
+    file(Stream::delta).fd = open_append(delta_path, file(Stream::delta).size);
+    if (!text_path.empty()) {
+        file(Stream::text).fd = open_append(text_path, file(Stream::text).size);
+    }
+    if (!duplicates_path.empty()) {
+        file(Stream::duplicates).fd = open_append(duplicates_path, file(Stream::duplicates).size);
+    }
+    thread_ = std::thread([this] { run(); });
+}
+
+ManifestWriter::~ManifestWriter() {
+    close();
+}
+
+void ManifestWriter::append(Stream stream, std::string line) {
+    auto* node = new Node;
+    node->stream = stream;
+    node->line = std::move(line);
+    if (!push(node)) {
+        std::cerr << "Dropping manifest row appended after close\n";
+        delete node;
+    }
+}
+
+std::future<uint64_t> ManifestWriter::mark(std::function<void()> before_sync) {
+    auto* node = new Node;
+    node->mark = new Mark {std::promise<uint64_t>(), std::move(before_sync)};
+    auto future = node->mark->offset.get_future();
+    if (!push(node)) {
+        // close() wrote and fsynced every row before releasing the lock.
+        std::lock_guard<std::mutex> lock(close_mutex_);
+        if (node->mark->before_sync) {
+            node->mark->before_sync();
+        }
+        node->mark->offset.set_value(file(Stream::metadata).size);
+        delete node->mark;
+        delete node;
+        return future;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        wake_requested_ = true;
+    }
+    wake_.notify_one();
+    return future;
+}
+
+void ManifestWriter::close() {
+    std::lock_guard<std::mutex> close_lock(close_mutex_);
+    closed_.store(true);
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stop_ = true;
+    }
+    wake_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    // Rows pushed after the writer's last drain, or still being linked in,
+    // are written here.
+    while (pushing_.load() != 0) {
+        std::this_thread::yield();
+    }
+    drain();
+    flush_all(true);
+    for (File& file : files_) {
+        if (file.fd >= 0) {
+            ::close(file.fd);
+            file.fd = -1;
+        }
+    }
+}
+
+bool ManifestWriter::push(Node* node) {
+    pushing_.fetch_add(1);
+    if (closed_.load()) {
+        pushing_.fetch_sub(1);
+        return false;
+    }
+    node->next = head_.load(std::memory_order_relaxed);
+    while (!head_.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    pushing_.fetch_sub(1);
+    return true;
+}
+
+void ManifestWriter::run() {
+    while (true) {
+        bool stopping = false;
+        {
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_.wait_for(lock, flush_interval_, [this] { return stop_ || wake_requested_; });
+            wake_requested_ = false;
+            stopping = stop_;
+        }
+        drain();
+        flush_all(stopping);
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+void ManifestWriter::drain() {
+    Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+    // The list is newest first; reverse it to write rows in push order.
+    Node* ordered = nullptr;
+    while (node) {
+        Node* next = node->next;
+        node->next = ordered;
+        ordered = node;
+        node = next;
+    }
+    while (ordered) {
+        Node* next = ordered->next;
+        if (ordered->mark) {
+            if (ordered->mark->before_sync) {
+                ordered->mark->before_sync();
+            }
+            flush_all(true);
+            ordered->mark->offset.set_value(file(Stream::metadata).size);
+            delete ordered->mark;
+        } else {
+            File& target = file(ordered->stream);
+            target.buffer += ordered->line;
+            if (target.buffer.size() >= kBufferLimit) {
+                flush(target, false);
+            }
+        }
+        delete ordered;
+        ordered = next;
+    }
+}
+
+void ManifestWriter::flush_all(bool sync) {
+    for (File& file : files_) {
+        flush(file, sync);
+    }
+}
+
+void ManifestWriter::flush(File& file, bool sync) {
+    size_t written = 0;
+    while (file.fd >= 0 && written < file.buffer.size()) {
+        ssize_t n = ::write(file.fd, file.buffer.data() + written, file.buffer.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Failed to write manifest: " << std::strerror(errno) << "\n";
+            break;
+        }
+        written += static_cast<size_t>(n);
+    }
+    file.size += written;
+    file.buffer.clear();
+    if (sync && file.fd >= 0) {
+        fsync(file.fd);
+    }
+}
+
+}  // namespace crawler
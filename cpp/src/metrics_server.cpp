@@ -0,0 +1,145 @@
+#include "metrics_server.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+
+namespace crawler {
+
+namespace {
+
+constexpr int kAcceptPollMs = 250;
+constexpr size_t kMaxRequestBytes = 8192;
+// A scraper hanging up mid-response must not raise SIGPIPE; macOS has no
+// MSG_NOSIGNAL and uses the SO_NOSIGPIPE socket option instead.
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+bool send_all(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t sent = ::send(fd, data.data(), data.size(), kSendFlags);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(sent));
+    }
+    return true;
+}
+
+std::string response(std::string_view status, std::string_view content_type, std::string_view body) {
+    std::string out = "HTTP/1.1 ";
+    out += status;
+    out += "\r\nContent-Type: ";
+    out += content_type;
+    out += "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+    out += body;
+    return out;
+}
+
+}  // namespace
+
+MetricsServer::MetricsServer(std::function<std::string()> render) : render_(std::move(render)) {}
+
+MetricsServer::~MetricsServer() { stop(); }
+
+bool MetricsServer::start(const std::string& address, int port) {
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (::inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) {
+        std::cerr << "Invalid metrics address " << address << "\n";
+        return false;
+    }
+    listener_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listener_ < 0) {
+        std::cerr << "Failed to create metrics socket: " << std::strerror(errno) << "\n";
+        return false;
+    }
+    int reuse = 1;
+    ::setsockopt(listener_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (::bind(listener_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(listener_, 16) != 0) {
+        std::cerr << "Failed to listen on " << address << ":" << port << ": " << std::strerror(errno) << "\n";
+        ::close(listener_);
+        listener_ = -1;
+        return false;
+    }
+    stop_.store(false);
+    thread_ = std::thread([this] { serve(); });
+    return true;
+}
+
+void MetricsServer::stop() {
+    stop_.store(true);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (listener_ >= 0) {
+        ::close(listener_);
+        listener_ = -1;
+    }
+}
+
+void MetricsServer::serve() {
+    // Polled with a timeout so stop() is noticed without closing the socket
+    // under the thread.
+    while (!stop_.load()) {
+        pollfd fd {listener_, POLLIN, 0};
+        if (::poll(&fd, 1, kAcceptPollMs) <= 0) {
+            continue;
+        }
+        int client = ::accept(listener_, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+        handle(client);
+        ::close(client);
+    }
+}
+
+void MetricsServer::handle(int client) {
+    // A slow or silent client must not hold the endpoint for long.
+    timeval timeout {2, 0};
+    ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    ::setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+    int no_sigpipe = 1;
+    ::setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe, sizeof(no_sigpipe));
+#endif
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < kMaxRequestBytes) {
+        ssize_t received = ::recv(client, buffer, sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            break;
+        }
+        request.append(buffer, static_cast<size_t>(received));
+    }
+    std::string_view line(request);
+    line = line.substr(0, line.find("\r\n"));
+    if (line.starts_with("GET /metrics ") || line.starts_with("GET /metrics?")) {
+        send_all(client, response("200 OK", "text/plain; version=0.0.4; charset=utf-8", render_()));
+    } else if (line.starts_with("GET ")) {
+        send_all(client, response("404 Not Found", "text/plain", "Not found; metrics are at /metrics\n"));
+    } else {
+        send_all(client, response("405 Method Not Allowed", "text/plain", "Only GET is supported\n"));
+    }
+}
+
+}  // namespace crawler
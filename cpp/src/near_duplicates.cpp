@@ -0,0 +1,176 @@
+#include "near_duplicates.hpp"
+
+#include "hash.hpp"
+#include "string_util.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace crawler {
+
+namespace {
+
+constexpr size_t kShingleWords = 3;
+// Below this many shingles a few changed words flip most of the hash.
+constexpr size_t kMinShingles = 8;
+
+inline bool is_word_byte(unsigned char c) {
+    // Bytes of multi-byte UTF-8 characters count as letters.
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c >= 0x80;
+}
+
+inline uint64_t rotl(uint64_t x, int bits) {
+    return (x << bits) | (x >> (64 - bits));
+}
+
+}  // namespace
+
+std::optional<uint64_t> simhash(std::string_view text) {
+    std::array<int32_t, 64> weights {};
+    std::array<uint64_t, kShingleWords> window {};
+    std::string word;
+    size_t words = 0;
+    size_t shingles = 0;
+    size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() && !is_word_byte(static_cast<unsigned char>(text[i]))) {
+            ++i;
+        }
+        if (i == text.size()) {
+            break;
+        }
+        word.clear();
+        while (i < text.size() && is_word_byte(static_cast<unsigned char>(text[i]))) {
+            word.push_back(ascii_lower(text[i++]));
+        }
+        window[words++ % kShingleWords] = hash_bytes(word);
+        if (words < kShingleWords) {
+            continue;
+        }
+        // Rotating by position keeps "a b c" and "c b a" apart.
+        uint64_t shingle = 0;
+        for (size_t k = 0; k < kShingleWords; ++k) {
+            shingle ^= rotl(window[(words - kShingleWords + k) % kShingleWords], static_cast<int>(k * 21 + 1));
+        }
+        shingle = mix64(shingle);
+        for (int bit = 0; bit < 64; ++bit) {
+            weights[bit] += ((shingle >> bit) & 1) ? 1 : -1;
+        }
+        ++shingles;
+    }
+    if (shingles < kMinShingles) {
+        return std::nullopt;
+    }
+    uint64_t hash = 0;
+    for (int bit = 0; bit < 64; ++bit) {
+        if (weights[bit] > 0) {
+            hash |= uint64_t {1} << bit;
+        }
+    }
+    return hash;
+}
+
+DuplicateIndex::DuplicateIndex(int max_distance) : max_distance_(std::clamp(max_distance, 0, 63)) {
+    int count = max_distance_ + 1;
+    int shift = 0;
+    for (int band = 0; band < count; ++band) {
+        int width = 64 / count + (band < 64 % count ? 1 : 0);
+        bands_.push_back({shift, width == 64 ? ~uint64_t {0} : (uint64_t {1} << width) - 1});
+        shift += width;
+    }
+    band_tables_.resize(bands_.size());
+}
+
+uint64_t DuplicateIndex::band_key(size_t band, uint64_t simhash) const {
+    return (simhash >> bands_[band].shift) & bands_[band].mask;
+}
+
+std::optional<DuplicateMatch> DuplicateIndex::find(uint64_t content_hash, std::optional<uint64_t> simhash) const {
+    auto exact = exact_.find(content_hash);
+    if (exact != exact_.end() && !exact->second.empty()) {
+        return DuplicateMatch {entries_[exact->second.front()].url, true, 0};
+    }
+    if (!simhash) {
+        return std::nullopt;
+    }
+    std::optional<DuplicateMatch> best;
+    for (size_t band = 0; band < bands_.size(); ++band) {
+        auto it = band_tables_[band].find(band_key(band, *simhash));
+        if (it == band_tables_[band].end()) {
+            continue;
+        }
+        for (uint32_t candidate : it->second) {
+            int distance = hamming_distance(*simhash, *entries_[candidate].simhash);
+            if (distance <= max_distance_ && (!best || distance < best->distance)) {
+                best = DuplicateMatch {entries_[candidate].url, false, distance};
+            }
+        }
+    }
+    return best;
+}
+
+void DuplicateIndex::erase_locked(const std::string& url) {
+    auto slot = slots_.find(url);
+    if (slot == slots_.end()) {
+        return;
+    }
+    uint32_t index = slot->second;
+    auto unlink = [index](std::unordered_map<uint64_t, std::vector<uint32_t>>& table, uint64_t key) {
+        auto it = table.find(key);
+        if (it == table.end()) {
+            return;
+        }
+        std::erase(it->second, index);
+        if (it->second.empty()) {
+            table.erase(it);
+        }
+    };
+    Entry& entry = entries_[index];
+    unlink(exact_, entry.content_hash);
+    if (entry.simhash) {
+        for (size_t band = 0; band < bands_.size(); ++band) {
+            unlink(band_tables_[band], band_key(band, *entry.simhash));
+        }
+    }
+    entry = Entry {};
+    free_.push_back(index);
+    slots_.erase(slot);
+}
+
+std::optional<DuplicateMatch> DuplicateIndex::find_or_insert(const std::string& url, uint64_t content_hash,
+                                                             std::optional<uint64_t> simhash) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    erase_locked(url);
+    if (auto match = find(content_hash, simhash)) {
+        return match;
+    }
+    uint32_t index;
+    if (free_.empty()) {
+        index = static_cast<uint32_t>(entries_.size());
+        entries_.emplace_back();
+    } else {
+        index = free_.back();
+        free_.pop_back();
+    }
+    entries_[index] = Entry {url, content_hash, simhash};
+    slots_.emplace(url, index);
+    exact_[content_hash].push_back(index);
+    if (simhash) {
+        for (size_t band = 0; band < bands_.size(); ++band) {
+            band_tables_[band][band_key(band, *simhash)].push_back(index);
+        }
+    }
+    return std::nullopt;
+}
+
+void DuplicateIndex::remove(const std::string& url) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    erase_locked(url);
+}
+
+size_t DuplicateIndex::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return slots_.size();
+}
+
+}  // namespace crawler
@@ -0,0 +1,201 @@
+#include "robots.hpp"
+
+#include "string_util.hpp"
+
+#include <cctype>
+#include <cstdlib>
+#include <string>
+
+namespace crawler {
+
+namespace {
+
+// Brings a rule to the form canonical URLs are in: bytes outside printable
+// ASCII percent-encoded, escapes upper-cased.
+std::string normalize_pattern(std::string_view pattern) {
+    static constexpr char kHex[] = "0123456789ABCDEF";
+    std::string out;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        auto c = static_cast<unsigned char>(pattern[i]);
+        if (c == '%' && i + 2 < pattern.size() && std::isxdigit(static_cast<unsigned char>(pattern[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(pattern[i + 2]))) {
+            out.push_back('%');
+            out.push_back(static_cast<char>(std::toupper(static_cast<unsigned char>(pattern[i + 1]))));
+            out.push_back(static_cast<char>(std::toupper(static_cast<unsigned char>(pattern[i + 2]))));
+            i += 2;
+        } else if (c <= 0x20 || c >= 0x7F) {
+            out.push_back('%');
+            out.push_back(kHex[c >> 4]);
+            out.push_back(kHex[c & 0xF]);
+        } else {
+            out.push_back(static_cast<char>(c));
+        }
+    }
+    return out;
+}
+
+// `*` matches any run of bytes; a final `$` anchors the end of the target.
+bool wildcard_match(std::string_view pattern, std::string_view target) {
+    bool anchored = !pattern.empty() && pattern.back() == '$';
+    if (anchored) {
+        pattern.remove_suffix(1);
+    }
+    size_t p = 0;
+    size_t t = 0;
+    size_t star = std::string_view::npos;
+    size_t resume = 0;
+    while (t < target.size()) {
+        if (p == pattern.size() && !anchored) {
+            return true;
+        }
+        if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            resume = t;
+        } else if (p < pattern.size() && pattern[p] == target[t]) {
+            ++p;
+            ++t;
+        } else if (star != std::string_view::npos) {
+            p = star + 1;
+            t = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+}  // namespace
+
+void RobotsRules::add(std::string_view raw, bool allow) {
+    std::string pattern = normalize_pattern(raw);
+    if (pattern.empty()) {
+        // "Disallow:" with no value allows everything.
+        return;
+    }
+    if (pattern.find('*') != std::string::npos || pattern.back() == '$') {
+        patterns_.push_back({std::move(pattern), allow});
+        return;
+    }
+    uint32_t node = 0;
+    for (char c : pattern) {
+        uint32_t child = nodes_[node].first_child;
+        while (child != 0 && nodes_[child].byte != c) {
+            child = nodes_[child].next_sibling;
+        }
+        if (child == 0) {
+            child = static_cast<uint32_t>(nodes_.size());
+            Node added;
+            added.byte = c;
+            added.next_sibling = nodes_[node].first_child;
+            nodes_.push_back(added);
+            nodes_[node].first_child = child;
+        }
+        node = child;
+    }
+    if (nodes_[node].rule != kAllow) {
+        nodes_[node].rule = allow ? kAllow : kDisallow;
+    }
+}
+
+bool RobotsRules::allowed(std::string_view target) const {
+    size_t best_length = 0;
+    bool best_allow = true;
+    uint32_t node = 0;
+    for (size_t i = 0; i < target.size(); ++i) {
+        uint32_t child = nodes_[node].first_child;
+        while (child != 0 && nodes_[child].byte != target[i]) {
+            child = nodes_[child].next_sibling;
+        }
+        if (child == 0) {
+            break;
+        }
+        node = child;
+        if (nodes_[node].rule != kNone) {
+            best_length = i + 1;
+            best_allow = nodes_[node].rule == kAllow;
+        }
+    }
+    for (const auto& pattern : patterns_) {
+        size_t length = pattern.text.size();
+        if ((length > best_length || (length == best_length && pattern.allow)) && wildcard_match(pattern.text, target)) {
+            best_length = length;
+            best_allow = pattern.allow;
+        }
+    }
+    return best_allow;
+}
+
+RobotsPolicy parse_robots(std::string_view body, std::string_view agent) {
+    std::string agent_token = to_lower(std::string(agent));
+    RobotsPolicy ours;
+    RobotsPolicy star;
+    std::vector<std::string> sitemaps;
+    bool matched_ours = false;
+    bool in_agent_lines = false;
+    bool group_ours = false;
+    bool group_star = false;
+
+    size_t pos = 0;
+    while (pos < body.size()) {
+        size_t eol = body.find('\n', pos);
+        std::string_view line = body.substr(pos, eol == std::string_view::npos ? std::string_view::npos : eol - pos);
+        pos = eol == std::string_view::npos ? body.size() : eol + 1;
+
+        line = line.substr(0, line.find('#'));
+        auto colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+        std::string key = to_lower(std::string(trim_view(line.substr(0, colon))));
+        std::string_view value = trim_view(line.substr(colon + 1));
+
+        if (key == "user-agent") {
+            // Consecutive user-agent lines share one group.
+            if (!in_agent_lines) {
+                group_ours = false;
+                group_star = false;
+            }
+            in_agent_lines = true;
+            std::string token = to_lower(std::string(value));
+            if (token == "*") {
+                group_star = true;
+            } else if (!token.empty() && agent_token.rfind(token, 0) == 0) {
+                group_ours = true;
+                matched_ours = true;
+            }
+            continue;
+        }
+        in_agent_lines = false;
+        if (key == "sitemap") {
+            if (!value.empty()) {
+                sitemaps.emplace_back(value);
+            }
+        } else if (key == "allow" || key == "disallow") {
+            if (group_ours) {
+                ours.rules.add(value, key == "allow");
+            } else if (group_star) {
+                star.rules.add(value, key == "allow");
+            }
+        } else if (key == "crawl-delay") {
+            std::string number(value);
+            char* end = nullptr;
+            double seconds = std::strtod(number.c_str(), &end);
+            if (end == number.c_str() || seconds < 0) {
+                continue;
+            }
+            if (group_ours) {
+                ours.crawl_delay_seconds = seconds;
+            } else if (group_star) {
+                star.crawl_delay_seconds = seconds;
+            }
+        }
+    }
+    RobotsPolicy policy = matched_ours ? std::move(ours) : std::move(star);
+    policy.sitemaps = std::move(sitemaps);
+    return policy;
+}
+
+}  // namespace crawler
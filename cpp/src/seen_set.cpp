@@ -0,0 +1,167 @@
+#include "seen_set.hpp"
+
+#include <algorithm>
+
+namespace crawler {
+
+namespace {
+
+// Slot value 0 marks an empty slot, so a zero fingerprint is stored as 1.
+constexpr uint64_t kEmpty = 0;
+
+inline uint64_t storable(uint64_t fingerprint) {
+    return fingerprint == kEmpty ? 1 : fingerprint;
+}
+
+size_t round_up_pow2(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+}  // namespace
+
+// Each key sets six bits inside one 512-bit block, so a lookup touches a
+// single cache line. The block comes from a remix of the fingerprint and the
+// bit positions from its own 54 low bits.
+class SeenSet::BloomFilter {
+   public:
+    explicit BloomFilter(size_t expected)
+        : block_mask_(round_up_pow2(std::max<size_t>(1, expected * kBitsPerKey / 512)) - 1),
+          words_(std::make_unique<std::atomic<uint64_t>[]>((block_mask_ + 1) * kWordsPerBlock)) {}
+
+    void add(uint64_t fingerprint) {
+        std::atomic<uint64_t>* block = &words_[(mix64(fingerprint) & block_mask_) * kWordsPerBlock];
+        uint64_t h = fingerprint;
+        for (int i = 0; i < kHashes; ++i, h >>= 9) {
+            block[(h >> 6) & 7].fetch_or(uint64_t {1} << (h & 63), std::memory_order_relaxed);
+        }
+    }
+
+    bool maybe_contains(uint64_t fingerprint) const {
+        const std::atomic<uint64_t>* block = &words_[(mix64(fingerprint) & block_mask_) * kWordsPerBlock];
+        uint64_t h = fingerprint;
+        for (int i = 0; i < kHashes; ++i, h >>= 9) {
+            if (!(block[(h >> 6) & 7].load(std::memory_order_relaxed) & (uint64_t {1} << (h & 63)))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+   private:
+    static constexpr size_t kBitsPerKey = 10;
+    static constexpr size_t kWordsPerBlock = 8;
+    static constexpr int kHashes = 6;
+
+    size_t block_mask_;
+    std::unique_ptr<std::atomic<uint64_t>[]> words_;
+};
+
+SeenSet::Table::Table(size_t capacity)
+    : mask(capacity - 1),
+      slots(std::make_unique<std::atomic<uint64_t>[]>(capacity)) {}
+
+SeenSet::SeenSet(size_t expected, bool bloom_filter) {
+    // Start each stripe below the 3/4 growth threshold for `expected` URLs.
+    size_t per_stripe = round_up_pow2(std::max<size_t>(16, expected / kStripes * 4 / 3 + 1));
+    for (Stripe& stripe : stripes_) {
+        stripe.generations.push_back(std::make_unique<Table>(per_stripe));
+        stripe.table.store(stripe.generations.back().get(), std::memory_order_release);
+    }
+    if (bloom_filter) {
+        bloom_ = std::make_unique<BloomFilter>(expected);
+    }
+}
+
+SeenSet::~SeenSet() = default;
+
+bool SeenSet::probe(const Table& table, uint64_t fingerprint) {
+    for (size_t i = fingerprint & table.mask;; i = (i + 1) & table.mask) {
+        uint64_t slot = table.slots[i].load(std::memory_order_acquire);
+        if (slot == fingerprint) {
+            return true;
+        }
+        if (slot == kEmpty) {
+            return false;
+        }
+    }
+}
+
+// Caller holds the stripe lock. Returns false if already present.
+bool SeenSet::place(Table& table, uint64_t fingerprint) {
+    for (size_t i = fingerprint & table.mask;; i = (i + 1) & table.mask) {
+        uint64_t slot = table.slots[i].load(std::memory_order_relaxed);
+        if (slot == fingerprint) {
+            return false;
+        }
+        if (slot == kEmpty) {
+            table.slots[i].store(fingerprint, std::memory_order_release);
+            return true;
+        }
+    }
+}
+
+void SeenSet::grow(Stripe& stripe) {
+    const Table& old_table = *stripe.generations.back();
+    auto table = std::make_unique<Table>((old_table.mask + 1) * 2);
+    for (size_t i = 0; i <= old_table.mask; ++i) {
+        uint64_t slot = old_table.slots[i].load(std::memory_order_relaxed);
+        if (slot != kEmpty) {
+            place(*table, slot);
+        }
+    }
+    stripe.table.store(table.get(), std::memory_order_release);
+    stripe.generations.push_back(std::move(table));
+}
+
+std::vector<uint64_t> SeenSet::fingerprints() const {
+    std::vector<uint64_t> out;
+    out.reserve(size());
+    for (const Stripe& stripe : stripes_) {
+        const Table& table = *stripe.table.load(std::memory_order_acquire);
+        for (size_t i = 0; i <= table.mask; ++i) {
+            uint64_t slot = table.slots[i].load(std::memory_order_acquire);
+            if (slot != kEmpty) {
+                out.push_back(slot);
+            }
+        }
+    }
+    return out;
+}
+
+bool SeenSet::contains_fingerprint(uint64_t fingerprint) const {
+    fingerprint = storable(fingerprint);
+    if (bloom_ && !bloom_->maybe_contains(fingerprint)) {
+        return false;
+    }
+    const Stripe& stripe = stripes_[fingerprint >> (64 - kStripeBits)];
+    return probe(*stripe.table.load(std::memory_order_acquire), fingerprint);
+}
+
+bool SeenSet::insert_fingerprint(uint64_t fingerprint) {
+    fingerprint = storable(fingerprint);
+    Stripe& stripe = stripes_[fingerprint >> (64 - kStripeBits)];
+    bool maybe_seen = !bloom_ || bloom_->maybe_contains(fingerprint);
+    if (maybe_seen && probe(*stripe.table.load(std::memory_order_acquire), fingerprint)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    if ((stripe.count + 1) * 4 > (stripe.generations.back()->mask + 1) * 3) {
+        grow(stripe);
+    }
+    if (!place(*stripe.generations.back(), fingerprint)) {
+        return false;
+    }
+    ++stripe.count;
+    if (bloom_) {
+        bloom_->add(fingerprint);
+    }
+    size_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+}  // namespace crawler
@@ -0,0 +1,321 @@
+#include "segment_store.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <system_error>
+
+namespace crawler {
+
+namespace {
+
+constexpr char kSegmentMagic[8] = {'F', 'G', 'S', 'E', 'G', '0', '0', '1'};
+constexpr char kRecordMagic[4] = {'F', 'G', 'R', '1'};
+constexpr std::string_view kSegmentExtension = ".seg";
+
+struct RecordHeader {
+    char magic[4];
+    uint32_t url_length;
+    uint32_t content_type_length;
+    uint32_t flags;
+    uint64_t body_length;
+};
+
+static_assert(sizeof(RecordHeader) == 24, "record header must stay packed");
+
+constexpr char kZeros[8] = {};
+constexpr size_t kCopyChunk = 1 << 16;
+
+uint64_t padding_for(uint64_t length) {
+    return (8 - length % 8) % 8;
+}
+
+RecordHeader make_header(std::string_view url, std::string_view content_type, uint64_t body_length,
+                         ContentEncoding encoding) {
+    RecordHeader header {};
+    std::memcpy(header.magic, kRecordMagic, sizeof(kRecordMagic));
+    header.url_length = static_cast<uint32_t>(url.size());
+    header.content_type_length = static_cast<uint32_t>(content_type.size());
+    header.flags = static_cast<uint32_t>(encoding);
+    header.body_length = body_length;
+    return header;
+}
+
+bool pwrite_all(int fd, iovec* parts, int count, uint64_t offset) {
+    while (count > 0) {
+        ssize_t n = pwritev(fd, parts, count, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        offset += static_cast<uint64_t>(n);
+        auto left = static_cast<size_t>(n);
+        while (count > 0 && left >= parts->iov_len) {
+            left -= parts->iov_len;
+            ++parts;
+            --count;
+        }
+        if (count > 0) {
+            parts->iov_base = static_cast<char*>(parts->iov_base) + left;
+            parts->iov_len -= left;
+        }
+    }
+    return true;
+}
+
+bool pread_all(int fd, char* out, size_t length, uint64_t offset) {
+    while (length > 0) {
+        ssize_t n = pread(fd, out, length, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        out += n;
+        length -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+// Splits "<path>@<offset>"; nullopt when `location` is not a locator.
+std::optional<std::pair<std::string_view, uint64_t>> split_locator(std::string_view location) {
+    size_t at = location.rfind('@');
+    if (at == std::string_view::npos || at + 1 == location.size()) {
+        return std::nullopt;
+    }
+    std::string_view file = location.substr(0, at);
+    if (file.size() <= kSegmentExtension.size() ||
+        file.substr(file.size() - kSegmentExtension.size()) != kSegmentExtension) {
+        return std::nullopt;
+    }
+    uint64_t offset = 0;
+    const char* end = location.data() + location.size();
+    auto [ptr, ec] = std::from_chars(location.data() + at + 1, end, offset);
+    if (ec != std::errc() || ptr != end) {
+        return std::nullopt;
+    }
+    return std::make_pair(file, offset);
+}
+
+}  // namespace
+
+SegmentWriter::SegmentWriter(std::filesystem::path dir, uint64_t max_bytes)
+    : dir_(std::move(dir)),
+      max_bytes_(max_bytes) {
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    for (const auto& entry : std::filesystem::directory_iterator(dir_, ec)) {
+        if (entry.path().extension() != kSegmentExtension) {
+            continue;
+        }
+        std::string stem = entry.path().stem().string();
+        unsigned index = 0;
+        auto [ptr, parse_ec] = std::from_chars(stem.data(), stem.data() + stem.size(), index);
+        if (parse_ec == std::errc() && ptr == stem.data() + stem.size()) {
+            next_index_ = std::max(next_index_, index + 1);
+        }
+    }
+}
+
+SegmentWriter::~SegmentWriter() {
+    for (int fd : fds_) {
+        ::close(fd);
+    }
+}
+
+bool SegmentWriter::open_next_segment() {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%05u.seg", next_index_++);
+    std::filesystem::path path = dir_ / name;
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to create segment " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    iovec magic {const_cast<char*>(kSegmentMagic), sizeof(kSegmentMagic)};
+    if (!pwrite_all(fd, &magic, 1, 0)) {
+        std::cerr << "Failed to write segment " << path << ": " << std::strerror(errno) << "\n";
+        ::close(fd);
+        return false;
+    }
+    fds_.push_back(fd);
+    current_path_ = path.generic_string();
+    current_size_ = sizeof(kSegmentMagic);
+    return true;
+}
+
+std::optional<SegmentWriter::Slot> SegmentWriter::reserve(uint64_t length) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool full = current_size_ > sizeof(kSegmentMagic) && current_size_ + length > max_bytes_;
+    if ((fds_.empty() || full) && !open_next_segment()) {
+        return std::nullopt;
+    }
+    Slot slot {fds_.back(), current_size_, current_path_};
+    current_size_ += length;
+    return slot;
+}
+
+std::optional<std::string> SegmentWriter::append(std::string_view url, std::string_view content_type, std::string_view body,
+                                                  ContentEncoding encoding) {
+    RecordHeader header = make_header(url, content_type, body.size(), encoding);
+    uint64_t payload = sizeof(header) + url.size() + content_type.size() + body.size();
+    uint64_t length = payload + padding_for(payload);
+    auto slot = reserve(length);
+    if (!slot) {
+        return std::nullopt;
+    }
+    iovec parts[] = {
+        {&header, sizeof(header)},
+        {const_cast<char*>(url.data()), url.size()},
+        {const_cast<char*>(content_type.data()), content_type.size()},
+        {const_cast<char*>(body.data()), body.size()},
+        {const_cast<char*>(kZeros), static_cast<size_t>(length - payload)},
+    };
+    if (!pwrite_all(slot->fd, parts, 5, slot->offset)) {
+        std::cerr << "Failed to write segment " << slot->path << ": " << std::strerror(errno) << "\n";
+        return std::nullopt;
+    }
+    return slot->path + '@' + std::to_string(slot->offset);
+}
+
+std::optional<std::string> SegmentWriter::append_file(std::string_view url, std::string_view content_type, int body_fd,
+                                                       uint64_t body_length, ContentEncoding encoding) {
+    RecordHeader header = make_header(url, content_type, body_length, encoding);
+    uint64_t prefix = sizeof(header) + url.size() + content_type.size();
+    uint64_t payload = prefix + body_length;
+    uint64_t length = payload + padding_for(payload);
+    auto slot = reserve(length);
+    if (!slot) {
+        return std::nullopt;
+    }
+    iovec parts[] = {
+        {&header, sizeof(header)},
+        {const_cast<char*>(url.data()), url.size()},
+        {const_cast<char*>(content_type.data()), content_type.size()},
+    };
+    bool ok = pwrite_all(slot->fd, parts, 3, slot->offset);
+    std::string buffer(kCopyChunk, '\0');
+    uint64_t copied = 0;
+    while (ok && copied < body_length) {
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(kCopyChunk, body_length - copied));
+        ssize_t n = pread(body_fd, buffer.data(), chunk, static_cast<off_t>(copied));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            ok = false;
+            break;
+        }
+        iovec part {buffer.data(), static_cast<size_t>(n)};
+        ok = pwrite_all(slot->fd, &part, 1, slot->offset + prefix + copied);
+        copied += static_cast<uint64_t>(n);
+    }
+    iovec padding {const_cast<char*>(kZeros), static_cast<size_t>(length - payload)};
+    if (!ok || !pwrite_all(slot->fd, &padding, 1, slot->offset + payload)) {
+        std::cerr << "Failed to write segment " << slot->path << ": " << std::strerror(errno) << "\n";
+        return std::nullopt;
+    }
+    return slot->path + '@' + std::to_string(slot->offset);
+}
+
+bool SegmentWriter::sync() {
+    std::vector<int> fds;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fds = fds_;
+    }
+    bool synced = true;
+    for (int fd : fds) {
+        if (fsync(fd) != 0) {
+            std::cerr << "Failed to sync segment: " << std::strerror(errno) << "\n";
+            synced = false;
+        }
+    }
+    return synced;
+}
+
+bool is_segment_locator(std::string_view location) {
+    return split_locator(location).has_value();
+}
+
+std::filesystem::path location_file(std::string_view location) {
+    if (auto locator = split_locator(location)) {
+        return std::filesystem::path(locator->first);
+    }
+    return std::filesystem::path(location);
+}
+
+std::optional<SegmentRecord> read_segment_record(std::string_view locator) {
+    auto parts = split_locator(locator);
+    if (!parts) {
+        return std::nullopt;
+    }
+    std::string path(parts->first);
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return std::nullopt;
+    }
+    std::optional<SegmentRecord> record;
+    RecordHeader header {};
+    uint64_t offset = parts->second;
+    struct stat info {};
+    // Lengths are checked against the file so a torn tail cannot ask for a huge read.
+    bool valid = fstat(fd, &info) == 0 && pread_all(fd, reinterpret_cast<char*>(&header), sizeof(header), offset) &&
+                 std::memcmp(header.magic, kRecordMagic, sizeof(kRecordMagic)) == 0 &&
+                 header.flags <= static_cast<uint32_t>(ContentEncoding::deflate) &&
+                 header.body_length <= static_cast<uint64_t>(info.st_size) &&
+                 offset + sizeof(header) + header.url_length + header.content_type_length + header.body_length <=
+                     static_cast<uint64_t>(info.st_size);
+    if (valid) {
+        SegmentRecord out;
+        out.url.resize(header.url_length);
+        out.content_type.resize(header.content_type_length);
+        out.body.resize(header.body_length);
+        out.encoding = static_cast<ContentEncoding>(header.flags);
+        offset += sizeof(header);
+        if (pread_all(fd, out.url.data(), out.url.size(), offset) &&
+            pread_all(fd, out.content_type.data(), out.content_type.size(), offset + out.url.size()) &&
+            pread_all(fd, out.body.data(), out.body.size(), offset + out.url.size() + out.content_type.size())) {
+            record = std::move(out);
+        }
+    }
+    ::close(fd);
+    return record;
+}
+
+std::string read_saved_body(const std::string& location) {
+    if (is_segment_locator(location)) {
+        auto record = read_segment_record(location);
+        if (!record) {
+            return {};
+        }
+        if (record->encoding == ContentEncoding::identity) {
+            return std::move(record->body);
+        }
+        auto decoded = decode_body(record->encoding, record->body);
+        return decoded ? std::move(*decoded) : std::string();
+    }
+    std::ifstream in(location, std::ios::binary);
+    if (!in.is_open()) {
+        return {};
+    }
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+}  // namespace crawler
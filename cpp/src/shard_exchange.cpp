@@ -0,0 +1,176 @@
+#include "shard_exchange.hpp"
+
+#include "atomic_file.hpp"
+#include "hash.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <charconv>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace crawler {
+
+namespace fs = std::filesystem;
+
+int shard_of(const CanonicalUrl& url, int count) {
+    if (count <= 1) {
+        return 0;
+    }
+    uint64_t hash = mix64(hash_bytes(url.authority()) ^ hash_bytes(url.path()));
+    return static_cast<int>(hash % static_cast<uint64_t>(count));
+}
+
+ShardExchange::ShardExchange(fs::path dir, int count, int index)
+    : dir_(std::move(dir)),
+      count_(count),
+      index_(index),
+      outbox_(static_cast<size_t>(count)),
+      sent_(static_cast<size_t>(count), 0) {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    run_id_ = std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(now).count());
+    std::error_code ec;
+    fs::create_directories(inbox(index_), ec);
+    if (ec) {
+        std::cerr << "Failed to create shard inbox " << inbox(index_) << ": " << ec.message() << "\n";
+    }
+}
+
+fs::path ShardExchange::inbox(int shard) const {
+    return dir_ / ("inbox-" + std::to_string(shard));
+}
+
+void ShardExchange::forward(int shard, std::string_view url, int depth) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Batch& batch = outbox_[static_cast<size_t>(shard)];
+    batch.lines += std::to_string(depth);
+    batch.lines.push_back('\t');
+    batch.lines.append(url);
+    batch.lines.push_back('\n');
+    ++batch.urls;
+}
+
+void ShardExchange::flush() {
+    for (int shard = 0; shard < count_; ++shard) {
+        Batch batch;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::swap(batch, outbox_[static_cast<size_t>(shard)]);
+        }
+        if (batch.urls == 0) {
+            continue;
+        }
+        bool written = write_batch(shard, batch.lines);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (written) {
+            sent_[static_cast<size_t>(shard)] += batch.urls;
+        } else {
+            // Kept for the next flush.
+            Batch& pending = outbox_[static_cast<size_t>(shard)];
+            pending.lines.insert(0, batch.lines);
+            pending.urls += batch.urls;
+        }
+    }
+}
+
+bool ShardExchange::write_batch(int shard, const std::string& lines) {
+    uint64_t sequence;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sequence = next_batch_++;
+    }
+    fs::path dir = inbox(shard);
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    fs::path path = dir / ("from-" + std::to_string(index_) + "-" + run_id_ + "-" + std::to_string(sequence) + ".urls");
+    return write_file_atomically(path, [&lines](std::ofstream& out) {
+        out.write(lines.data(), static_cast<std::streamsize>(lines.size()));
+    });
+}
+
+size_t ShardExchange::receive(const std::function<void(std::string_view url, int depth)>& on_url) {
+    std::vector<fs::path> batches;
+    std::error_code ec;
+    for (fs::directory_iterator it(inbox(index_), ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->path().extension() == ".urls") {
+            batches.push_back(it->path());
+        }
+    }
+    std::sort(batches.begin(), batches.end());
+    size_t urls = 0;
+    for (const auto& path : batches) {
+        std::ifstream in(path, std::ios::binary);
+        std::string line;
+        while (std::getline(in, line)) {
+            size_t tab = line.find('\t');
+            int depth = 0;
+            if (tab == std::string::npos ||
+                std::from_chars(line.data(), line.data() + tab, depth).ptr != line.data() + tab) {
+                continue;
+            }
+            on_url(std::string_view(line).substr(tab + 1), depth);
+            ++urls;
+        }
+        in.close();
+        fs::remove(path, ec);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    received_ += urls;
+    return urls;
+}
+
+void ShardExchange::publish(bool idle, bool stopped) {
+    std::ostringstream state;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        state << (stopped ? "stopped" : idle ? "idle" : "busy") << ' ' << received_;
+        for (uint64_t sent : sent_) {
+            state << ' ' << sent;
+        }
+    }
+    state << '\n';
+    fs::path path = dir_ / ("state-" + std::to_string(index_));
+    write_file_atomically(path, [&state](std::ofstream& out) { out << state.str(); });
+}
+
+bool ShardExchange::finished() {
+    std::string view;
+    std::vector<uint64_t> owed(static_cast<size_t>(count_), 0);
+    std::vector<uint64_t> received(static_cast<size_t>(count_), 0);
+    std::vector<bool> live(static_cast<size_t>(count_), true);
+    bool all_quiet = true;
+    for (int shard = 0; shard < count_; ++shard) {
+        std::ifstream in(dir_ / ("state-" + std::to_string(shard)));
+        std::string line;
+        if (!std::getline(in, line)) {
+            return false;
+        }
+        view += line;
+        view.push_back('\n');
+        std::istringstream fields(line);
+        std::string status;
+        fields >> status >> received[static_cast<size_t>(shard)];
+        for (int target = 0; target < count_; ++target) {
+            uint64_t sent = 0;
+            fields >> sent;
+            owed[static_cast<size_t>(target)] += sent;
+        }
+        if (!fields) {
+            return false;
+        }
+        live[static_cast<size_t>(shard)] = status != "stopped";
+        all_quiet = all_quiet && status != "busy";
+    }
+    bool balanced = true;
+    for (int shard = 0; shard < count_; ++shard) {
+        if (live[static_cast<size_t>(shard)] && received[static_cast<size_t>(shard)] != owed[static_cast<size_t>(shard)]) {
+            balanced = false;
+        }
+    }
+    bool stable = view == last_view_;
+    last_view_ = std::move(view);
+    return all_quiet && balanced && stable;
+}
+
+}  // namespace crawler
@@ -0,0 +1,159 @@
+#include "sitemap.hpp"
+
+#include "string_util.hpp"
+
+#include <chrono>
+
+namespace crawler {
+
+namespace {
+
+// Finds `<tag` as a whole element name (so "url" does not match "urlset").
+size_t find_open_tag(std::string_view xml, std::string_view tag, size_t from) {
+    while ((from = xml.find(tag, from)) != std::string_view::npos) {
+        size_t after = from + tag.size();
+        if (from > 0 && xml[from - 1] == '<' && after < xml.size() &&
+            (xml[after] == '>' || xml[after] == ' ' || xml[after] == '\t' || xml[after] == '\n' || xml[after] == '\r')) {
+            return from - 1;
+        }
+        from = after;
+    }
+    return std::string_view::npos;
+}
+
+// Text of the first <tag>...</tag> inside `block`, with CDATA unwrapped and
+// the predefined entities decoded.
+std::optional<std::string> element_text(std::string_view block, std::string_view tag) {
+    size_t open = find_open_tag(block, tag, 0);
+    if (open == std::string_view::npos) {
+        return std::nullopt;
+    }
+    size_t start = block.find('>', open);
+    std::string close = "</" + std::string(tag) + ">";
+    size_t end = start == std::string_view::npos ? start : block.find(close, start);
+    if (end == std::string_view::npos) {
+        return std::nullopt;
+    }
+    std::string_view raw = trim_view(block.substr(start + 1, end - start - 1));
+    if (raw.substr(0, 9) == "<![CDATA[" && raw.size() >= 12 && raw.substr(raw.size() - 3) == "]]>") {
+        return std::string(trim_view(raw.substr(9, raw.size() - 12)));
+    }
+    static constexpr std::pair<std::string_view, char> kEntities[] = {
+        {"&amp;", '&'}, {"&lt;", '<'}, {"&gt;", '>'}, {"&quot;", '"'}, {"&apos;", '\''}};
+    std::string text;
+    for (size_t i = 0; i < raw.size(); ++i) {
+        bool decoded = false;
+        if (raw[i] == '&') {
+            for (const auto& [entity, c] : kEntities) {
+                if (raw.substr(i, entity.size()) == entity) {
+                    text.push_back(c);
+                    i += entity.size() - 1;
+                    decoded = true;
+                    break;
+                }
+            }
+        }
+        if (!decoded) {
+            text.push_back(raw[i]);
+        }
+    }
+    return text;
+}
+
+bool read_digits(std::string_view value, size_t& pos, size_t count, int& out) {
+    if (pos + count > value.size()) {
+        return false;
+    }
+    out = 0;
+    for (size_t i = 0; i < count; ++i) {
+        char c = value[pos + i];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        out = out * 10 + (c - '0');
+    }
+    pos += count;
+    return true;
+}
+
+}  // namespace
+
+std::optional<int64_t> parse_w3c_datetime(std::string_view value) {
+    value = trim_view(value);
+    size_t pos = 0;
+    int year = 0;
+    int month = 1;
+    int day = 1;
+    int hour = 0;
+    int minute = 0;
+    int second = 0;
+    if (!read_digits(value, pos, 4, year)) {
+        return std::nullopt;
+    }
+    if (pos < value.size() && value[pos] == '-' && !read_digits(value, ++pos, 2, month)) {
+        return std::nullopt;
+    }
+    if (pos < value.size() && value[pos] == '-' && !read_digits(value, ++pos, 2, day)) {
+        return std::nullopt;
+    }
+    int64_t offset_seconds = 0;
+    if (pos < value.size() && value[pos] == 'T') {
+        ++pos;
+        if (!read_digits(value, pos, 2, hour) || pos >= value.size() || value[pos] != ':' ||
+            !read_digits(value, ++pos, 2, minute)) {
+            return std::nullopt;
+        }
+        if (pos < value.size() && value[pos] == ':' && !read_digits(value, ++pos, 2, second)) {
+            return std::nullopt;
+        }
+        if (pos < value.size() && value[pos] == '.') {
+            do {
+                ++pos;
+            } while (pos < value.size() && value[pos] >= '0' && value[pos] <= '9');
+        }
+        if (pos < value.size() && value[pos] == 'Z') {
+            ++pos;
+        } else if (pos < value.size() && (value[pos] == '+' || value[pos] == '-')) {
+            int sign = value[pos] == '-' ? -1 : 1;
+            int offset_hours = 0;
+            int offset_minutes = 0;
+            if (!read_digits(value, ++pos, 2, offset_hours) || pos >= value.size() || value[pos] != ':' ||
+                !read_digits(value, ++pos, 2, offset_minutes)) {
+                return std::nullopt;
+            }
+            offset_seconds = sign * (offset_hours * 3600 + offset_minutes * 60);
+        }
+    }
+    if (pos != value.size() || month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+        return std::nullopt;
+    }
+    using namespace std::chrono;
+    sys_days date = year_month_day {std::chrono::year(year), std::chrono::month(static_cast<unsigned>(month)),
+                                    std::chrono::day(static_cast<unsigned>(day))};
+    return static_cast<int64_t>(date.time_since_epoch() / seconds(1)) + hour * 3600 + minute * 60 + second - offset_seconds;
+}
+
+Sitemap parse_sitemap(std::string_view xml) {
+    Sitemap sitemap;
+    sitemap.is_index = find_open_tag(xml, "sitemapindex", 0) != std::string_view::npos;
+    std::string_view tag = sitemap.is_index ? "sitemap" : "url";
+    std::string close = "</" + std::string(tag) + ">";
+    size_t pos = 0;
+    while ((pos = find_open_tag(xml, tag, pos)) != std::string_view::npos) {
+        size_t end = xml.find(close, pos);
+        std::string_view block = xml.substr(pos, end == std::string_view::npos ? std::string_view::npos : end - pos);
+        pos = end == std::string_view::npos ? xml.size() : end + close.size();
+        auto loc = element_text(block, "loc");
+        if (!loc || loc->empty()) {
+            continue;
+        }
+        SitemapEntry entry {std::move(*loc), std::nullopt};
+        if (auto lastmod = element_text(block, "lastmod")) {
+            entry.lastmod = parse_w3c_datetime(*lastmod);
+        }
+        sitemap.entries.push_back(std::move(entry));
+    }
+    return sitemap;
+}
+
+}  // namespace crawler
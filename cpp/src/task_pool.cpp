@@ -0,0 +1,70 @@
+#include "task_pool.hpp"
+
+#include <algorithm>
+
+namespace crawler {
+
+BoundedTaskPool::BoundedTaskPool(int threads, size_t capacity) : capacity_(std::max<size_t>(1, capacity)) {
+    int count = std::max(1, threads);
+    threads_.reserve(static_cast<size_t>(count));
+    for (int i = 0; i < count; ++i) {
+        threads_.emplace_back([this] { run(); });
+    }
+}
+
+BoundedTaskPool::~BoundedTaskPool() {
+    close();
+}
+
+bool BoundedTaskPool::submit(std::function<void()> task) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    bool waited = tasks_.size() >= capacity_;
+    not_full_.wait(lock, [this] { return tasks_.size() < capacity_ || closed_; });
+    if (closed_) {
+        // Too late to queue; run it here rather than drop it.
+        lock.unlock();
+        task();
+        return waited;
+    }
+    tasks_.push_back(std::move(task));
+    lock.unlock();
+    not_empty_.notify_one();
+    return waited;
+}
+
+size_t BoundedTaskPool::queued() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return tasks_.size();
+}
+
+void BoundedTaskPool::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+}
+
+void BoundedTaskPool::run() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_empty_.wait(lock, [this] { return !tasks_.empty() || closed_; });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        not_full_.notify_one();
+        task();
+    }
+}
+
+}  // namespace crawler
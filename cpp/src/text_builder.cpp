@@ -0,0 +1,47 @@
+#include "text_builder.hpp"
+
+#include "string_util.hpp"
+
+namespace crawler {
+
+size_t space_length(std::string_view text, size_t i) {
+    auto byte = [&](size_t at) { return at < text.size() ? static_cast<unsigned char>(text[at]) : 0u; };
+    if (is_space(text[i])) {
+        return 1;
+    }
+    unsigned b0 = byte(i);
+    if (b0 == 0xC2 && (byte(i + 1) == 0xA0 || byte(i + 1) == 0x85)) {
+        return 2;
+    }
+    if (b0 == 0xE2 && byte(i + 1) == 0x80) {
+        unsigned b2 = byte(i + 2);
+        if ((b2 >= 0x80 && b2 <= 0x8A) || b2 == 0xA8 || b2 == 0xA9 || b2 == 0xAF) {
+            return 3;
+        }
+    }
+    if (b0 == 0xE3 && byte(i + 1) == 0x80 && byte(i + 2) == 0x80) {
+        return 3;
+    }
+    return 0;
+}
+
+void TextBuilder::add(std::string_view text) {
+    size_t i = 0;
+    while (i < text.size()) {
+        if (size_t n = space_length(text, i)) {
+            pending_space = true;
+            i += n;
+            continue;
+        }
+        if (out.empty() || pending_space) {
+            if (!out.empty()) {
+                out.push_back(' ');
+            }
+            ++words;
+            pending_space = false;
+        }
+        out.push_back(text[i++]);
+    }
+}
+
+}  // namespace crawler
@@ -0,0 +1,431 @@
+#include "url.hpp"
+
+#include "string_util.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+namespace crawler {
+
+namespace {
+
+constexpr char kHex[] = "0123456789ABCDEF";
+
+inline bool is_unreserved(unsigned char c) {
+    return is_alpha(static_cast<char>(c)) || is_digit(static_cast<char>(c)) || c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+// Bytes that may not appear raw in a URL and get percent-encoded.
+inline bool needs_escape(unsigned char c) {
+    if (c <= 0x20 || c >= 0x7F) {
+        return true;
+    }
+    switch (c) {
+        case '"':
+        case '<':
+        case '>':
+        case '\\':
+        case '^':
+        case '`':
+        case '{':
+        case '|':
+        case '}':
+            return true;
+        default:
+            return false;
+    }
+}
+
+void append_escaped(std::string& out, unsigned char c) {
+    out.push_back('%');
+    out.push_back(kHex[c >> 4]);
+    out.push_back(kHex[c & 0x0F]);
+}
+
+// Canonical percent-encoding: escapes are upper-cased, escaped unreserved
+// characters are decoded and disallowed bytes are escaped.
+void append_normalized(std::string& out, std::string_view in) {
+    for (size_t i = 0; i < in.size(); ++i) {
+        auto c = static_cast<unsigned char>(in[i]);
+        if (c == '%') {
+            bool complete = i + 2 < in.size();
+            int hi = complete ? hex_value(in[i + 1]) : -1;
+            int lo = complete ? hex_value(in[i + 2]) : -1;
+            if (hi >= 0 && lo >= 0) {
+                auto decoded = static_cast<unsigned char>(hi * 16 + lo);
+                if (is_unreserved(decoded)) {
+                    out.push_back(static_cast<char>(decoded));
+                } else {
+                    append_escaped(out, decoded);
+                }
+                i += 2;
+            } else {
+                out += "%25";
+            }
+        } else if (needs_escape(c)) {
+            append_escaped(out, c);
+        } else {
+            out.push_back(static_cast<char>(c));
+        }
+    }
+}
+
+// RFC 3986 section 5.2.4, in place on out[begin, end): the output never
+// runs ahead of the input, so segments are moved down over consumed bytes.
+void remove_dot_segments(std::string& out, size_t begin) {
+    std::string_view path = std::string_view(out).substr(begin);
+    size_t write = begin;
+    auto pop_segment = [&] {
+        while (write > begin && out[write - 1] != '/') {
+            --write;
+        }
+        if (write > begin) {
+            --write;
+        }
+    };
+    size_t i = 0;
+    while (i < path.size()) {
+        std::string_view rest = path.substr(i);
+        if (rest.substr(0, 3) == "../") {
+            i += 3;
+        } else if (rest.substr(0, 2) == "./") {
+            i += 2;
+        } else if (rest.substr(0, 3) == "/./") {
+            i += 2;
+        } else if (rest == "/.") {
+            out[write++] = '/';
+            break;
+        } else if (rest.substr(0, 4) == "/../") {
+            i += 3;
+            pop_segment();
+        } else if (rest == "/..") {
+            pop_segment();
+            out[write++] = '/';
+            break;
+        } else if (rest == "." || rest == "..") {
+            break;
+        } else {
+            size_t end = path.find('/', i + 1);
+            if (end == std::string_view::npos) {
+                end = path.size();
+            }
+            if (write != begin + i) {
+                std::memmove(out.data() + write, out.data() + begin + i, end - i);
+            }
+            write += end - i;
+            i = end;
+        }
+    }
+    out.resize(write);
+}
+
+bool stripped_param(std::string_view param, const NormalizeOptions& options) {
+    std::string_view name = param.substr(0, param.find('='));
+    for (const auto& strip : options.strip_query_params) {
+        bool prefix = !strip.empty() && strip.back() == '*';
+        size_t length = strip.size() - (prefix ? 1 : 0);
+        if ((prefix ? name.size() >= length : name.size() == length) &&
+            starts_with_icase(name, std::string_view(strip).substr(0, length))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void append_query(std::string& out, std::string_view query, const NormalizeOptions& options) {
+    size_t begin = out.size();
+    append_normalized(out, query);
+    if (!options.sort_query && options.strip_query_params.empty()) {
+        return;
+    }
+    // Filtering and sorting rewrite the bytes in place, so they work from a copy.
+    std::string normalized = out.substr(begin);
+    out.resize(begin);
+    std::vector<std::string_view> params;
+    std::string_view rest = normalized;
+    while (!rest.empty()) {
+        size_t amp = rest.find('&');
+        std::string_view param = rest.substr(0, amp);
+        if (!param.empty() && !stripped_param(param, options)) {
+            params.push_back(param);
+        }
+        rest = amp == std::string_view::npos ? std::string_view {} : rest.substr(amp + 1);
+    }
+    if (options.sort_query) {
+        std::stable_sort(params.begin(), params.end(), [](std::string_view a, std::string_view b) {
+            return a.substr(0, a.find('=')) < b.substr(0, b.find('='));
+        });
+    }
+    for (size_t i = 0; i < params.size(); ++i) {
+        if (i > 0) {
+            out.push_back('&');
+        }
+        out += params[i];
+    }
+}
+
+// Appends host[:port] in canonical form; false if the authority is unusable.
+bool append_authority(std::string& out, std::string_view scheme, std::string_view host, std::string_view port) {
+    while (!host.empty() && host.back() == '.') {
+        host.remove_suffix(1);
+    }
+    if (host.empty()) {
+        return false;
+    }
+    for (char c : host) {
+        out.push_back(ascii_lower(c));
+    }
+    while (port.size() > 1 && port.front() == '0') {
+        port.remove_prefix(1);
+    }
+    if (port.empty()) {
+        return true;
+    }
+    // Leading zeros are gone, so more than five digits is out of range;
+    // checking first also keeps the sum from overflowing.
+    if (port.size() > 5) {
+        return false;
+    }
+    int number = 0;
+    for (char c : port) {
+        number = number * 10 + (c - '0');
+    }
+    if (number > 65535) {
+        return false;
+    }
+    bool default_port = (scheme == "http" && port == "80") || (scheme == "https" && port == "443");
+    if (!default_port) {
+        out.push_back(':');
+        out += port;
+    }
+    return true;
+}
+
+}  // namespace
+
+std::optional<UrlView> parse_url(std::string_view reference) {
+    UrlView view;
+    std::string_view rest = reference;
+
+    size_t hash = rest.find('#');
+    if (hash != std::string_view::npos) {
+        view.fragment = rest.substr(hash + 1);
+        view.has_fragment = true;
+        rest = rest.substr(0, hash);
+    }
+    size_t question = rest.find('?');
+    if (question != std::string_view::npos) {
+        view.query = rest.substr(question + 1);
+        view.has_query = true;
+        rest = rest.substr(0, question);
+    }
+
+    size_t colon = rest.find_first_of(":/");
+    if (colon != std::string_view::npos && colon > 0 && rest[colon] == ':' && is_alpha(rest[0])) {
+        std::string_view scheme = rest.substr(0, colon);
+        bool valid = std::all_of(scheme.begin(), scheme.end(), [](char c) {
+            return is_alpha(c) || is_digit(c) || c == '+' || c == '-' || c == '.';
+        });
+        if (valid) {
+            view.scheme = scheme;
+            view.has_scheme = true;
+            rest = rest.substr(colon + 1);
+        }
+    }
+
+    if (rest.substr(0, 2) == "//") {
+        rest = rest.substr(2);
+        size_t slash = rest.find('/');
+        std::string_view authority = rest.substr(0, slash);
+        rest = slash == std::string_view::npos ? std::string_view {} : rest.substr(slash);
+        view.has_authority = true;
+
+        size_t at = authority.rfind('@');
+        if (at != std::string_view::npos) {
+            authority = authority.substr(at + 1);
+        }
+        size_t port_colon = std::string_view::npos;
+        if (!authority.empty() && authority.front() == '[') {
+            size_t close = authority.find(']');
+            if (close == std::string_view::npos) {
+                return std::nullopt;
+            }
+            if (close + 1 < authority.size()) {
+                if (authority[close + 1] != ':') {
+                    return std::nullopt;
+                }
+                port_colon = close + 1;
+            }
+        } else {
+            port_colon = authority.rfind(':');
+        }
+        if (port_colon != std::string_view::npos) {
+            view.port = authority.substr(port_colon + 1);
+            authority = authority.substr(0, port_colon);
+            if (!std::all_of(view.port.begin(), view.port.end(), is_digit)) {
+                return std::nullopt;
+            }
+        }
+        view.host = authority;
+    }
+    view.path = rest;
+    return view;
+}
+
+std::string_view CanonicalUrl::query() const {
+    if (path_end_ >= text_.size()) {
+        return {};
+    }
+    return std::string_view(text_).substr(path_end_ + 1);
+}
+
+std::optional<CanonicalUrl> resolve_url(const CanonicalUrl* base, std::string_view reference, const NormalizeOptions& options) {
+    CanonicalUrl result;
+    if (!resolve_url_into(result, base, reference, options)) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+bool resolve_url_into(CanonicalUrl& result, const CanonicalUrl* base, std::string_view reference,
+                      const NormalizeOptions& options) {
+    auto ref = parse_url(trim_view(reference));
+    if (!ref) {
+        return false;
+    }
+
+    std::string& out = result.text_;
+    out.clear();
+    out.reserve(reference.size() + (base ? base->text_.size() : 0));
+
+    std::string_view query;
+    bool has_query = ref->has_query;
+    query = ref->query;
+
+    if (ref->has_scheme) {
+        for (char c : ref->scheme) {
+            out.push_back(ascii_lower(c));
+        }
+        if ((out != "http" && out != "https") || !ref->has_authority) {
+            return false;
+        }
+    } else if (base) {
+        out += base->scheme();
+    } else {
+        return false;
+    }
+    result.scheme_end_ = static_cast<uint32_t>(out.size());
+    out += "://";
+    result.authority_begin_ = static_cast<uint32_t>(out.size());
+
+    // The merged path is built right after the authority and then has its
+    // dot segments removed in place.
+    size_t path_begin = 0;
+    if (ref->has_authority) {
+        if (!append_authority(out, result.scheme(), ref->host, ref->port)) {
+            return false;
+        }
+        path_begin = out.size();
+        append_normalized(out, ref->path);
+    } else {
+        out += base->authority();
+        path_begin = out.size();
+        if (ref->path.empty()) {
+            out += base->path();
+            if (!has_query) {
+                query = base->query();
+                has_query = !query.empty();
+            }
+        } else if (ref->path.front() == '/') {
+            append_normalized(out, ref->path);
+        } else {
+            std::string_view base_path = base->path();
+            out += base_path.substr(0, base_path.rfind('/') + 1);
+            append_normalized(out, ref->path);
+        }
+    }
+    result.path_begin_ = static_cast<uint32_t>(path_begin);
+    if (out.size() == path_begin || out[path_begin] != '/') {
+        out.insert(out.begin() + static_cast<std::ptrdiff_t>(path_begin), '/');
+    }
+    remove_dot_segments(out, path_begin);
+    if (out.size() == path_begin) {
+        out.push_back('/');
+    }
+    result.path_end_ = static_cast<uint32_t>(out.size());
+
+    if (has_query) {
+        out.push_back('?');
+        append_query(out, query, options);
+        if (out.size() == result.path_end_ + 1) {
+            out.pop_back();
+        }
+    }
+    return true;
+}
+
+std::string extension_from_url(const CanonicalUrl& url) {
+    std::string_view path = url.path();
+    std::string_view filename = path.substr(path.rfind('/') + 1);
+    auto dot = filename.rfind('.');
+    if (dot == std::string_view::npos) {
+        return {};
+    }
+    std::string ext;
+    ext.reserve(filename.size() - dot);
+    for (char c : filename.substr(dot)) {
+        ext.push_back(ascii_lower(c));
+    }
+    return ext;
+}
+
+bool query_indicates_download(const CanonicalUrl& url) {
+    std::string_view query = url.query();
+    for (std::string_view marker : {"format=pdf", "format=doc", "download=1"}) {
+        for (size_t i = 0; i + marker.size() <= query.size(); ++i) {
+            if (starts_with_icase(query.substr(i), marker)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+std::string sanitize_filename(const CanonicalUrl& url, const std::string& extension, const std::string& prefix) {
+    std::string path(url.path());
+    if (!url.query().empty()) {
+        path.push_back('?');
+        path += url.query();
+    }
+    if (path.empty() || path == "/") {
+        path = "/index";
+    }
+    std::string raw = prefix + "__";
+    raw += url.authority();
+    raw += path;
+    std::replace(raw.begin(), raw.end(), '/', '_');
+    if (!extension.empty() && raw.find(extension) == std::string::npos) {
+        raw += extension;
+    }
+    std::string file_name;
+    file_name.reserve(raw.size());
+    bool in_run = false;
+    for (char c : raw) {
+        bool valid = is_alpha(c) || is_digit(c) || c == '.' || c == '_' || c == '-';
+        if (valid) {
+            file_name.push_back(c);
+            in_run = false;
+        } else if (!in_run) {
+            file_name.push_back('_');
+            in_run = true;
+        }
+    }
+    if (file_name.size() > 240) {
+        file_name.resize(240);
+    }
+    return file_name;
+}
+
+}  // namespace crawler
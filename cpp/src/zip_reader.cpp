@@ -0,0 +1,132 @@
+#include "zip_reader.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+
+namespace crawler {
+
+namespace {
+
+constexpr uint32_t kEndOfCentralDirectory = 0x06054b50;
+constexpr uint32_t kCentralDirectoryHeader = 0x02014b50;
+constexpr uint32_t kLocalFileHeader = 0x04034b50;
+constexpr size_t kEndRecordSize = 22;
+constexpr size_t kCentralHeaderSize = 46;
+constexpr size_t kLocalHeaderSize = 30;
+constexpr uint16_t kStored = 0;
+constexpr uint16_t kDeflated = 8;
+constexpr uint16_t kEncrypted = 1;
+
+// ZIP fields are little-endian whatever the host is.
+uint16_t read16(std::string_view data, size_t at) {
+    return static_cast<uint16_t>(static_cast<unsigned char>(data[at]) | static_cast<unsigned char>(data[at + 1]) << 8);
+}
+
+uint32_t read32(std::string_view data, size_t at) {
+    return static_cast<uint32_t>(read16(data, at)) | static_cast<uint32_t>(read16(data, at + 2)) << 16;
+}
+
+}  // namespace
+
+std::optional<ZipArchive> ZipArchive::open(std::string_view data) {
+    if (data.size() < kEndRecordSize) {
+        return std::nullopt;
+    }
+    // The end record sits behind a comment of up to 64 KiB.
+    size_t lowest = data.size() > kEndRecordSize + 0xffff ? data.size() - kEndRecordSize - 0xffff : 0;
+    size_t end = std::string_view::npos;
+    for (size_t at = data.size() - kEndRecordSize + 1; at-- > lowest;) {
+        if (read32(data, at) == kEndOfCentralDirectory) {
+            end = at;
+            break;
+        }
+    }
+    if (end == std::string_view::npos) {
+        return std::nullopt;
+    }
+    uint16_t count = read16(data, end + 10);
+    uint32_t directory_size = read32(data, end + 12);
+    uint32_t directory_offset = read32(data, end + 16);
+    if (static_cast<uint64_t>(directory_offset) + directory_size > end) {
+        return std::nullopt;
+    }
+    ZipArchive archive(data);
+    archive.entries_.reserve(count);
+    size_t at = directory_offset;
+    for (uint16_t i = 0; i < count; ++i) {
+        if (at + kCentralHeaderSize > end || read32(data, at) != kCentralDirectoryHeader) {
+            return std::nullopt;
+        }
+        uint16_t name_length = read16(data, at + 28);
+        uint16_t extra_length = read16(data, at + 30);
+        uint16_t comment_length = read16(data, at + 32);
+        if (at + kCentralHeaderSize + name_length > end) {
+            return std::nullopt;
+        }
+        Entry entry;
+        entry.flags = read16(data, at + 8);
+        entry.method = read16(data, at + 10);
+        entry.compressed_size = read32(data, at + 20);
+        entry.size = read32(data, at + 24);
+        entry.local_header_offset = read32(data, at + 42);
+        entry.name.assign(data.substr(at + kCentralHeaderSize, name_length));
+        archive.entries_.push_back(std::move(entry));
+        at += kCentralHeaderSize + name_length + extra_length + comment_length;
+    }
+    return archive;
+}
+
+const ZipArchive::Entry* ZipArchive::find(std::string_view name) const {
+    for (const auto& entry : entries_) {
+        if (entry.name == name) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+std::optional<std::string> ZipArchive::read(const Entry& entry, uint64_t max_bytes) const {
+    if ((entry.flags & kEncrypted) || entry.size > max_bytes) {
+        return std::nullopt;
+    }
+    size_t header = entry.local_header_offset;
+    if (header + kLocalHeaderSize > data_.size() || read32(data_, header) != kLocalFileHeader) {
+        return std::nullopt;
+    }
+    // The local header's own name and extra lengths, which may differ from
+    // the central directory's; sizes come from the central directory, since
+    // streamed entries leave them zero here.
+    size_t start = header + kLocalHeaderSize + read16(data_, header + 26) + read16(data_, header + 28);
+    if (start > data_.size() || data_.size() - start < entry.compressed_size) {
+        return std::nullopt;
+    }
+    std::string_view packed = data_.substr(start, entry.compressed_size);
+    if (entry.method == kStored) {
+        if (entry.compressed_size != entry.size) {
+            return std::nullopt;
+        }
+        return std::string(packed);
+    }
+    if (entry.method != kDeflated) {
+        return std::nullopt;
+    }
+    std::string out(entry.size, '\0');
+    z_stream stream {};
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+        return std::nullopt;
+    }
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(packed.data()));
+    stream.avail_in = static_cast<uInt>(packed.size());
+    stream.next_out = reinterpret_cast<Bytef*>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    int rc = inflate(&stream, Z_FINISH);
+    bool complete = rc == Z_STREAM_END && stream.total_out == entry.size;
+    inflateEnd(&stream);
+    if (!complete) {
+        return std::nullopt;
+    }
+    return out;
+}
+
+}  // namespace crawler
@@ -0,0 +1,317 @@
+#include "atomic_file.hpp"
+#include "embedding_client.hpp"
+#include "embedding_store.hpp"
+#include "hash.hpp"
+#include "json.hpp"
+#include "string_util.hpp"
+
+#include <curl/curl.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using crawler::JsonValue;
+
+struct Options {
+    fs::path nodes = fs::path("data") / "processed" / "nodes.json";
+    fs::path index = fs::path("data") / "processed" / "faiss.index";
+    fs::path mapping = fs::path("data") / "processed" / "node_mapping.json";
+    fs::path store = fs::path("data") / "processed" / "embeddings.bin";
+    size_t chunk_words = 200;
+    size_t overlap_words = 40;
+    crawler::EmbeddingClientOptions client;
+};
+
+// One index row: a chunk of a node's text.
+struct Chunk {
+    const JsonValue* node = nullptr;
+    size_t number = 0;
+    std::string_view text;
+    uint64_t key = 0;
+};
+
+long elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return static_cast<long>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - since).count());
+}
+
+std::string_view string_member(const JsonValue& node, std::string_view key) {
+    const JsonValue* value = node.find(key);
+    return value && value->is_string() ? std::string_view(value->as_string()) : std::string_view();
+}
+
+void append_json_value(std::string& out, const JsonValue& value) {
+    switch (value.type()) {
+        case JsonValue::Type::null:
+            out += "null";
+            break;
+        case JsonValue::Type::boolean:
+            out += value.as_bool() ? "true" : "false";
+            break;
+        case JsonValue::Type::number: {
+            char buffer[32];
+            int length = std::snprintf(buffer, sizeof(buffer), "%.10g", value.as_number());
+            out.append(buffer, static_cast<size_t>(length));
+            break;
+        }
+        case JsonValue::Type::string:
+            crawler::append_json_string(out, value.as_string());
+            break;
+        case JsonValue::Type::array:
+            out += '[';
+            for (size_t i = 0; i < value.items().size(); ++i) {
+                out += i == 0 ? "" : ", ";
+                append_json_value(out, value.items()[i]);
+            }
+            out += ']';
+            break;
+        case JsonValue::Type::object:
+            out += '{';
+            for (size_t i = 0; i < value.members().size(); ++i) {
+                out += i == 0 ? "" : ", ";
+                crawler::append_json_string(out, value.members()[i].first);
+                out += ": ";
+                append_json_value(out, value.members()[i].second);
+            }
+            out += '}';
+            break;
+    }
+}
+
+// The text sent for a chunk: the page title, then the chunk, so every
+// chunk of a page carries what the page is about.
+std::string chunk_input(const Chunk& chunk) {
+    std::string_view title = string_member(*chunk.node, "title");
+    if (title.empty()) {
+        return std::string(chunk.text);
+    }
+    std::string input(title);
+    input += "\n\n";
+    input += chunk.text;
+    return input;
+}
+
+// Same row order as the index; embed_nodes.py --vectors reads it back.
+bool write_mapping(const fs::path& path, const std::vector<Chunk>& rows) {
+    return crawler::write_file_atomically(path, [&](std::ofstream& out) {
+        std::string buffer = "[";
+        char key[17];
+        for (size_t row = 0; row < rows.size(); ++row) {
+            const Chunk& chunk = rows[row];
+            buffer += row == 0 ? "\n  {\"row_id\": " : ",\n  {\"row_id\": ";
+            buffer += std::to_string(row);
+            buffer += ", \"url\": ";
+            crawler::append_json_string(buffer, string_member(*chunk.node, "url"));
+            buffer += ", \"chunk\": " + std::to_string(chunk.number);
+            std::snprintf(key, sizeof(key), "%016llx", static_cast<unsigned long long>(chunk.key));
+            buffer += ", \"key\": \"" + std::string(key) + "\", \"title\": ";
+            const JsonValue* title = chunk.node->find("title");
+            append_json_value(buffer, title ? *title : JsonValue());
+            buffer += ", \"snippet\": ";
+            crawler::append_json_string(buffer, string_member(*chunk.node, "snippet"));
+            buffer += ", \"metrics\": ";
+            const JsonValue* metrics = chunk.node->find("metrics");
+            append_json_value(buffer, metrics ? *metrics : JsonValue::object());
+            buffer += ", \"text\": ";
+            crawler::append_json_string(buffer, chunk.text);
+            buffer += '}';
+            if (buffer.size() > (1 << 16)) {
+                out << buffer;
+                buffer.clear();
+            }
+        }
+        buffer += "\n]\n";
+        out << buffer;
+    });
+}
+
+int run(const Options& options) {
+    auto started = std::chrono::steady_clock::now();
+    std::ifstream in(options.nodes, std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open " << options.nodes << "; run build_graph.py first\n";
+        return 1;
+    }
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::string error;
+    auto nodes = JsonValue::parse(text, &error);
+    if (!nodes || !nodes->is_array()) {
+        std::cerr << options.nodes << " is not a JSON array of nodes" << (error.empty() ? "" : ": " + error) << "\n";
+        return 1;
+    }
+
+    // Pages flagged as copies of another, and nodes without text (link-map
+    // and external nodes), add nothing worth retrieving.
+    std::vector<Chunk> chunks;
+    size_t embedded_nodes = 0;
+    for (const JsonValue& node : nodes->items()) {
+        if (!node.is_object() || string_member(node, "url").empty() || !string_member(node, "duplicate_of").empty()) {
+            continue;
+        }
+        auto parts = crawler::chunk_words(string_member(node, "clean_text"), options.chunk_words, options.overlap_words);
+        embedded_nodes += parts.empty() ? 0 : 1;
+        for (size_t i = 0; i < parts.size(); ++i) {
+            chunks.push_back({&node, i, parts[i], 0});
+        }
+    }
+
+    // Shortened vectors of a model are not interchangeable with full ones.
+    std::string store_model = options.client.model;
+    if (options.client.dimensions > 0) {
+        store_model += "@" + std::to_string(options.client.dimensions);
+    }
+    auto store = crawler::EmbeddingStore::load(options.store, store_model);
+    if (!store) {
+        return 1;
+    }
+    // A chunk repeated verbatim on several pages is embedded and indexed once.
+    std::vector<Chunk> rows;
+    std::vector<uint64_t> keys;
+    std::vector<std::string> inputs;
+    std::vector<uint64_t> input_keys;
+    std::unordered_set<uint64_t> seen;
+    for (auto& chunk : chunks) {
+        std::string input = chunk_input(chunk);
+        chunk.key = crawler::hash_bytes(input);
+        if (!seen.insert(chunk.key).second) {
+            continue;
+        }
+        rows.push_back(chunk);
+        keys.push_back(chunk.key);
+        if (!store->find(chunk.key)) {
+            inputs.push_back(std::move(input));
+            input_keys.push_back(chunk.key);
+        }
+    }
+    std::cout << "Loaded " << embedded_nodes << " nodes with text as " << rows.size() << " distinct chunks: "
+              << rows.size() - inputs.size() << " already embedded, " << inputs.size() << " to embed\n";
+    if (rows.empty()) {
+        std::cerr << "No nodes to embed\n";
+        return 1;
+    }
+
+    size_t failed = 0;
+    if (!inputs.empty()) {
+        if (options.client.api_key.empty() && options.client.endpoint.starts_with("https://api.openai.com/")) {
+            std::cerr << "OPENAI_API_KEY is not set\n";
+            return 1;
+        }
+        auto phase = std::chrono::steady_clock::now();
+        size_t mismatched = 0;
+        crawler::EmbeddingClient client(options.client);
+        auto stats = client.embed(inputs, [&](size_t input, const float* vector, size_t dimensions) {
+            if (!store->add(input_keys[input], vector, dimensions)) {
+                ++mismatched;
+            }
+        });
+        failed = stats.failed_inputs + mismatched;
+        std::cout << "Embedded " << inputs.size() - failed << " chunks with " << options.client.model << " in "
+                  << stats.requests << " requests (" << stats.retries << " retried) in " << elapsed_ms(phase) << " ms\n";
+        if (mismatched > 0) {
+            std::cerr << mismatched << " vectors did not have " << store->dimensions() << " dimensions; dropped\n";
+        }
+    }
+    // Saved even when some chunks failed, so a rerun does not pay for the
+    // rest again; vectors of pages that changed or went away are dropped.
+    if (options.store.has_parent_path()) {
+        fs::create_directories(options.store.parent_path());
+    }
+    if (!store->save(options.store, keys)) {
+        return 1;
+    }
+    if (failed > 0) {
+        std::cerr << failed << " chunks were not embedded; " << options.index << " was left as it was. Rerun to retry them.\n";
+        return 1;
+    }
+
+    std::vector<const float*> vectors;
+    vectors.reserve(rows.size());
+    for (const auto& chunk : rows) {
+        vectors.push_back(store->find(chunk.key));
+    }
+    for (const fs::path& path : {options.index, options.mapping}) {
+        if (path.has_parent_path()) {
+            fs::create_directories(path.parent_path());
+        }
+    }
+    if (!crawler::write_faiss_flat_index(options.index, store->dimensions(), vectors) ||
+        !write_mapping(options.mapping, rows)) {
+        return 1;
+    }
+    std::cout << "Wrote " << rows.size() << " vectors of " << store->dimensions() << " dimensions to " << options.index
+              << " in " << elapsed_ms(started) << " ms total\n";
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (const char* key = std::getenv("OPENAI_API_KEY")) {
+        options.client.api_key = key;
+    }
+    if (const char* base = std::getenv("OPENAI_BASE_URL"); base && *base) {
+        std::string endpoint = base;
+        while (!endpoint.empty() && endpoint.back() == '/') {
+            endpoint.pop_back();
+        }
+        options.client.endpoint = endpoint + "/embeddings";
+    }
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--nodes" && has_value) {
+            options.nodes = argv[++i];
+        } else if (arg == "--index" && has_value) {
+            options.index = argv[++i];
+        } else if (arg == "--mapping" && has_value) {
+            options.mapping = argv[++i];
+        } else if (arg == "--store" && has_value) {
+            options.store = argv[++i];
+        } else if (arg == "--model" && has_value) {
+            options.client.model = argv[++i];
+        } else if (arg == "--dimensions" && has_value) {
+            options.client.dimensions = std::atoi(argv[++i]);
+        } else if (arg == "--endpoint" && has_value) {
+            options.client.endpoint = argv[++i];
+        } else if (arg == "--batch-size" && has_value) {
+            options.client.batch_size = static_cast<size_t>(std::atol(argv[++i]));
+        } else if (arg == "--concurrency" && has_value) {
+            options.client.concurrency = std::atoi(argv[++i]);
+        } else if (arg == "--chunk-words" && has_value) {
+            options.chunk_words = static_cast<size_t>(std::atol(argv[++i]));
+        } else if (arg == "--overlap-words" && has_value) {
+            options.overlap_words = static_cast<size_t>(std::atol(argv[++i]));
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--nodes nodes.json] [--index faiss.index] [--mapping node_mapping.json] [--store embeddings.bin]"
+                         " [--model M] [--dimensions N] [--endpoint URL] [--batch-size N] [--concurrency N]"
+                         " [--chunk-words N] [--overlap-words N]\n";
+            return 1;
+        }
+    }
+    if (options.client.batch_size == 0 || options.client.concurrency <= 0 || options.chunk_words == 0) {
+        std::cerr << "--batch-size, --concurrency and --chunk-words must be positive\n";
+        return 1;
+    }
+    if (options.overlap_words >= options.chunk_words) {
+        std::cerr << "--overlap-words must be smaller than --chunk-words\n";
+        return 1;
+    }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    int status = run(options);
+    curl_global_cleanup();
+    return status;
+}
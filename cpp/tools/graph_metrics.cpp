@@ -0,0 +1,140 @@
+#include "atomic_file.hpp"
+#include "graph_metrics.hpp"
+#include "link_graph.hpp"
+#include "string_util.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using crawler::CsrGraph;
+
+struct Options {
+    fs::path link_map = fs::path("data") / "link_map.json";
+    fs::path output = fs::path("data") / "processed" / "graph_metrics.json";
+    double damping = 0.85;
+    bool hits = false;
+    crawler::IterationOptions iteration;
+};
+
+void append_number(std::string& out, double value) {
+    char buffer[32];
+    int length = std::snprintf(buffer, sizeof(buffer), "%.10g", value);
+    out.append(buffer, static_cast<size_t>(length));
+}
+
+long elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return static_cast<long>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - since).count());
+}
+
+// One object per node, in node ID order, one per line so the file stays
+// easy to stream.
+bool write_metrics(const fs::path& path, const std::vector<std::string>& urls, const CsrGraph& graph,
+                   const CsrGraph& incoming, const crawler::PageRankResult& rank, const crawler::HitsResult* hits) {
+    return crawler::write_file_atomically(path, [&](std::ofstream& out) {
+        std::string buffer = "[";
+        for (size_t i = 0; i < urls.size(); ++i) {
+            buffer += i == 0 ? "\n  {\"url\": " : ",\n  {\"url\": ";
+            crawler::append_json_string(buffer, urls[i]);
+            buffer += ", \"pagerank\": ";
+            append_number(buffer, rank.scores[i]);
+            buffer += ", \"in_degree\": " + std::to_string(incoming.offsets[i + 1] - incoming.offsets[i]);
+            buffer += ", \"out_degree\": " + std::to_string(graph.offsets[i + 1] - graph.offsets[i]);
+            if (hits) {
+                buffer += ", \"hub\": ";
+                append_number(buffer, hits->hubs[i]);
+                buffer += ", \"authority\": ";
+                append_number(buffer, hits->authorities[i]);
+            }
+            buffer += '}';
+            if (buffer.size() > (1 << 16)) {
+                out << buffer;
+                buffer.clear();
+            }
+        }
+        buffer += "\n]\n";
+        out << buffer;
+    });
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--hits") {
+            options.hits = true;
+        } else if (arg == "--damping" && has_value) {
+            options.damping = std::atof(argv[++i]);
+        } else if (arg == "--max-iterations" && has_value) {
+            options.iteration.max_iterations = std::atoi(argv[++i]);
+        } else if (arg == "--tolerance" && has_value) {
+            options.iteration.tolerance = std::atof(argv[++i]);
+        } else if (!arg.empty() && arg[0] != '-' && positional.size() < 2) {
+            positional.push_back(arg);
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--hits] [--damping D] [--max-iterations N] [--tolerance T] [link_map.json [output.json]]\n";
+            return 1;
+        }
+    }
+    if (!positional.empty()) {
+        options.link_map = positional[0];
+    }
+    if (positional.size() > 1) {
+        options.output = positional[1];
+    }
+    if (options.damping <= 0.0 || options.damping >= 1.0) {
+        std::cerr << "--damping must be between 0 and 1\n";
+        return 1;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    fs::path csr_path = options.link_map;
+    csr_path.replace_extension(".csr");
+    auto graph = crawler::read_csr(csr_path);
+    auto urls = crawler::read_link_map_nodes(options.link_map);
+    if (!graph || !urls) {
+        return 1;
+    }
+    if (urls->size() != graph->node_count()) {
+        std::cerr << options.link_map << " lists " << urls->size() << " nodes but " << csr_path << " has "
+                  << graph->node_count() << "\n";
+        return 1;
+    }
+    CsrGraph incoming = crawler::transpose(*graph);
+    std::cout << "Loaded " << graph->node_count() << " nodes and " << graph->edge_count() << " edges in "
+              << elapsed_ms(started) << " ms\n";
+
+    auto phase = std::chrono::steady_clock::now();
+    auto rank = crawler::pagerank(*graph, incoming, options.damping, options.iteration);
+    std::cout << "PageRank: " << rank.iterations << " iterations in " << elapsed_ms(phase) << " ms\n";
+    crawler::HitsResult hits;
+    if (options.hits) {
+        phase = std::chrono::steady_clock::now();
+        hits = crawler::hits(*graph, incoming, options.iteration);
+        std::cout << "HITS: " << hits.iterations << " iterations in " << elapsed_ms(phase) << " ms\n";
+    }
+
+    if (options.output.has_parent_path()) {
+        fs::create_directories(options.output.parent_path());
+    }
+    if (!write_metrics(options.output, *urls, *graph, incoming, rank, options.hits ? &hits : nullptr)) {
+        return 1;
+    }
+    std::cout << "Wrote " << options.output << " in " << elapsed_ms(started) << " ms total\n";
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include "graph_store.hpp"
+#include "json.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using crawler::JsonValue;
+
+struct Options {
+    fs::path nodes = fs::path("data") / "processed" / "nodes.json";
+    fs::path edges = fs::path("data") / "processed" / "edges.json";
+    fs::path output = fs::path("data") / "processed" / "graph.bin";
+};
+
+long elapsed_ms(std::chrono::steady_clock::time_point since) {
+    return static_cast<long>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - since).count());
+}
+
+std::optional<JsonValue> read_json_array(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open " << path << "; run build_graph.py first\n";
+        return std::nullopt;
+    }
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::string error;
+    auto value = JsonValue::parse(text, &error);
+    if (!value || !value->is_array()) {
+        std::cerr << path << " is not a JSON array" << (error.empty() ? "" : ": " + error) << "\n";
+        return std::nullopt;
+    }
+    return value;
+}
+
+std::string_view string_member(const JsonValue& object, std::string_view key) {
+    const JsonValue* value = object.find(key);
+    return value && value->is_string() ? std::string_view(value->as_string()) : std::string_view();
+}
+
+// build_graph.py keys nodes by URL without its trailing slash.
+std::string_view node_key(std::string_view url) {
+    while (!url.empty() && url.back() == '/') {
+        url.remove_suffix(1);
+    }
+    return url;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--nodes" && has_value) {
+            options.nodes = argv[++i];
+        } else if (arg == "--edges" && has_value) {
+            options.edges = argv[++i];
+        } else if (!arg.empty() && arg[0] != '-' && positional.empty()) {
+            positional.push_back(arg);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--nodes nodes.json] [--edges edges.json] [graph.bin]\n";
+            return 1;
+        }
+    }
+    if (!positional.empty()) {
+        options.output = positional[0];
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    auto nodes_json = read_json_array(options.nodes);
+    auto edges_json = nodes_json ? read_json_array(options.edges) : std::nullopt;
+    if (!nodes_json || !edges_json) {
+        return 1;
+    }
+    std::cout << "Parsed " << nodes_json->items().size() << " nodes and " << edges_json->items().size() << " edges in "
+              << elapsed_ms(started) << " ms\n";
+
+    std::vector<crawler::GraphStoreNode> nodes;
+    std::vector<const JsonValue*> sources;
+    std::unordered_map<std::string_view, uint32_t> ids;
+    for (const JsonValue& value : nodes_json->items()) {
+        std::string_view url = string_member(value, "url");
+        if (!value.is_object() || url.empty() || !ids.emplace(node_key(url), static_cast<uint32_t>(nodes.size())).second) {
+            continue;
+        }
+        crawler::GraphStoreNode node;
+        node.url = url;
+        node.path = string_member(value, "path");
+        node.content_type = string_member(value, "content_type");
+        node.doc_type = string_member(value, "doc_type");
+        node.title = string_member(value, "title");
+        node.domain = string_member(value, "domain");
+        node.snippet = string_member(value, "snippet");
+        node.text = string_member(value, "clean_text");
+        const JsonValue* words = value.find("word_count");
+        node.word_count = words && words->is_number() ? static_cast<uint32_t>(words->as_number()) : 0;
+        const JsonValue* title = value.find("title");
+        const JsonValue* root = value.find("is_root");
+        node.flags = (title && title->is_string() ? crawler::GraphStoreNode::kHasTitle : 0) |
+                     (root && root->is_bool() && root->as_bool() ? crawler::GraphStoreNode::kRoot : 0);
+        nodes.push_back(node);
+        sources.push_back(&value);
+    }
+
+    // Every other number on a node (pagerank, degrees, ...) becomes a column.
+    std::vector<crawler::GraphStoreMetric> metrics;
+    std::unordered_map<std::string, size_t> columns;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        auto it = ids.find(node_key(string_member(*sources[i], "duplicate_of")));
+        if (it != ids.end()) {
+            nodes[i].duplicate_of = static_cast<int32_t>(it->second);
+        }
+        for (const auto& [name, value] : sources[i]->members()) {
+            if (!value.is_number() || name == "word_count") {
+                continue;
+            }
+            auto [column, added] = columns.try_emplace(name, metrics.size());
+            if (added) {
+                metrics.push_back({name, std::vector<double>(nodes.size(), std::nan(""))});
+            }
+            metrics[column->second].values[i] = value.as_number();
+        }
+    }
+
+    std::vector<crawler::GraphStoreEdge> edges;
+    edges.reserve(edges_json->items().size());
+    size_t dangling = 0;
+    for (const JsonValue& value : edges_json->items()) {
+        auto source = ids.find(node_key(string_member(value, "source")));
+        auto target = ids.find(node_key(string_member(value, "target")));
+        if (source == ids.end() || target == ids.end()) {
+            ++dangling;
+            continue;
+        }
+        edges.push_back({source->second, target->second, string_member(value, "anchor_text")});
+    }
+    if (dangling > 0) {
+        std::cerr << "Skipped " << dangling << " edges whose source or target is not a node\n";
+    }
+
+    if (options.output.has_parent_path()) {
+        fs::create_directories(options.output.parent_path());
+    }
+    size_t edge_count = edges.size();
+    if (!crawler::write_graph_store(options.output, nodes, std::move(edges), metrics)) {
+        return 1;
+    }
+    std::error_code ec;
+    auto size = fs::file_size(options.output, ec);
+    std::cout << "Wrote " << nodes.size() << " nodes, " << edge_count << " edges and " << metrics.size()
+              << " metric columns to " << options.output << " (" << (ec ? 0 : size) / 1024 << " KiB) in "
+              << elapsed_ms(started) << " ms total\n";
+    return 0;
+}
@@ -0,0 +1,362 @@
+// Serves a recorded crawl (a data/raw directory) over plain HTTP on
+// localhost, so crawls can be replayed and timed without touching the live
+// site. Every recorded URL is served at the same path and query under
+// http://127.0.0.1:<port>; absolute links to the recorded hosts inside text
+// bodies are rewritten to point at the replay server, so a crawl started at
+// the printed start URL stays on it.
+#include "manifest_writer.hpp"
+#include "segment_store.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Options {
+    fs::path raw = fs::path("data") / "raw";
+    int port = 8080;
+    // Added before every response, to stand in for server think time.
+    int latency_ms = 0;
+    // Read (and rewrite) every body at startup so disk reads stay out of
+    // the measurement.
+    bool preload = false;
+};
+
+struct Resource {
+    std::string authority;
+    std::string location;
+    std::string content_type;
+    // Filled at startup with --preload.
+    std::shared_ptr<const std::string> body;
+};
+
+#ifdef MSG_NOSIGNAL
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#else
+constexpr int kSendFlags = 0;
+#endif
+
+constexpr size_t kMaxHeaderBytes = 64 * 1024;
+
+std::atomic<bool> stop_requested {false};
+
+void handle_signal(int) { stop_requested.store(true); }
+
+bool is_text_type(std::string_view content_type) {
+    return content_type.starts_with("text/") || content_type.find("xml") != std::string_view::npos ||
+           content_type.find("json") != std::string_view::npos ||
+           content_type.find("javascript") != std::string_view::npos;
+}
+
+bool is_host_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '.' || c == '-';
+}
+
+class Snapshot {
+   public:
+    bool load(const Options& options) {
+        local_ = "127.0.0.1:" + std::to_string(options.port);
+        size_t collisions = 0;
+        crawler::for_each_metadata_row(options.raw / "metadata.tsv", [&](const std::string& url, const std::string& location,
+                                                                         const std::string& content_type) {
+            size_t scheme_end = url.find("://");
+            if (scheme_end == std::string::npos || location.empty()) {
+                return;
+            }
+            size_t path_begin = url.find('/', scheme_end + 3);
+            std::string authority = url.substr(scheme_end + 3, path_begin == std::string::npos ? std::string::npos
+                                                                                                 : path_begin - scheme_end - 3);
+            std::string target = path_begin == std::string::npos ? "/" : url.substr(path_begin);
+            if (std::find(authorities_.begin(), authorities_.end(), authority) == authorities_.end()) {
+                authorities_.push_back(authority);
+            }
+            if (start_target_.empty()) {
+                start_target_ = target;
+            }
+            // A URL saved again later replaces its earlier row; the same
+            // path on two recorded hosts keeps the first host's page.
+            Resource resource {authority, location, content_type, nullptr};
+            auto [it, inserted] = resources_.try_emplace(target, resource);
+            if (inserted) {
+                return;
+            }
+            if (it->second.authority == authority) {
+                it->second = std::move(resource);
+            } else {
+                ++collisions;
+            }
+        });
+        if (resources_.empty()) {
+            std::cerr << "No recorded pages in " << options.raw / "metadata.tsv" << "\n";
+            return false;
+        }
+        if (collisions > 0) {
+            std::cerr << collisions << " URLs share a path with a page on another recorded host and are not served\n";
+        }
+        if (options.preload) {
+            uint64_t bytes = 0;
+            for (auto& [target, resource] : resources_) {
+                resource.body = read(resource);
+                bytes += resource.body->size();
+            }
+            std::cout << "Preloaded " << bytes / (1 << 20) << " MB\n";
+        }
+        return true;
+    }
+
+    const Resource* find(std::string_view target) const {
+        auto it = resources_.find(std::string(target));
+        return it == resources_.end() ? nullptr : &it->second;
+    }
+
+    std::shared_ptr<const std::string> body(const Resource& resource) const {
+        return resource.body ? resource.body : read(resource);
+    }
+
+    size_t size() const { return resources_.size(); }
+    const std::vector<std::string>& authorities() const { return authorities_; }
+    const std::string& start_target() const { return start_target_; }
+
+   private:
+    // Text bodies have links to recorded hosts pointed at the replay server.
+    std::shared_ptr<const std::string> read(const Resource& resource) const {
+        std::string body = crawler::read_saved_body(resource.location);
+        if (is_text_type(resource.content_type)) {
+            body = rewrite_links(body);
+        }
+        return std::make_shared<const std::string>(std::move(body));
+    }
+
+    std::string rewrite_links(const std::string& body) const {
+        std::string out;
+        out.reserve(body.size());
+        size_t copied = 0;
+        for (size_t slashes = body.find("//"); slashes != std::string::npos; slashes = body.find("//", slashes + 2)) {
+            for (const auto& authority : authorities_) {
+                size_t end = slashes + 2 + authority.size();
+                if (body.compare(slashes + 2, authority.size(), authority) != 0 ||
+                    (end < body.size() && is_host_char(body[end]))) {
+                    continue;
+                }
+                // Covers http://, https:// and protocol-relative //host links.
+                size_t begin = slashes;
+                if (begin >= 6 && body.compare(begin - 6, 6, "https:") == 0) {
+                    begin -= 6;
+                } else if (begin >= 5 && body.compare(begin - 5, 5, "http:") == 0) {
+                    begin -= 5;
+                }
+                out.append(body, copied, begin - copied);
+                out += "http://" + local_;
+                copied = end;
+                slashes = end - 2;
+                break;
+            }
+        }
+        out.append(body, copied, std::string::npos);
+        return out;
+    }
+
+    std::string local_;
+    std::vector<std::string> authorities_;
+    std::string start_target_;
+    std::unordered_map<std::string, Resource> resources_;
+};
+
+bool send_all(int fd, std::string_view data) {
+    while (!data.empty()) {
+        ssize_t sent = ::send(fd, data.data(), data.size(), kSendFlags);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        data.remove_prefix(static_cast<size_t>(sent));
+    }
+    return true;
+}
+
+bool header_says_close(std::string_view headers) {
+    for (size_t pos = headers.find("\r\n"); pos != std::string_view::npos; pos = headers.find("\r\n", pos + 2)) {
+        std::string_view line = headers.substr(pos + 2, headers.find("\r\n", pos + 2) - pos - 2);
+        if (line.size() >= 11 && strncasecmp(line.data(), "connection:", 11) == 0) {
+            return line.find("close") != std::string_view::npos || line.find("Close") != std::string_view::npos;
+        }
+    }
+    return false;
+}
+
+// Serves requests on one keep-alive connection until the client closes it.
+void serve_connection(int client, const Snapshot& snapshot, const Options& options) {
+    int no_delay = 1;
+    ::setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+#ifdef SO_NOSIGPIPE
+    int no_sigpipe = 1;
+    ::setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe, sizeof(no_sigpipe));
+#endif
+    // Idle keep-alive connections wake up now and then to notice a stop.
+    timeval timeout {0, 250000};
+    ::setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    std::string pending;
+    char buffer[16 * 1024];
+    while (!stop_requested.load()) {
+        size_t header_end;
+        while ((header_end = pending.find("\r\n\r\n")) == std::string::npos) {
+            if (pending.size() > kMaxHeaderBytes) {
+                return;
+            }
+            ssize_t received = ::recv(client, buffer, sizeof(buffer), 0);
+            if (received < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+                if (stop_requested.load()) {
+                    return;
+                }
+                continue;
+            }
+            if (received <= 0) {
+                return;
+            }
+            pending.append(buffer, static_cast<size_t>(received));
+        }
+        std::string headers = pending.substr(0, header_end + 2);
+        pending.erase(0, header_end + 4);
+
+        std::string_view line(headers);
+        line = line.substr(0, line.find("\r\n"));
+        size_t method_end = line.find(' ');
+        size_t target_end = method_end == std::string_view::npos ? std::string_view::npos : line.find(' ', method_end + 1);
+        std::string_view method = line.substr(0, method_end);
+        std::string_view target = target_end == std::string_view::npos
+                                      ? std::string_view()
+                                      : line.substr(method_end + 1, target_end - method_end - 1);
+        bool close = header_says_close(headers);
+
+        if (options.latency_ms > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(options.latency_ms));
+        }
+        std::string response;
+        std::shared_ptr<const std::string> body;
+        const Resource* resource = method == "GET" || method == "HEAD" ? snapshot.find(target) : nullptr;
+        if (resource) {
+            body = snapshot.body(*resource);
+            response = "HTTP/1.1 200 OK\r\nContent-Type: " + resource->content_type +
+                       "\r\nContent-Length: " + std::to_string(body->size()) + "\r\n";
+        } else {
+            static const std::string not_found = "Not in the recorded crawl\n";
+            body = std::shared_ptr<const std::string>(&not_found, [](const std::string*) {});
+            response = "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\nContent-Length: " +
+                       std::to_string(body->size()) + "\r\n";
+        }
+        response += close ? "Connection: close\r\n\r\n" : "\r\n";
+        if (!send_all(client, response) || (method != "HEAD" && !send_all(client, *body)) || close) {
+            return;
+        }
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    bool have_raw = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--port" && has_value) {
+            options.port = std::atoi(argv[++i]);
+        } else if (arg == "--latency-ms" && has_value) {
+            options.latency_ms = std::atoi(argv[++i]);
+        } else if (arg == "--preload") {
+            options.preload = true;
+        } else if (!arg.empty() && arg[0] != '-' && !have_raw) {
+            options.raw = arg;
+            have_raw = true;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--port N] [--latency-ms N] [--preload] [data/raw]\n";
+            return 1;
+        }
+    }
+    if (options.port <= 0 || options.port > 65535) {
+        std::cerr << "--port must be between 1 and 65535\n";
+        return 1;
+    }
+
+    Snapshot snapshot;
+    if (!snapshot.load(options)) {
+        return 1;
+    }
+
+    int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    ::setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(options.port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (listener < 0 || ::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(listener, 128) != 0) {
+        std::cerr << "Failed to listen on 127.0.0.1:" << options.port << ": " << std::strerror(errno) << "\n";
+        return 1;
+    }
+    ::signal(SIGINT, handle_signal);
+    ::signal(SIGTERM, handle_signal);
+    ::signal(SIGPIPE, SIG_IGN);
+
+    std::string local = "127.0.0.1:" + std::to_string(options.port);
+    std::cout << "Replaying " << snapshot.size() << " URLs from " << options.raw << " (hosts:";
+    for (const auto& authority : snapshot.authorities()) {
+        std::cout << ' ' << authority;
+    }
+    std::cout << ")\nCrawl it with \"start_url\": \"http://" << local << snapshot.start_target()
+              << "\", \"allowed_domains\": [\"" << local << "\"]" << std::endl;
+
+    // One thread per connection: the crawler keeps a handful of keep-alive
+    // connections per host, so there are never many.
+    std::atomic<int> open_connections {0};
+    while (!stop_requested.load()) {
+        pollfd fd {listener, POLLIN, 0};
+        if (::poll(&fd, 1, 250) <= 0) {
+            continue;
+        }
+        int client = ::accept(listener, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+        open_connections.fetch_add(1);
+        std::thread([client, &snapshot, &options, &open_connections] {
+            serve_connection(client, snapshot, options);
+            ::close(client);
+            open_connections.fetch_sub(1);
+        }).detach();
+    }
+    ::close(listener);
+    // Connection threads use `snapshot`; they see the stop flag within a
+    // receive timeout.
+    while (open_connections.load() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return 0;
+}
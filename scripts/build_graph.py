@@ -6,6 +6,9 @@ scripts/clean_content.py). Loads those files, creates a directed graph, and
 computes metrics such as PageRank, betweenness, degree counts, hop distances,
 and depth from the homepage.
 
+Without the cleaned data, the structure-only graph the crawler wrote to
+link_map_output (plus its .csr adjacency file) is loaded instead.
+
 Usage (run from repo root with venv activated):
 
     python scripts/build_graph.py
@@ -18,9 +21,11 @@ from __future__ import annotations
 import json
 import logging
 import os
+import struct
+from array import array
 from dataclasses import dataclass, field
 from pathlib import Path
-from typing import Dict, List
+from typing import Dict, List, Tuple
 from urllib.parse import urlparse
 
 import networkx as nx
@@ -33,6 +38,7 @@ DEFAULT_CONFIG_PATH = REPO_ROOT / "config" / "pipeline.json"
 class GraphSettings:
     processed_output: Path = REPO_ROOT / "data/processed"
     root_url: str = "https://www.bgsu.edu"
+    link_map_output: Path = REPO_ROOT / "data/link_map.json"
 
     @classmethod
     def from_dict(cls, data: Dict[str, object]) -> "GraphSettings":
@@ -46,6 +52,7 @@ class GraphSettings:
         return cls(
             processed_output=processed_output,
             root_url=get_value("root_url", default.root_url),
+            link_map_output=_resolve_path(get_value("link_map_output", default.link_map_output)),
         )
 
     @property
@@ -56,6 +63,14 @@ class GraphSettings:
     def clean_edges_path(self) -> Path:
         return self.processed_output / "clean_edges.json"
 
+    @property
+    def link_map_csr_path(self) -> Path:
+        return self.link_map_output.with_suffix(".csr")
+
+    @property
+    def metrics_path(self) -> Path:
+        return self.processed_output / "graph_metrics.json"
+
     @property
     def nodes_output_path(self) -> Path:
         return self.processed_output / "nodes.json"
@@ -81,6 +96,8 @@ class GraphBuilder:
 
     def _load_clean_data(self) -> bool:
         if not self.settings.clean_nodes_path.exists() or not self.settings.clean_edges_path.exists():
+            if self.settings.link_map_csr_path.exists() and self.settings.link_map_output.exists():
+                return self._load_link_map()
             logging.error(
                 "Missing cleaned data. Expected %s and %s",
                 self.settings.clean_nodes_path,
@@ -100,6 +117,33 @@ class GraphBuilder:
         logging.info("Loaded %s nodes and %s edges from cleaned data", len(self.nodes), len(self.edges))
         return True
 
+    def _load_link_map(self) -> bool:
+        logging.info("Loading crawler link map from %s", self.settings.link_map_output)
+        with self.settings.link_map_output.open("r", encoding="utf-8") as f:
+            urls = json.load(f)["nodes"]
+        offsets, targets = load_csr(self.settings.link_map_csr_path)
+        if len(offsets) != len(urls) + 1:
+            logging.error("%s does not match %s", self.settings.link_map_csr_path, self.settings.link_map_output)
+            return False
+        for url in urls:
+            self.nodes[url.rstrip("/")] = {
+                "url": url,
+                "path": "",
+                "content_type": "",
+                "doc_type": "page",
+                "title": None,
+                "word_count": 0,
+                "clean_text": "",
+                "snippet": "",
+                "domain": urlparse(url).netloc,
+                "is_root": url.rstrip("/") == self.settings.root_url.rstrip("/"),
+            }
+        for source, url in enumerate(urls):
+            for target in targets[offsets[source] : offsets[source + 1]]:
+                self.edges.append({"source": url, "target": urls[target]})
+        logging.info("Loaded %s nodes and %s edges from the link map", len(self.nodes), len(self.edges))
+        return True
+
     def _build_graph(self) -> None:
         logging.info("Building graph with %s nodes", len(self.nodes))
         for url, data in self.nodes.items():
@@ -127,8 +171,20 @@ class GraphBuilder:
             self.graph.add_edge(source, target, **{k: v for k, v in edge.items() if k not in {"source", "target"}})
 
     def _compute_metrics(self) -> None:
-        logging.info("Metric computation disabled (skipping slow analytics)")
-        # Intentionally left blank – we no longer compute PageRank/betweenness/etc.
+        # PageRank, degrees and HITS come precomputed from cpp/graph_metrics;
+        # computing them here was too slow on a full crawl.
+        if not self.settings.metrics_path.exists():
+            logging.info("No %s; run cpp/graph_metrics to add PageRank/degree metrics", self.settings.metrics_path)
+            return
+        with self.settings.metrics_path.open("r", encoding="utf-8") as f:
+            metrics = json.load(f)
+        merged = 0
+        for entry in metrics:
+            node = self.nodes.get(entry.pop("url").rstrip("/"))
+            if node is not None:
+                node.update(entry)
+                merged += 1
+        logging.info("Merged graph metrics for %s of %s nodes", merged, len(self.nodes))
 
     def _write_outputs(self) -> None:
         self.settings.processed_output.mkdir(parents=True, exist_ok=True)
@@ -143,6 +199,21 @@ class GraphBuilder:
         )
 
 
+def load_csr(path: Path) -> Tuple[array, array]:
+    """Reads the crawler's CSR file: node i links to targets[offsets[i]:offsets[i + 1]]."""
+    data = path.read_bytes()
+    if data[:8] != b"FGCSR001":
+        raise ValueError(f"{path} is not a link graph CSR file")
+    node_count, edge_count = struct.unpack_from("=QQ", data, 8)
+    offsets = array("Q")
+    targets = array("I")
+    start = 24
+    offsets.frombytes(data[start : start + 8 * (node_count + 1)])
+    start += 8 * (node_count + 1)
+    targets.frombytes(data[start : start + 4 * edge_count])
+    return offsets, targets
+
+
 def _resolve_path(path_value) -> Path:
     path = path_value if isinstance(path_value, Path) else Path(path_value)
     if not path.is_absolute():
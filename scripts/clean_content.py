@@ -1,30 +1,39 @@
 #!/usr/bin/env python3
 """Extract clean text and link structure from crawled files.
 
-Reads data/raw/metadata.tsv (produced by the crawler), parses HTML plus
-non-HTML assets (PDF, DOCX, spreadsheets, etc.), and emits
+Reads data/raw/metadata.tsv (produced by the crawler), loads each body from
+its segment record (or saved file), parses HTML (or takes the crawler's own
+extraction from data/raw/text.ndjson when extract_text is on) plus
+non-HTML assets (PDF, DOCX, spreadsheets, etc.; again the crawler's text when
+it extracted them), and emits
 data/processed/clean_nodes.json + clean_edges.json. These files are later
 consumed by scripts/build_graph.py to compute graph metrics.
 
 Usage (run from repo root with venv activated):
 
-    python scripts/clean_content.py
+    python scripts/clean_content.py           # every record in metadata.tsv
+    python scripts/clean_content.py --delta   # only pages the last crawl reported in delta.tsv
 
 Configuration lives in config/pipeline.json (or override with PIPELINE_CONFIG).
 """
 
 from __future__ import annotations
 
+import argparse
+import io
 import json
 import logging
 import os
+import zlib
 from dataclasses import dataclass, field
 from pathlib import Path
-from typing import Dict, List, Tuple
+from typing import Dict, List, Set, Tuple
 from urllib.parse import urljoin, urlparse
 
 from bs4 import BeautifulSoup
 
+from segments import SegmentReader, split_locator
+
 try:
     from docx import Document
 except ImportError:  # pragma: no cover - optional dep
@@ -72,6 +81,18 @@ class CleaningSettings:
     def metadata_path(self) -> Path:
         return self.raw_output / "metadata.tsv"
 
+    @property
+    def delta_path(self) -> Path:
+        return self.raw_output / "delta.tsv"
+
+    @property
+    def text_path(self) -> Path:
+        return self.raw_output / "text.ndjson"
+
+    @property
+    def duplicates_path(self) -> Path:
+        return self.raw_output / "duplicates.tsv"
+
     @property
     def clean_nodes_path(self) -> Path:
         return self.processed_output / "clean_nodes.json"
@@ -82,16 +103,26 @@ class CleaningSettings:
 
 
 class ContentCleaner:
-    def __init__(self, settings: CleaningSettings) -> None:
+    def __init__(self, settings: CleaningSettings, delta: bool = False) -> None:
         self.settings = settings
+        self.delta = delta
         self.nodes: Dict[str, Dict] = {}
         self.edges: List[Dict] = []
+        self.segments = SegmentReader()
+        self.native_text: Dict[str, Dict] = {}
 
     def run(self) -> None:
-        records = self._read_metadata()
-        if not records:
-            logging.error("No metadata records found at %s", self.settings.metadata_path)
-            return
+        removed: Set[str] = set()
+        if self.delta:
+            records, removed = self._read_delta()
+            if not records and not removed:
+                logging.info("Delta %s is empty; nothing to clean", self.settings.delta_path)
+                return
+        else:
+            records = self._read_metadata()
+            if not records:
+                logging.error("No metadata records found at %s", self.settings.metadata_path)
+                return
 
         if self.settings.clean_nodes_path.exists():
             try:
@@ -110,6 +141,15 @@ class ContentCleaner:
             except Exception as exc:
                 logging.warning("Failed to load existing cleaned edges: %s", exc)
 
+        if self.delta:
+            # Reprocessed and removed pages drop their old node and outgoing edges.
+            stale = removed | {record["url"].rstrip("/") for record in records}
+            for url in removed:
+                self.nodes.pop(url, None)
+            self.edges = [edge for edge in self.edges if edge["source"] not in stale]
+            logging.info("Delta: %s changed/new, %s removed", len(records), len(removed))
+
+        self.native_text = self._read_native_text()
         total = len(records)
         logging.info("Cleaning %s records (serial)", total)
         for idx, record in enumerate(records, start=1):
@@ -119,6 +159,7 @@ class ContentCleaner:
             if idx % 50 == 0:
                 logging.info("Processing [%s/%s]: %s", idx, total, url)
 
+        self._mark_duplicates()
         self._write_outputs()
 
     def _write_outputs(self, partial: bool = False) -> None:
@@ -145,13 +186,14 @@ class ContentCleaner:
 
     def _process_record(self, record: Dict[str, str]):
         url = record["url"].rstrip("/")
-        absolute_path = _resolve_path(record["path"])
         parsed = urlparse(url)
+        # Segment locators carry no file name; the URL path stands in for it.
+        name = parsed.path if split_locator(record["path"]) else record["path"]
         node = {
             "url": url,
             "path": record["path"],
             "content_type": record["content_type"],
-            "doc_type": self._infer_doc_type(record["path"], record["content_type"]),
+            "doc_type": self._infer_doc_type(name, record["content_type"]),
             "title": None,
             "word_count": 0,
             "clean_text": "",
@@ -161,8 +203,14 @@ class ContentCleaner:
         }
         edges: List[Dict[str, str]] = []
 
-        if self._is_html(record["content_type"], record["path"]):
-            title, word_count, links, clean_text = self._process_html(absolute_path, url)
+        if self._is_html(record["content_type"], name):
+            native = self.native_text.get(record["url"])
+            if native is not None and native.get("path") == record["path"]:
+                # The crawler already extracted this exact body.
+                title, word_count, clean_text = native["title"], native["word_count"], native["clean_text"]
+                links = [(target.split("#", 1)[0].rstrip("/"), anchor_text) for target, anchor_text in native["links"]]
+            else:
+                title, word_count, links, clean_text = self._process_html(self._load_body(record["path"]), url)
             node["title"] = title
             node["word_count"] = word_count
             node["clean_text"] = clean_text
@@ -172,20 +220,42 @@ class ContentCleaner:
                     continue
                 edges.append({"source": url, "target": link_url.rstrip("/"), "anchor_text": anchor_text})
         else:
-            extracted_text = self._extract_text_from_file(absolute_path)
-            node["title"] = Path(record["path"]).name
+            native = self.native_text.get(record["url"])
+            if native is not None and native.get("path") == record["path"]:
+                extracted_text = native["clean_text"]
+            else:
+                extracted_text = self._extract_text_from_file(self._load_body(record["path"]), name)
+            node["title"] = Path(name).name
             node["clean_text"] = extracted_text
             node["snippet"] = extracted_text[: self.settings.snippet_chars]
             node["word_count"] = len(extracted_text.split())
 
         return url, node, edges
 
+    def _load_body(self, location: str) -> bytes | None:
+        locator = split_locator(location)
+        try:
+            if locator is None:
+                return _resolve_path(location).read_bytes()
+            record = self.segments.read(_resolve_path(locator[0]), locator[1])
+        except FileNotFoundError:
+            record = None
+        if record is None:
+            logging.warning("Saved body missing during cleaning: %s", location)
+            return None
+        try:
+            return record.decoded()
+        except (OSError, EOFError, zlib.error):
+            logging.warning("Saved body could not be decoded during cleaning: %s", location)
+            return None
+
     def _read_metadata(self) -> List[Dict[str, str]]:
         metadata_path = self.settings.metadata_path
         if not metadata_path.exists():
             logging.error("Metadata file missing: %s", metadata_path)
             return []
-        records: List[Dict[str, str]] = []
+        # A page saved again after it changed gets a new row; the last one wins.
+        records: Dict[str, Dict[str, str]] = {}
         with metadata_path.open("r", encoding="utf-8") as meta:
             header = meta.readline()
             for line in meta:
@@ -193,9 +263,70 @@ class ContentCleaner:
                 if len(parts) != 3:
                     continue
                 url, path_str, content_type = parts
-                records.append({"url": url, "path": path_str, "content_type": content_type})
+                records[url] = {"url": url, "path": path_str, "content_type": content_type}
+        return list(records.values())
+
+    def _mark_duplicates(self) -> None:
+        """Tags nodes the crawler flagged as duplicates (duplicate_policy "flag") with duplicate_of."""
+        path = self.settings.duplicates_path
+        if not path.exists():
+            return
+        # A recrawled page gets a new row; an empty duplicate_of clears the flag.
+        latest: Dict[str, str] = {}
+        with path.open("r", encoding="utf-8") as f:
+            f.readline()
+            for line in f:
+                parts = line.rstrip("\n").split("\t")
+                if len(parts) == 4:
+                    latest[parts[0].rstrip("/")] = parts[1].rstrip("/")
+        flagged = 0
+        for url, duplicate_of in latest.items():
+            node = self.nodes.get(url)
+            if node is None:
+                continue
+            if duplicate_of:
+                node["duplicate_of"] = duplicate_of
+                flagged += 1
+            else:
+                node.pop("duplicate_of", None)
+        logging.info("Flagged %s nodes as duplicates", flagged)
+
+    def _read_native_text(self) -> Dict[str, Dict]:
+        """Text the crawler extracted itself (extract_text in the config), by URL; the last record wins."""
+        text_path = self.settings.text_path
+        if not text_path.exists():
+            return {}
+        records: Dict[str, Dict] = {}
+        with text_path.open("r", encoding="utf-8", errors="replace") as f:
+            for line in f:
+                try:
+                    record = json.loads(line)
+                except json.JSONDecodeError:
+                    continue
+                records[record["url"]] = record
+        logging.info("Loaded %s crawler-extracted pages from %s", len(records), text_path)
         return records
 
+    def _read_delta(self) -> Tuple[List[Dict[str, str]], Set[str]]:
+        delta_path = self.settings.delta_path
+        if not delta_path.exists():
+            logging.error("Delta file missing: %s", delta_path)
+            return [], set()
+        records: List[Dict[str, str]] = []
+        removed: Set[str] = set()
+        with delta_path.open("r", encoding="utf-8") as delta:
+            delta.readline()
+            for line in delta:
+                parts = line.rstrip("\n").split("\t")
+                if len(parts) != 4:
+                    continue
+                url, path_str, content_type, change = parts
+                if change == "removed":
+                    removed.add(url.rstrip("/"))
+                else:
+                    records.append({"url": url, "path": path_str, "content_type": content_type})
+        return records, removed
+
     @staticmethod
     def _infer_doc_type(path: str, content_type: str) -> str:
         extension = Path(path).suffix.lower()
@@ -215,22 +346,16 @@ class ContentCleaner:
         parsed = urlparse(url)
         return parsed.netloc in self.settings.allowed_domains
 
-    def _process_html(self, path: Path, base_url: str) -> Tuple[str, int, List[Tuple[str, str]], str]:
-        try:
-            html = path.read_text(encoding="utf-8", errors="ignore")
-        except FileNotFoundError:
-            logging.warning("HTML file missing during cleaning: %s", path)
+    def _process_html(self, body: bytes | None, base_url: str) -> Tuple[str, int, List[Tuple[str, str]], str]:
+        if body is None:
             return "", 0, [], ""
+        html = body.decode("utf-8", errors="ignore")
 
         soup = BeautifulSoup(html, "html.parser")
-        for tag in soup(["script", "style", "noscript", "svg"]):
+        for tag in soup(["script", "style", "noscript", "svg", "template"]):
             tag.decompose()
 
-        title = (soup.title.string or "").strip() if soup.title and soup.title.string else ""
-        text = soup.get_text(separator=" ", strip=True)
-        clean_text = " ".join(text.split())
-        word_count = len(clean_text.split())
-
+        # Navigation links are edges like any other; only nav text is dropped.
         links: List[Tuple[str, str]] = []
         for anchor in soup.find_all("a", href=True):
             href = anchor["href"].strip()
@@ -239,21 +364,27 @@ class ContentCleaner:
                 continue
             anchor_text = anchor.get_text(strip=True)[:200]
             links.append((absolute, anchor_text))
+        for tag in soup("nav"):
+            tag.decompose()
+
+        title = (soup.title.string or "").strip() if soup.title and soup.title.string else ""
+        text = soup.get_text(separator=" ", strip=True)
+        clean_text = " ".join(text.split())
+        word_count = len(clean_text.split())
         return title, word_count, links, clean_text
 
-    def _extract_text_from_file(self, path: Path) -> str:
-        if not path.exists():
-            logging.warning("File missing during cleaning: %s", path)
+    def _extract_text_from_file(self, body: bytes | None, name: str) -> str:
+        if body is None:
             return ""
-        suffix = path.suffix.lower()
+        suffix = Path(name).suffix.lower()
         if suffix in {".jpg", ".jpeg", ".png", ".gif", ".bmp", ".svg", ".tif", ".tiff"}:
             return ""
         try:
             if suffix == ".pdf":
                 if fitz is None:
-                    logging.warning("PyMuPDF not installed; skipping PDF %s", path)
+                    logging.warning("PyMuPDF not installed; skipping PDF %s", name)
                     return ""
-                doc = fitz.open(path)
+                doc = fitz.open(stream=body, filetype="pdf")
                 texts = []
                 for page in doc:
                     txt = page.get_text("text").strip()
@@ -263,9 +394,9 @@ class ContentCleaner:
                 return " ".join(texts)
             if suffix in {".docx"}:
                 if Document is None:
-                    logging.warning("python-docx not installed; skipping DOCX %s", path)
+                    logging.warning("python-docx not installed; skipping DOCX %s", name)
                     return ""
-                document = Document(path)
+                document = Document(io.BytesIO(body))
                 parts: List[str] = []
                 for para in document.paragraphs:
                     txt = para.text.strip()
@@ -277,10 +408,10 @@ class ContentCleaner:
                         if row_text:
                             parts.append(row_text)
                 return " ".join(parts)
-            logging.debug("Skipping unsupported asset %s", path)
+            logging.debug("Skipping unsupported asset %s", name)
             return ""
         except Exception as exc:  # pragma: no cover
-            logging.warning("Failed extracting text from %s: %s", path, exc)
+            logging.warning("Failed extracting text from %s: %s", name, exc)
             return ""
 
 
@@ -306,11 +437,22 @@ def load_settings(config_path: Path | None = None) -> CleaningSettings:
     return CleaningSettings()
 
 
+def parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(description="Clean crawled pages into clean_nodes.json / clean_edges.json.")
+    parser.add_argument(
+        "--delta",
+        action="store_true",
+        help="Only reprocess pages listed in raw_output/delta.tsv, updating the existing outputs in place",
+    )
+    return parser.parse_args()
+
+
 def main() -> None:
+    args = parse_args()
     logging.basicConfig(level=logging.INFO, format="%(asctime)s [%(levelname)s] %(message)s")
     config_path = Path(os.environ["PIPELINE_CONFIG"]) if "PIPELINE_CONFIG" in os.environ else None
     settings = load_settings(config_path)
-    cleaner = ContentCleaner(settings)
+    cleaner = ContentCleaner(settings, delta=args.delta)
     cleaner.run()
 
 
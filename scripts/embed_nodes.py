@@ -13,6 +13,15 @@ Usage (run from repo root, after clean_content/build_graph have produced data/pr
         --nodes data/processed/nodes.json \
         --index data/processed/faiss.index \
         --mapping data/processed/node_mapping.json
+
+After an incremental crawl (and clean_content.py --delta / build_graph.py),
+pass --delta data/raw/delta.tsv to re-embed only new and changed pages; the
+other vectors are reused from the existing index.
+
+When the vectors come from cpp/embed_index instead, pass
+--vectors data/processed/embeddings.bin with --index-factory (e.g.
+"IVF256,PQ16") to build a smaller approximate index from them; no model is
+loaded and node_mapping.json is left as embed_index wrote it.
 """
 
 from __future__ import annotations
@@ -21,11 +30,11 @@ import argparse
 import json
 import logging
 import os
+import struct
 from pathlib import Path
 
 import faiss
 import numpy as np
-from sentence_transformers import SentenceTransformer
 
 REPO_ROOT = Path(__file__).resolve().parents[1]
 
@@ -57,6 +66,23 @@ def parse_args() -> argparse.Namespace:
     )
     parser.add_argument("--batch-size", type=int, default=64, help="Batch size for encoding")
     parser.add_argument("--device", default="mps", help="Device to use (cpu, cuda, mps)")
+    parser.add_argument(
+        "--delta",
+        type=Path,
+        default=None,
+        help="Crawler delta.tsv; only its new/changed URLs are re-embedded into the existing index",
+    )
+    parser.add_argument(
+        "--vectors",
+        type=Path,
+        default=None,
+        help="embeddings.bin from cpp/embed_index; index its vectors in node_mapping.json row order instead of encoding",
+    )
+    parser.add_argument(
+        "--index-factory",
+        default="Flat",
+        help='FAISS index_factory string for --vectors, e.g. "IVF256,PQ16" to trade some recall for memory',
+    )
     return parser.parse_args()
 
 
@@ -78,24 +104,116 @@ def make_payload(node: dict) -> str:
     return f"{title}\n{doc_type} {depth_txt}\n{snippet}\n{node.get('clean_text','')}"
 
 
+def load_delta(path: Path) -> set[str]:
+    """URLs (without trailing slash) whose embedding is stale: new, changed or removed."""
+    stale: set[str] = set()
+    with path.open("r", encoding="utf-8") as f:
+        f.readline()
+        for line in f:
+            parts = line.rstrip("\n").split("\t")
+            if len(parts) == 4:
+                stale.add(parts[0].rstrip("/"))
+    return stale
+
+
+def reusable_vectors(args: argparse.Namespace, nodes: list[dict], stale: set[str]) -> tuple[list[dict], np.ndarray | None]:
+    """Nodes whose existing vectors can be kept, and those vectors."""
+    if not args.index.exists() or not args.mapping.exists():
+        logging.warning("No existing index/mapping; embedding all nodes")
+        return [], None
+    index = faiss.read_index(str(args.index))
+    with args.mapping.open("r", encoding="utf-8") as f:
+        mapping = json.load(f)
+    by_url = {node["url"].rstrip("/"): node for node in nodes}
+    rows = [
+        row["row_id"]
+        for row in mapping
+        if row["url"].rstrip("/") not in stale and row["url"].rstrip("/") in by_url and row["row_id"] < index.ntotal
+    ]
+    if not rows:
+        return [], None
+    vectors = index.reconstruct_n(0, index.ntotal)[rows]
+    kept = [by_url[mapping_row["url"].rstrip("/")] for mapping_row in (mapping[r] for r in rows)]
+    return kept, vectors
+
+
+def load_native_vectors(path: Path) -> dict[int, np.ndarray]:
+    """Vectors of an embed_index store, by the key node_mapping.json rows carry."""
+    raw = path.read_bytes()
+    magic, dim, model_length, count = struct.unpack_from("=8sIIQ", raw)
+    if magic != b"FGEMB001":
+        raise ValueError(f"{path} is not an embed_index store")
+    offset = struct.calcsize("=8sIIQ") + model_length
+    records = np.frombuffer(raw, dtype=np.dtype([("key", "=u8"), ("vector", "=f4", (dim,))]), count=count, offset=offset)
+    logging.info("Loaded %s %s vectors from %s", count, raw[offset - model_length : offset].decode(), path)
+    return {int(key): vector for key, vector in zip(records["key"], records["vector"])}
+
+
+def index_native_vectors(args: argparse.Namespace) -> None:
+    with args.mapping.open("r", encoding="utf-8") as f:
+        mapping = json.load(f)
+    vectors = load_native_vectors(args.vectors)
+    missing = [row["row_id"] for row in mapping if int(row["key"], 16) not in vectors]
+    if missing:
+        logging.error("%s rows of %s have no vector in %s; rerun embed_index", len(missing), args.mapping, args.vectors)
+        return
+    matrix = np.ascontiguousarray(np.stack([vectors[int(row["key"], 16)] for row in mapping]), dtype="float32")
+    index = faiss.index_factory(matrix.shape[1], args.index_factory, faiss.METRIC_INNER_PRODUCT)
+    if not index.is_trained:
+        logging.info("Training %s on %s vectors", args.index_factory, len(matrix))
+        index.train(matrix)
+    index.add(matrix)
+    args.index.parent.mkdir(parents=True, exist_ok=True)
+    faiss.write_index(index, str(args.index))
+    logging.info("Wrote %s index of %s vectors to %s", args.index_factory, index.ntotal, args.index)
+
+
 def main() -> None:
     args = parse_args()
     logging.basicConfig(level=logging.INFO, format="%(asctime)s [%(levelname)s] %(message)s")
+    if args.vectors is not None:
+        index_native_vectors(args)
+        return
 
     nodes = load_nodes(args.nodes)
-    texts = [make_payload(node) for node in nodes]
-
-    logging.info("Loading embedding model: %s (device=%s)", args.model, args.device)
-    model = SentenceTransformer(args.model, device=args.device)
-
-    logging.info("Encoding %s nodes (batch=%s) on %s", len(texts), args.batch_size, args.device)
-    embeddings = model.encode(
-        texts,
-        batch_size=args.batch_size,
-        show_progress_bar=True,
-        convert_to_numpy=True,
-        normalize_embeddings=True,
-    ).astype("float32")
+    # Pages the crawler flagged as copies of another page add nothing to the index.
+    duplicates = sum(1 for node in nodes if node.get("duplicate_of"))
+    if duplicates:
+        nodes = [node for node in nodes if not node.get("duplicate_of")]
+        logging.info("Skipping %s duplicate nodes", duplicates)
+    kept_nodes: list[dict] = []
+    kept_vectors = None
+    if args.delta is not None:
+        kept_nodes, kept_vectors = reusable_vectors(args, nodes, load_delta(args.delta))
+        kept_urls = {node["url"] for node in kept_nodes}
+        to_embed = [node for node in nodes if node["url"] not in kept_urls]
+        logging.info("Delta: reusing %s vectors, embedding %s nodes", len(kept_nodes), len(to_embed))
+    else:
+        to_embed = nodes
+    texts = [make_payload(node) for node in to_embed]
+
+    nodes = kept_nodes + to_embed
+    if texts:
+        from sentence_transformers import SentenceTransformer
+
+        logging.info("Loading embedding model: %s (device=%s)", args.model, args.device)
+        model = SentenceTransformer(args.model, device=args.device)
+
+        logging.info("Encoding %s nodes (batch=%s) on %s", len(texts), args.batch_size, args.device)
+        embeddings = model.encode(
+            texts,
+            batch_size=args.batch_size,
+            show_progress_bar=True,
+            convert_to_numpy=True,
+            normalize_embeddings=True,
+        ).astype("float32")
+        if kept_vectors is not None:
+            embeddings = np.vstack([kept_vectors, embeddings])
+    elif kept_vectors is not None:
+        embeddings = kept_vectors
+    else:
+        logging.error("No nodes to embed")
+        return
 
     dim = embeddings.shape[1]
     logging.info("Embedding dimension: %s", dim)
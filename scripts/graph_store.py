@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""Zero-copy reader for data/processed/graph.bin, which cpp/pack_graph packs
+from nodes.json / edges.json (layout in cpp/include/graph_store.hpp).
+
+    from graph_store import GraphStore
+
+    store = GraphStore("data/processed/graph.bin")
+    store.url(0), store.text(0), store.out_links(0), store.metrics["pagerank"]
+
+The file is memory-mapped: node records, CSR edges and metric columns are
+numpy views of it, and strings are only decoded when asked for, so opening
+a store costs milliseconds whatever its size.
+"""
+
+from __future__ import annotations
+
+from pathlib import Path
+from typing import Dict, Optional
+
+import numpy as np
+
+MAGIC = b"FGGRAPH1"
+HEADER = np.dtype(
+    [("magic", "S8")]
+    + [
+        (name, "=u8")
+        for name in (
+            "node_count",
+            "edge_count",
+            "metric_count",
+            "strings_size",
+            "nodes",
+            "edge_offsets",
+            "edge_targets",
+            "edge_anchors",
+            "metric_names",
+            "metric_values",
+            "strings",
+        )
+    ]
+)
+STRING_REF = np.dtype([("offset", "=u8"), ("length", "=u8")])
+STRING_FIELDS = ("url", "path", "content_type", "doc_type", "title", "domain", "snippet", "text")
+NODE = np.dtype(
+    [(name, STRING_REF) for name in STRING_FIELDS]
+    + [("word_count", "=u4"), ("duplicate_of", "=i4"), ("flags", "=u4"), ("reserved", "=u4")]
+)
+ROOT = 1
+HAS_TITLE = 2
+
+
+class GraphStore:
+    def __init__(self, path: Path | str) -> None:
+        self._data = np.memmap(path, dtype=np.uint8, mode="r")
+        header = np.frombuffer(self._data, dtype=HEADER, count=1)[0]
+        if bytes(header["magic"]) != MAGIC:
+            raise ValueError(f"{path} is not a graph store")
+        self.node_count = int(header["node_count"])
+        self.edge_count = int(header["edge_count"])
+        #: Node records; string fields are (offset, length) refs, see string().
+        self.nodes = self._view(header["nodes"], NODE, self.node_count)
+        #: Node i links to edge_targets[edge_offsets[i]:edge_offsets[i + 1]].
+        self.edge_offsets = self._view(header["edge_offsets"], np.dtype("=u8"), self.node_count + 1)
+        self.edge_targets = self._view(header["edge_targets"], np.dtype("=u4"), self.edge_count)
+        self.edge_anchors = self._view(header["edge_anchors"], STRING_REF, self.edge_count)
+        start = int(header["strings"])
+        self._strings = self._data[start : start + int(header["strings_size"])]
+        names = self._view(header["metric_names"], STRING_REF, int(header["metric_count"]))
+        #: Metric columns (pagerank, in_degree, ...) by name; NaN where a node has no value.
+        self.metrics: Dict[str, np.ndarray] = {
+            self.string(ref): self._view(
+                int(header["metric_values"]) + column * self.node_count * 8, np.dtype("=f8"), self.node_count
+            )
+            for column, ref in enumerate(names)
+        }
+        self._ids: Optional[Dict[str, int]] = None
+
+    def __len__(self) -> int:
+        return self.node_count
+
+    def _view(self, offset, dtype: np.dtype, count: int) -> np.ndarray:
+        if count == 0:
+            return np.empty(0, dtype=dtype)
+        return np.frombuffer(self._data, dtype=dtype, count=count, offset=int(offset))
+
+    def string(self, ref) -> str:
+        offset = int(ref["offset"])
+        return bytes(self._strings[offset : offset + int(ref["length"])]).decode("utf-8")
+
+    def url(self, node: int) -> str:
+        return self.string(self.nodes[node]["url"])
+
+    def title(self, node: int) -> Optional[str]:
+        record = self.nodes[node]
+        return self.string(record["title"]) if record["flags"] & HAS_TITLE else None
+
+    def text(self, node: int) -> str:
+        return self.string(self.nodes[node]["text"])
+
+    def snippet(self, node: int) -> str:
+        return self.string(self.nodes[node]["snippet"])
+
+    def out_links(self, node: int) -> np.ndarray:
+        return self.edge_targets[self.edge_offsets[node] : self.edge_offsets[node + 1]]
+
+    def anchor(self, edge: int) -> str:
+        return self.string(self.edge_anchors[edge])
+
+    def index_of(self, url: str) -> Optional[int]:
+        """Node index of `url` (trailing slash ignored); builds the URL map on first use."""
+        if self._ids is None:
+            self._ids = {self.url(i).rstrip("/"): i for i in range(self.node_count)}
+        return self._ids.get(url.rstrip("/"))
+
+    def node(self, node: int) -> Dict:
+        """Node `node` as the dict nodes.json holds for it."""
+        record = self.nodes[node]
+        data = {name: self.string(record[name]) for name in STRING_FIELDS if name not in ("title", "text")}
+        data["title"] = self.title(node)
+        data["clean_text"] = self.text(node)
+        data["word_count"] = int(record["word_count"])
+        data["is_root"] = bool(record["flags"] & ROOT)
+        if record["duplicate_of"] >= 0:
+            data["duplicate_of"] = self.url(int(record["duplicate_of"]))
+        for name, column in self.metrics.items():
+            if not np.isnan(column[node]):
+                data[name] = float(column[node])
+        return data
@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""Read crawled bodies out of the crawler's segment files.
+
+The crawler appends bodies to data/raw/segments/NNNNN.seg and records each
+one in metadata.tsv as a locator "<segment path>@<byte offset>". Segments are
+mmapped once and records are read by offset without copying the file.
+
+Usage:
+
+    python scripts/segments.py data/raw/segments/00000.seg@8   # print one record's headers
+    python scripts/segments.py data/raw/segments/00000.seg     # list every record
+
+Record layout (little-endian): b"FGR1", uint32 url length, uint32 content
+type length, uint32 flags (the body's content encoding: 0 = as is, 1 = gzip,
+2 = deflate, written with "store_compressed"), uint64 body length, then url,
+content type and body, zero-padded to 8 bytes. A segment starts with
+b"FGSEG001".
+"""
+
+from __future__ import annotations
+
+import gzip
+import mmap
+import struct
+import sys
+import zlib
+from dataclasses import dataclass
+from pathlib import Path
+from typing import Dict, Iterator, Optional, Tuple
+
+SEGMENT_MAGIC = b"FGSEG001"
+RECORD_MAGIC = b"FGR1"
+RECORD_HEADER = struct.Struct("<4sIIIQ")
+ENCODINGS = ("identity", "gzip", "deflate")
+
+
+@dataclass
+class SegmentRecord:
+    offset: int
+    # Padded size of the record; the next one starts at offset + length.
+    length: int
+    url: str
+    content_type: str
+    # Bytes as stored, still in `encoding`; see decoded().
+    body: memoryview
+    encoding: str = "identity"
+
+    def decoded(self) -> bytes:
+        """The body with its content encoding undone."""
+        if self.encoding == "gzip":
+            return gzip.decompress(self.body)
+        if self.encoding == "deflate":
+            # Servers send both zlib-wrapped and raw deflate.
+            try:
+                return zlib.decompress(self.body)
+            except zlib.error:
+                return zlib.decompress(self.body, -zlib.MAX_WBITS)
+        return bytes(self.body)
+
+
+def split_locator(location: str) -> Optional[Tuple[str, int]]:
+    """(segment path, offset) for a locator, None for a plain file path."""
+    path, sep, offset = location.rpartition("@")
+    if not sep or not path.endswith(".seg") or not offset.isdigit():
+        return None
+    return path, int(offset)
+
+
+class SegmentReader:
+    """Keeps one read-only mmap per segment file. Record bodies are views into
+    the mapping; copy them with bytes() to keep them past close()."""
+
+    def __init__(self) -> None:
+        self._maps: Dict[Path, mmap.mmap] = {}
+
+    def _map(self, path: Path) -> mmap.mmap:
+        mapped = self._maps.get(path)
+        if mapped is None:
+            with path.open("rb") as f:
+                mapped = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+            self._maps[path] = mapped
+        return mapped
+
+    def read(self, path: Path, offset: int) -> Optional[SegmentRecord]:
+        mapped = self._map(path)
+        if offset + RECORD_HEADER.size > len(mapped):
+            return None
+        magic, url_len, type_len, flags, body_len = RECORD_HEADER.unpack_from(mapped, offset)
+        start = offset + RECORD_HEADER.size
+        end = start + url_len + type_len + body_len
+        if magic != RECORD_MAGIC or flags >= len(ENCODINGS) or end > len(mapped):
+            return None
+        view = memoryview(mapped)
+        url = bytes(view[start : start + url_len]).decode("utf-8", errors="replace")
+        content_type = bytes(view[start + url_len : start + url_len + type_len]).decode("utf-8", errors="replace")
+        length = end - offset
+        return SegmentRecord(
+            offset, length + (-length % 8), url, content_type, view[start + url_len + type_len : end], ENCODINGS[flags]
+        )
+
+    def records(self, path: Path) -> Iterator[SegmentRecord]:
+        mapped = self._map(path)
+        if mapped[: len(SEGMENT_MAGIC)] != SEGMENT_MAGIC:
+            return
+        offset = len(SEGMENT_MAGIC)
+        while True:
+            record = self.read(path, offset)
+            if record is None:
+                return
+            yield record
+            offset += record.length
+
+    def close(self) -> None:
+        for mapped in self._maps.values():
+            mapped.close()
+        self._maps.clear()
+
+
+def main() -> None:
+    if len(sys.argv) != 2:
+        print(f"Usage: {sys.argv[0]} <segment path>[@offset]", file=sys.stderr)
+        sys.exit(1)
+    reader = SegmentReader()
+    locator = split_locator(sys.argv[1])
+    if locator is not None:
+        record = reader.read(Path(locator[0]), locator[1])
+        records = [record] if record is not None else []
+    else:
+        records = reader.records(Path(sys.argv[1]))
+    for record in records:
+        print(f"{record.offset}\t{record.url}\t{record.content_type}\t{len(record.body)}\t{record.encoding}")
+
+
+if __name__ == "__main__":
+    main()